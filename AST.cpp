@@ -0,0 +1,147 @@
+#include "AST.h"
+
+namespace {
+
+struct Worklist {
+    std::vector<std::unique_ptr<Expr>> exprs;
+    std::vector<std::unique_ptr<Stmt>> stmts;
+
+    void add(std::unique_ptr<Expr>& expr) {
+        if (expr) exprs.push_back(std::move(expr));
+    }
+    void add(std::unique_ptr<Stmt>& stmt) {
+        if (stmt) stmts.push_back(std::move(stmt));
+    }
+};
+
+// Moves the children of `node` into the worklist
+void detach(Expr* node, Worklist& work) {
+    switch (node->kind) {
+        case ExprKind::Binary:
+        case ExprKind::CompareConst: {
+            auto bin = static_cast<BinaryExpr*>(node);
+            work.add(bin->left);
+            work.add(bin->right);
+            break;
+        }
+        case ExprKind::Unary: work.add(static_cast<UnaryExpr*>(node)->right); break;
+        case ExprKind::Map: {
+            auto map = static_cast<MapExpr*>(node);
+            for (auto& key : map->keys) work.add(key);
+            for (auto& value : map->values) work.add(value);
+            map->keys.clear();
+            map->values.clear();
+            break;
+        }
+        case ExprKind::Index: {
+            auto index = static_cast<IndexExpr*>(node);
+            work.add(index->object);
+            work.add(index->index);
+            break;
+        }
+        case ExprKind::Call: {
+            auto call = static_cast<CallExpr*>(node);
+            for (auto& arg : call->args) work.add(arg);
+            call->args.clear();
+            break;
+        }
+        default: break;
+    }
+}
+
+void detach(Stmt* node, Worklist& work) {
+    switch (node->kind) {
+        case StmtKind::Print: work.add(static_cast<PrintStmt*>(node)->expression); break;
+        case StmtKind::Assign:
+        case StmtKind::Increment:
+        case StmtKind::Append: work.add(static_cast<AssignStmt*>(node)->value); break;
+        case StmtKind::If: {
+            auto ifStmt = static_cast<IfStmt*>(node);
+            work.add(ifStmt->condition);
+            work.add(ifStmt->thenBranch);
+            work.add(ifStmt->elseBranch);
+            break;
+        }
+        case StmtKind::While: {
+            auto whileStmt = static_cast<WhileStmt*>(node);
+            work.add(whileStmt->condition);
+            work.add(whileStmt->body);
+            break;
+        }
+        case StmtKind::For: {
+            auto forStmt = static_cast<ForStmt*>(node);
+            work.add(forStmt->initializer);
+            work.add(forStmt->condition);
+            work.add(forStmt->increment);
+            work.add(forStmt->body);
+            break;
+        }
+        case StmtKind::Block: {
+            auto& statements = static_cast<BlockStmt*>(node)->statements;
+            for (auto& stmt : statements) work.add(stmt);
+            statements.clear();
+            break;
+        }
+        case StmtKind::IndexAssign: {
+            auto assign = static_cast<IndexAssignStmt*>(node);
+            work.add(assign->object);
+            work.add(assign->index);
+            work.add(assign->value);
+            break;
+        }
+        case StmtKind::Remove: {
+            auto remove = static_cast<RemoveStmt*>(node);
+            work.add(remove->object);
+            work.add(remove->index);
+            break;
+        }
+        case StmtKind::ForIn: {
+            auto forIn = static_cast<ForInStmt*>(node);
+            work.add(forIn->map);
+            work.add(forIn->body);
+            break;
+        }
+        case StmtKind::Function: work.add(static_cast<FunctionStmt*>(node)->body); break;
+        case StmtKind::Return: work.add(static_cast<ReturnStmt*>(node)->value); break;
+        case StmtKind::LazyBlock: work.add(static_cast<LazyBlockStmt*>(node)->parsed); break;
+        default: break;
+    }
+}
+
+void drain(Worklist& work) {
+    while (!work.exprs.empty() || !work.stmts.empty()) {
+        if (!work.exprs.empty()) {
+            std::unique_ptr<Expr> expr = std::move(work.exprs.back());
+            work.exprs.pop_back();
+            detach(expr.get(), work);
+        } else {
+            std::unique_ptr<Stmt> stmt = std::move(work.stmts.back());
+            work.stmts.pop_back();
+            detach(stmt.get(), work);
+        }
+    }
+}
+
+// One worklist per thread, kept between calls so that freeing a tree does not
+// allocate. Nodes freed while it drains only add their children to it.
+thread_local Worklist pending;
+thread_local bool draining = false;
+
+template <typename Node>
+void release(Node* node) {
+    detach(node, pending);
+    if (draining) return;
+    draining = true;
+    drain(pending);
+    draining = false;
+}
+
+} // namespace
+
+void dismantle(Expr* node) {
+    release(node);
+}
+
+void dismantle(Stmt* node) {
+    release(node);
+}
@@ -2,16 +2,42 @@
 #define AST_H
 
 #include "Token.h"
+#include "SharedString.h"
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
 // --- Forward declarations ---
 struct Expr;
 struct Stmt;
+struct LazySource;  // Parser.h
+
+// Frees the subtrees below `node` with an explicit worklist, so that tearing
+// down a deeply nested tree cannot overflow the stack. Composite nodes call
+// this from their destructors; by the time a child is destroyed its own
+// children have already been moved out.
+void dismantle(Expr* node);
+void dismantle(Stmt* node);
+
+// --- Node kinds ---
+// Lets hot paths dispatch with a switch instead of a chain of dynamic_casts.
+// The last kinds of each are fused idioms (see the end of this file).
+enum class ExprKind { Int, Float, Char, String, Variable, Binary, Unary, Map, Index, Call, CompareConst };
+enum class StmtKind { Print, Assign, If, While, For, Block, Break, Continue, IndexAssign, Remove, ForIn,
+                      Function, Return, LazyBlock, Increment, Append };
+
+// Sizes of tables indexed by kind; update them with the enums
+constexpr size_t exprKindCount = static_cast<size_t>(ExprKind::CompareConst) + 1;
+constexpr size_t stmtKindCount = static_cast<size_t>(StmtKind::Append) + 1;
 
 // --- Expression base ---
 struct Expr {
+    const ExprKind kind;
+
+    explicit Expr(ExprKind k) : kind(k) {}
     virtual ~Expr() = default;
 };
 
@@ -19,27 +45,37 @@ struct Expr {
 
 struct IntExpr : Expr {
     int value;
-    IntExpr(int val) : value(val) {}
+    IntExpr(int val) : Expr(ExprKind::Int), value(val) {}
 };
 
 struct FloatExpr : Expr {
     float value;
-    FloatExpr(float val) : value(val) {}
+    FloatExpr(float val) : Expr(ExprKind::Float), value(val) {}
 };
 
 struct CharExpr : Expr {
     char value;
-    CharExpr(char val) : value(val) {}
+    CharExpr(char val) : Expr(ExprKind::Char), value(val) {}
 };
 
 struct StringExpr : Expr {
-    std::string value;
-    StringExpr(const std::string& val) : value(val) {}
+    SharedString value;
+    StringExpr(const SharedString& val) : Expr(ExprKind::String), value(val) {}
 };
 
+// Where a variable lives. Outside functions names are looked up from the
+// innermost scope outward; inside a function, names it assigns (and its
+// parameters) are slots of its call frame and all others are globals.
+namespace scope {
+constexpr int nearest = -1;  // innermost scope that defines the name
+constexpr int global = -2;
+}
+
 struct VariableExpr : Expr {
-    std::string name;
-    VariableExpr(const std::string& n) : name(n) {}
+    SharedString name;
+    int local = scope::nearest;  // frame slot, or scope::nearest or scope::global
+
+    VariableExpr(const SharedString& n, int slot = scope::nearest) : Expr(ExprKind::Variable), name(n), local(slot) {}
 };
 
 struct BinaryExpr : Expr {
@@ -48,7 +84,12 @@ struct BinaryExpr : Expr {
     std::unique_ptr<Expr> right;
 
     BinaryExpr(std::unique_ptr<Expr> l, const Token& oper, std::unique_ptr<Expr> r)
-        : left(std::move(l)), op(oper), right(std::move(r)) {}
+        : BinaryExpr(ExprKind::Binary, std::move(l), oper, std::move(r)) {}
+    ~BinaryExpr() override { dismantle(this); }
+
+protected:
+    BinaryExpr(ExprKind k, std::unique_ptr<Expr> l, const Token& oper, std::unique_ptr<Expr> r)
+        : Expr(k), left(std::move(l)), op(oper), right(std::move(r)) {}
 };
 
 struct UnaryExpr : Expr {
@@ -56,11 +97,49 @@ struct UnaryExpr : Expr {
     std::unique_ptr<Expr> right;
 
     UnaryExpr(const Token& oper, std::unique_ptr<Expr> rhs)
-        : op(oper), right(std::move(rhs)) {}
+        : Expr(ExprKind::Unary), op(oper), right(std::move(rhs)) {}
+    ~UnaryExpr() override { dismantle(this); }
+};
+
+// {key: value, ...}; keys[i] pairs with values[i]
+struct MapExpr : Expr {
+    std::vector<std::unique_ptr<Expr>> keys;
+    std::vector<std::unique_ptr<Expr>> values;
+
+    MapExpr(std::vector<std::unique_ptr<Expr>> k, std::vector<std::unique_ptr<Expr>> v)
+        : Expr(ExprKind::Map), keys(std::move(k)), values(std::move(v)) {}
+    ~MapExpr() override { dismantle(this); }
+};
+
+// object[index]
+struct IndexExpr : Expr {
+    std::unique_ptr<Expr> object;
+    std::unique_ptr<Expr> index;
+
+    IndexExpr(std::unique_ptr<Expr> obj, std::unique_ptr<Expr> idx)
+        : Expr(ExprKind::Index), object(std::move(obj)), index(std::move(idx)) {}
+    ~IndexExpr() override { dismantle(this); }
+};
+
+// name(args...). `slot` is the name's process-wide NativeRegistry slot,
+// fixed at parse time; a script function declared under the name takes
+// precedence over a native one.
+struct CallExpr : Expr {
+    SharedString name;
+    uint32_t slot;
+    std::vector<std::unique_ptr<Expr>> args;
+
+    CallExpr(const SharedString& n, uint32_t s, std::vector<std::unique_ptr<Expr>> a)
+        : Expr(ExprKind::Call), name(n), slot(s), args(std::move(a)) {}
+    ~CallExpr() override { dismantle(this); }
 };
 
 // --- Statement base ---
 struct Stmt {
+    const StmtKind kind;
+    int line = 0;  // line of the statement's first token
+
+    explicit Stmt(StmtKind k) : kind(k) {}
     virtual ~Stmt() = default;
 };
 
@@ -68,15 +147,22 @@ struct Stmt {
 
 struct PrintStmt : Stmt {
     std::unique_ptr<Expr> expression;
-    PrintStmt(std::unique_ptr<Expr> expr) : expression(std::move(expr)) {}
+    PrintStmt(std::unique_ptr<Expr> expr) : Stmt(StmtKind::Print), expression(std::move(expr)) {}
+    ~PrintStmt() override { dismantle(this); }
 };
 
 struct AssignStmt : Stmt {
-    std::string name;
+    SharedString name;
     std::unique_ptr<Expr> value;
+    int local = scope::nearest;  // frame slot inside a function
+
+    AssignStmt(const SharedString& n, std::unique_ptr<Expr> val)
+        : AssignStmt(StmtKind::Assign, n, std::move(val)) {}
+    ~AssignStmt() override { dismantle(this); }
 
-    AssignStmt(const std::string& n, std::unique_ptr<Expr> val)
-        : name(n), value(std::move(val)) {}
+protected:
+    AssignStmt(StmtKind k, const SharedString& n, std::unique_ptr<Expr> val)
+        : Stmt(k), name(n), value(std::move(val)) {}
 };
 
 struct IfStmt : Stmt {
@@ -85,7 +171,8 @@ struct IfStmt : Stmt {
     std::unique_ptr<Stmt> elseBranch;
 
     IfStmt(std::unique_ptr<Expr> cond, std::unique_ptr<Stmt> thenB, std::unique_ptr<Stmt> elseB)
-        : condition(std::move(cond)), thenBranch(std::move(thenB)), elseBranch(std::move(elseB)) {}
+        : Stmt(StmtKind::If), condition(std::move(cond)), thenBranch(std::move(thenB)), elseBranch(std::move(elseB)) {}
+    ~IfStmt() override { dismantle(this); }
 };
 
 struct WhileStmt : Stmt {
@@ -93,7 +180,8 @@ struct WhileStmt : Stmt {
     std::unique_ptr<Stmt> body;
 
     WhileStmt(std::unique_ptr<Expr> cond, std::unique_ptr<Stmt> bod)
-        : condition(std::move(cond)), body(std::move(bod)) {}
+        : Stmt(StmtKind::While), condition(std::move(cond)), body(std::move(bod)) {}
+    ~WhileStmt() override { dismantle(this); }
 };
 
 struct ForStmt : Stmt {
@@ -104,16 +192,131 @@ struct ForStmt : Stmt {
 
     ForStmt(std::unique_ptr<Stmt> init, std::unique_ptr<Expr> cond,
             std::unique_ptr<Stmt> incr, std::unique_ptr<Stmt> bod)
-        : initializer(std::move(init)), condition(std::move(cond)),
+        : Stmt(StmtKind::For), initializer(std::move(init)), condition(std::move(cond)),
           increment(std::move(incr)), body(std::move(bod)) {}
+    ~ForStmt() override { dismantle(this); }
 };
 
 struct BlockStmt : Stmt {
     std::vector<std::unique_ptr<Stmt>> statements;
-    BlockStmt(std::vector<std::unique_ptr<Stmt>> stmts) : statements(std::move(stmts)) {}
+    BlockStmt(std::vector<std::unique_ptr<Stmt>> stmts) : Stmt(StmtKind::Block), statements(std::move(stmts)) {}
+    ~BlockStmt() override { dismantle(this); }
+};
+
+struct BreakStmt : Stmt {
+    BreakStmt() : Stmt(StmtKind::Break) {}
+};
+
+struct ContinueStmt : Stmt {
+    ContinueStmt() : Stmt(StmtKind::Continue) {}
 };
 
-struct BreakStmt : Stmt {};
-struct ContinueStmt : Stmt {};
+// object[index] = value;
+struct IndexAssignStmt : Stmt {
+    std::unique_ptr<Expr> object;
+    std::unique_ptr<Expr> index;
+    std::unique_ptr<Expr> value;
+
+    IndexAssignStmt(std::unique_ptr<Expr> obj, std::unique_ptr<Expr> idx, std::unique_ptr<Expr> val)
+        : Stmt(StmtKind::IndexAssign), object(std::move(obj)), index(std::move(idx)), value(std::move(val)) {}
+    ~IndexAssignStmt() override { dismantle(this); }
+};
+
+// remove object[index];
+struct RemoveStmt : Stmt {
+    std::unique_ptr<Expr> object;
+    std::unique_ptr<Expr> index;
+
+    RemoveStmt(std::unique_ptr<Expr> obj, std::unique_ptr<Expr> idx)
+        : Stmt(StmtKind::Remove), object(std::move(obj)), index(std::move(idx)) {}
+    ~RemoveStmt() override { dismantle(this); }
+};
+
+// for (name in map) body -- visits the keys present when the loop starts
+struct ForInStmt : Stmt {
+    SharedString name;
+    std::unique_ptr<Expr> map;
+    std::unique_ptr<Stmt> body;
+    int local = scope::nearest;  // frame slot of `name` inside a function
+
+    ForInStmt(const SharedString& n, std::unique_ptr<Expr> m, std::unique_ptr<Stmt> bod)
+        : Stmt(StmtKind::ForIn), name(n), map(std::move(m)), body(std::move(bod)) {}
+    ~ForInStmt() override { dismantle(this); }
+};
+
+// fun name(params...) body -- only at the top level of a program. Parameters
+// are frame slots 0..params.size()-1 and the other locals follow them;
+// `locals` counts both. Blocks and loops inside the body open no scopes.
+struct FunctionStmt : Stmt {
+    SharedString name;
+    uint32_t slot;  // NativeRegistry slot of `name`, shared with CallExpr
+    std::vector<SharedString> params;
+    std::unique_ptr<Stmt> body;
+    uint32_t locals;
+
+    FunctionStmt(const SharedString& n, uint32_t s, std::vector<SharedString> p, std::unique_ptr<Stmt> bod, uint32_t l)
+        : Stmt(StmtKind::Function), name(n), slot(s), params(std::move(p)), body(std::move(bod)), locals(l) {}
+    ~FunctionStmt() override { dismantle(this); }
+};
+
+// return value; -- `value` is null for a bare return, which yields 0
+struct ReturnStmt : Stmt {
+    std::unique_ptr<Expr> value;
+    ReturnStmt(std::unique_ptr<Expr> val) : Stmt(StmtKind::Return), value(std::move(val)) {}
+    ~ReturnStmt() override { dismantle(this); }
+};
+
+// The body of an if, else, while or for in lazy parsing mode: its braces are
+// matched but its statements are only parsed when body() is first called,
+// which may happen on several threads at once. A syntax error inside it is
+// thrown from body() as a ParseError.
+struct LazyBlockStmt : Stmt {
+    std::shared_ptr<const LazySource> source;
+    size_t begin;  // token index of the '{'
+    size_t depth;  // statements open around it
+
+    LazyBlockStmt(std::shared_ptr<const LazySource> src, size_t b, size_t d)
+        : Stmt(StmtKind::LazyBlock), source(std::move(src)), begin(b), depth(d) {}
+    ~LazyBlockStmt() override { dismantle(this); }
+
+    const Stmt* body() const;  // defined in Parser.cpp
+
+    mutable std::unique_ptr<Stmt> parsed;  // once body() has run
+
+private:
+    mutable std::once_flag once;
+};
+
+// --- Fused idioms ---
+// Substituted by the Fuser after parsing so that the interpreter runs each
+// as one step. Each keeps the children of the node it replaces and derives
+// from its class, so passes that match nodes with dynamic_cast see the
+// original statement or expression.
+
+// v = v + <int> or v = v - <int>
+struct IncrementStmt : AssignStmt {
+    IncrementStmt(const SharedString& n, std::unique_ptr<Expr> val) : AssignStmt(StmtKind::Increment, n, std::move(val)) {}
+
+    const BinaryExpr* update() const { return static_cast<const BinaryExpr*>(value.get()); }
+    int step() const { return static_cast<const IntExpr*>(update()->right.get())->value; }
+};
+
+// v = v + <string literal>
+struct AppendStmt : AssignStmt {
+    AppendStmt(const SharedString& n, std::unique_ptr<Expr> val) : AssignStmt(StmtKind::Append, n, std::move(val)) {}
+
+    const SharedString& suffix() const {
+        return static_cast<const StringExpr*>(static_cast<const BinaryExpr*>(value.get())->right.get())->value;
+    }
+};
+
+// <variable> <comparison> <int>
+struct CompareConstExpr : BinaryExpr {
+    CompareConstExpr(std::unique_ptr<Expr> l, const Token& oper, std::unique_ptr<Expr> r)
+        : BinaryExpr(ExprKind::CompareConst, std::move(l), oper, std::move(r)) {}
+
+    const VariableExpr* variable() const { return static_cast<const VariableExpr*>(left.get()); }
+    int constant() const { return static_cast<const IntExpr*>(right.get())->value; }
+};
 
 #endif // AST_H
@@ -0,0 +1,267 @@
+#include "AllocProfiler.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <mutex>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+struct SiteKey {
+    uint32_t stack;
+    int line;
+    const char* stmt;
+    const char* expr;
+
+    bool operator==(const SiteKey& other) const {
+        return stack == other.stack && line == other.line && stmt == other.stmt && expr == other.expr;
+    }
+};
+
+struct SiteKeyHash {
+    size_t operator()(const SiteKey& key) const {
+        size_t h = std::hash<const void*>()(key.stmt) ^ (std::hash<const void*>()(key.expr) * 31);
+        return h ^ (static_cast<size_t>(key.stack) << 20) ^ static_cast<size_t>(key.line);
+    }
+};
+
+struct Totals {
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+    uint64_t shortLived = 0;
+};
+
+struct Live {
+    size_t site;
+    uint64_t serial;  // statements started before the allocation
+};
+
+// One script function call chain; chain 0 is the top level
+struct Chain {
+    uint32_t parent;
+    SharedString function;
+    std::unordered_map<SharedString, uint32_t, SharedStringHash> callees;
+};
+
+struct State {
+    std::mutex mutex;
+    std::unordered_map<SiteKey, size_t, SiteKeyHash> siteIndex;
+    std::vector<std::pair<SiteKey, Totals>> sites;
+    std::unordered_map<void*, Live> live;
+    std::vector<Chain> chains{Chain{0, SharedString("main"), {}}};
+};
+
+// Never freed, so the hooks stay safe during static destruction
+State* state = nullptr;
+std::atomic<uint64_t> serial{0};
+
+// Set while this thread updates the profile, whose own allocations are not counted
+thread_local bool busy = false;
+
+class Update {
+public:
+    Update() : lock((busy = true, state->mutex)) {}
+    ~Update() {
+        lock.unlock();
+        busy = false;
+    }
+
+private:
+    std::unique_lock<std::mutex> lock;
+};
+
+const char* stmtNames[] = {"Print", "Assign", "If", "While", "For", "Block", "Break", "Continue",
+                           "IndexAssign", "Remove", "ForIn", "Function", "Return", "LazyBlock",
+                           "Increment", "Append"};
+const char* exprNames[] = {"Int", "Float", "Char", "String", "Variable", "Binary", "Unary", "Map", "Index", "Call",
+                           "CompareConst"};
+static_assert(std::size(stmtNames) == stmtKindCount, "a statement kind has no name");
+static_assert(std::size(exprNames) == exprKindCount, "an expression kind has no name");
+
+std::string describe(const SiteKey& key) {
+    std::string text = key.line > 0 ? "line " + std::to_string(key.line) + " " + key.stmt : key.stmt;
+    if (key.expr) text += std::string(", ") + key.expr;
+    return text;
+}
+
+} // namespace
+
+// --- Sites ---
+void AllocProfiler::enterStmt(const Stmt* stmt) {
+    site = Site{site.stack, stmt->line, stmtNames[static_cast<size_t>(stmt->kind)], nullptr};
+    serial.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AllocProfiler::enterCall(const SharedString& function) {
+    Update update;
+    auto& callees = state->chains[site.stack].callees;
+    auto found = callees.find(function);
+    uint32_t chain;
+    if (found != callees.end()) {
+        chain = found->second;
+    } else {
+        chain = static_cast<uint32_t>(state->chains.size());
+        callees.emplace(function, chain);
+        state->chains.push_back(Chain{site.stack, function, {}});
+    }
+    site.stack = chain;
+}
+
+const char* AllocProfiler::exprName(ExprKind kind) { return exprNames[static_cast<size_t>(kind)]; }
+
+// --- Hooks ---
+void AllocProfiler::allocated(void* block, size_t size) {
+    if (busy) return;
+    Update update;
+    SiteKey key{site.stack, site.line, site.stmt, site.expr};
+    auto found = state->siteIndex.find(key);
+    size_t index;
+    if (found != state->siteIndex.end()) {
+        index = found->second;
+    } else {
+        index = state->sites.size();
+        state->siteIndex.emplace(key, index);
+        state->sites.emplace_back(key, Totals{});
+    }
+    Totals& totals = state->sites[index].second;
+    ++totals.count;
+    totals.bytes += size;
+    state->live[block] = Live{index, serial.load(std::memory_order_relaxed)};
+}
+
+void AllocProfiler::freed(void* block) {
+    if (busy) return;
+    Update update;
+    auto found = state->live.find(block);
+    if (found == state->live.end()) return;  // allocated before the profile started
+    if (found->second.serial == serial.load(std::memory_order_relaxed)) ++state->sites[found->second.site].second.shortLived;
+    state->live.erase(found);
+}
+
+// --- Session ---
+AllocProfiler::Session::Session(std::string path, std::ostream& out) : foldedPath(std::move(path)), report(out) {
+    if (foldedPath.empty()) return;
+    if (!state) state = new State;
+    site = Site{};
+    running.store(true, std::memory_order_relaxed);
+}
+
+AllocProfiler::Session::~Session() {
+    if (foldedPath.empty()) return;
+    running.store(false, std::memory_order_relaxed);
+
+    std::vector<std::pair<SiteKey, Totals>> sites;
+    {
+        Update update;
+        sites = state->sites;
+    }
+    std::sort(sites.begin(), sites.end(), [](const auto& a, const auto& b) { return a.second.bytes > b.second.bytes; });
+
+    Totals all;
+    for (const auto& entry : sites) {
+        all.count += entry.second.count;
+        all.bytes += entry.second.bytes;
+        all.shortLived += entry.second.shortLived;
+    }
+    auto percent = [](uint64_t part, uint64_t whole) { return whole ? part * 100 / whole : 0; };
+
+    report << "[alloc-profile] " << all.count << " allocations, " << all.bytes << " bytes, "
+           << percent(all.shortLived, all.count) << "% short-lived\n";
+    report << "[alloc-profile] " << std::setw(10) << "allocs" << std::setw(12) << "bytes" << std::setw(7) << "short"
+           << "  site\n";
+    for (size_t i = 0; i < sites.size() && i < reportRows; ++i) {
+        const auto& [key, totals] = sites[i];
+        report << "[alloc-profile] " << std::setw(10) << totals.count << std::setw(12) << totals.bytes << std::setw(6)
+               << percent(totals.shortLived, totals.count) << "%  " << describe(key);
+        if (key.stack != 0) report << " (in " << state->chains[key.stack].function << ")";
+        report << '\n';
+    }
+    report << std::flush;
+
+    // Folded stacks: main;f;g;line 7 Assign;Binary 4096
+    std::ofstream folded(foldedPath);
+    for (const auto& [key, totals] : sites) {
+        std::vector<const Chain*> frames;
+        for (uint32_t chain = key.stack; chain != 0; chain = state->chains[chain].parent)
+            frames.push_back(&state->chains[chain]);
+        folded << "main";
+        for (auto frame = frames.rbegin(); frame != frames.rend(); ++frame) folded << ';' << (*frame)->function;
+        folded << ';' << (key.line > 0 ? "line " + std::to_string(key.line) + " " + key.stmt : key.stmt);
+        if (key.expr) folded << ';' << key.expr;
+        folded << ' ' << totals.bytes << '\n';
+    }
+    if (!folded) report << "Could not write file: " << foldedPath << std::endl;
+}
+
+// --- Global operator new and delete ---
+// Every replaceable form, so no allocation bypasses the profiler: the
+// plain, array, aligned (Map's control bytes) and nothrow ones. All blocks
+// come from malloc or aligned_alloc and go back through free.
+namespace {
+
+void* allocate(std::size_t size, std::size_t alignment) {
+    if (size == 0) size = 1;
+    void* block;
+    while (!(block = alignment <= alignof(std::max_align_t)
+                         ? std::malloc(size)
+                         : std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment))) {
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+    if (AllocProfiler::active()) AllocProfiler::allocated(block, size);
+    return block;
+}
+
+void release(void* block) noexcept {
+    if (block && AllocProfiler::active()) AllocProfiler::freed(block);
+    std::free(block);
+}
+
+} // namespace
+
+void* operator new(std::size_t size) { return allocate(size, 0); }
+void* operator new[](std::size_t size) { return allocate(size, 0); }
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return allocate(size, 0);
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept { return operator new(size, tag); }
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    try {
+        return allocate(size, static_cast<std::size_t>(alignment));
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t& tag) noexcept {
+    return operator new(size, alignment, tag);
+}
+
+void operator delete(void* block) noexcept { release(block); }
+void operator delete[](void* block) noexcept { release(block); }
+void operator delete(void* block, std::size_t) noexcept { release(block); }
+void operator delete[](void* block, std::size_t) noexcept { release(block); }
+void operator delete(void* block, std::align_val_t) noexcept { release(block); }
+void operator delete[](void* block, std::align_val_t) noexcept { release(block); }
+void operator delete(void* block, std::size_t, std::align_val_t) noexcept { release(block); }
+void operator delete[](void* block, std::size_t, std::align_val_t) noexcept { release(block); }
+void operator delete(void* block, const std::nothrow_t&) noexcept { release(block); }
+void operator delete[](void* block, const std::nothrow_t&) noexcept { release(block); }
+void operator delete(void* block, std::align_val_t, const std::nothrow_t&) noexcept { release(block); }
+void operator delete[](void* block, std::align_val_t, const std::nothrow_t&) noexcept { release(block); }
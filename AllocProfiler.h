@@ -0,0 +1,100 @@
+#ifndef ALLOC_PROFILER_H
+#define ALLOC_PROFILER_H
+
+#include "AST.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Heap profile for --alloc-profile. This file replaces the global operator
+// new and delete; while a profile runs, every allocation is charged to the
+// site running on its thread: the script function call chain, the line and
+// kind of the statement, and the kind of expression node, if any. An
+// allocation is short-lived if it is freed before another statement starts.
+// With no profile running the hooks only test one flag, and so do the
+// interpreter's site updates.
+class AllocProfiler {
+public:
+    static constexpr size_t reportRows = 20;
+
+    // What this thread is running. `stmt` names a phase such as "(parse)"
+    // when no statement is running.
+    struct Site {
+        uint32_t stack = 0;  // call chain, see enterCall
+        int line = 0;
+        const char* stmt = "(startup)";
+        const char* expr = nullptr;
+    };
+
+    static bool active() { return running.load(std::memory_order_relaxed); }
+
+    // --- Interpreter hooks ---
+    static void atPhase(const char* name) {
+        if (active()) site = Site{site.stack, 0, name, nullptr};
+    }
+    static void atStmt(const Stmt* stmt) {
+        if (active()) enterStmt(stmt);
+    }
+    static void atExpr(ExprKind kind) {
+        if (active()) site.expr = exprName(kind);
+    }
+    static void leaveExpr() {
+        if (active()) site.expr = nullptr;
+    }
+
+    // Charges a script function's allocations to its call chain until
+    // destroyed; the caller's site is restored afterwards
+    class Call {
+    public:
+        explicit Call(const SharedString& function) {
+            if (active()) {
+                saved = site;
+                entered = true;
+                enterCall(function);
+            }
+        }
+        ~Call() {
+            if (entered) site = saved;
+        }
+        Call(const Call&) = delete;
+        Call& operator=(const Call&) = delete;
+
+    private:
+        Site saved;
+        bool entered = false;
+    };
+
+    // Profiles the process from construction; on destruction prints the
+    // top sites by bytes to `report` and writes folded stacks, one
+    // "frame;frame;... bytes" line per site, to `foldedPath`. Does nothing
+    // if `foldedPath` is empty.
+    class Session {
+    public:
+        Session(std::string foldedPath, std::ostream& report);
+        ~Session();
+        Session(const Session&) = delete;
+        Session& operator=(const Session&) = delete;
+
+    private:
+        std::string foldedPath;
+        std::ostream& report;
+    };
+
+    // Called by operator new and delete
+    static void allocated(void* block, size_t size);
+    static void freed(void* block);
+
+private:
+    static inline std::atomic<bool> running{false};
+    static thread_local Site site;
+
+    static void enterStmt(const Stmt* stmt);
+    static void enterCall(const SharedString& function);
+    static const char* exprName(ExprKind kind);
+};
+
+inline thread_local AllocProfiler::Site AllocProfiler::site;
+
+#endif // ALLOC_PROFILER_H
@@ -0,0 +1,183 @@
+// The standard native functions every interpreter starts with.
+#include "Native.h"
+#include "Map.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+namespace {
+
+// --- Math ---
+// Overflow gives inf, as float arithmetic does, but a NaN is an error
+double defined(double x, const char* function) {
+    if (std::isnan(x)) throw std::runtime_error(std::string(function) + "() result is not a number");
+    return x;
+}
+
+double nativeSqrt(double x) { return defined(std::sqrt(x), "sqrt"); }
+double nativePow(double x, double y) { return defined(std::pow(x, y), "pow"); }
+double nativeExp(double x) { return defined(std::exp(x), "exp"); }
+double nativeLog(double x) { return defined(std::log(x), "log"); }
+double nativeSin(double x) { return defined(std::sin(x), "sin"); }
+double nativeCos(double x) { return defined(std::cos(x), "cos"); }
+double nativeAtan2(double y, double x) { return defined(std::atan2(y, x), "atan2"); }
+
+int toInt(double x, const char* function) {
+    if (!(x >= -2147483648.0 && x < 2147483648.0)) throw std::runtime_error(std::string(function) + "() result is out of int range");
+    return static_cast<int>(x);
+}
+
+int nativeFloor(double x) { return toInt(std::floor(x), "floor"); }
+int nativeCeil(double x) { return toInt(std::ceil(x), "ceil"); }
+int nativeRound(double x) { return toInt(std::round(x), "round"); }
+
+// abs, min and max keep ints as ints and otherwise work in float
+float number(const Value& v, const char* function, size_t index) {
+    return native::Convert<float>::from(v, function, index);
+}
+
+Value nativeAbs(const Value& x) {
+    if (auto i = std::get_if<int>(&x)) {
+        if (*i == std::numeric_limits<int>::min()) throw std::runtime_error("abs() result is out of int range");
+        return *i < 0 ? -*i : *i;
+    }
+    return std::fabs(number(x, "abs", 0));
+}
+
+Value nativeMin(const Value& a, const Value& b) {
+    if (a.index() == 0 && b.index() == 0) return std::min(std::get<int>(a), std::get<int>(b));
+    return std::min(number(a, "min", 0), number(b, "min", 1));
+}
+
+Value nativeMax(const Value& a, const Value& b) {
+    if (a.index() == 0 && b.index() == 0) return std::max(std::get<int>(a), std::get<int>(b));
+    return std::max(number(a, "max", 0), number(b, "max", 1));
+}
+
+// --- Conversions ---
+Value nativeInt(const Value& v) {
+    switch (v.index()) {
+        case 0: return v;
+        case 1: return toInt(std::trunc(std::get<float>(v)), "int");
+        case 2: return static_cast<int>(std::get<char>(v));
+        case 3: {
+            std::string_view text = std::get<SharedString>(v).view();
+            int result = 0;
+            auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), result);
+            if (error != std::errc() || end != text.data() + text.size() || text.empty())
+                throw std::runtime_error("int() cannot convert \"" + std::string(text) + "\"");
+            return result;
+        }
+        default: native::badArgument("int", 0, "a number, char or string");
+    }
+}
+
+Value nativeFloat(const Value& v) {
+    switch (v.index()) {
+        case 0: return static_cast<float>(std::get<int>(v));
+        case 1: return v;
+        case 3: {
+            std::string_view text = std::get<SharedString>(v).view();
+            float result = 0;
+            auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), result);
+            if (error != std::errc() || end != text.data() + text.size() || text.empty())
+                throw std::runtime_error("float() cannot convert \"" + std::string(text) + "\"");
+            return result;
+        }
+        default: native::badArgument("float", 0, "a number or string");
+    }
+}
+
+// Formats like print
+SharedString nativeStr(const Value& v) {
+    if (auto s = std::get_if<SharedString>(&v)) return *s;
+    std::ostringstream out;
+    std::visit([&](const auto& val) { out << val; }, v);
+    return SharedString(out.str());
+}
+
+// --- Strings ---
+int nativeLen(const Value& v) {
+    if (auto s = std::get_if<SharedString>(&v)) return static_cast<int>(s->size());
+    if (auto m = std::get_if<MapRef>(&v)) return static_cast<int>((*m)->size());
+    native::badArgument("len", 0, "a string or map");
+}
+
+// Clamps [start, start + count) to the string, like std::string::substr without throwing
+std::string_view nativeSubstr(std::string_view s, int start, int count) {
+    size_t from = static_cast<size_t>(std::clamp(start, 0, static_cast<int>(s.size())));
+    size_t length = static_cast<size_t>(std::max(count, 0));
+    return s.substr(from, length);
+}
+
+int nativeFind(std::string_view s, std::string_view needle) {
+    size_t at = s.find(needle);
+    return at == std::string_view::npos ? -1 : static_cast<int>(at);
+}
+
+char nativeAt(std::string_view s, int index) {
+    if (index < 0 || static_cast<size_t>(index) >= s.size())
+        throw std::runtime_error("at() index " + std::to_string(index) + " is out of range");
+    return s[static_cast<size_t>(index)];
+}
+
+std::string nativeUpper(std::string s) {
+    for (char& c : s) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    return s;
+}
+
+std::string nativeLower(std::string s) {
+    for (char& c : s) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return s;
+}
+
+std::string_view nativeTrim(std::string_view s) {
+    size_t begin = 0, end = s.size();
+    while (begin < end && std::isspace(static_cast<unsigned char>(s[begin]))) ++begin;
+    while (end > begin && std::isspace(static_cast<unsigned char>(s[end - 1]))) --end;
+    return s.substr(begin, end - begin);
+}
+
+int nativeOrd(char c) { return static_cast<unsigned char>(c); }
+char nativeChr(int code) { return static_cast<char>(code); }
+
+NativeRegistry buildStandard() {
+    NativeRegistry registry;
+    const Purity pure = Purity::Pure;
+    registry.define<&nativeSqrt>("sqrt", pure);
+    registry.define<&nativePow>("pow", pure);
+    registry.define<&nativeExp>("exp", pure);
+    registry.define<&nativeLog>("log", pure);
+    registry.define<&nativeSin>("sin", pure);
+    registry.define<&nativeCos>("cos", pure);
+    registry.define<&nativeAtan2>("atan2", pure);
+    registry.define<&nativeFloor>("floor", pure);
+    registry.define<&nativeCeil>("ceil", pure);
+    registry.define<&nativeRound>("round", pure);
+    registry.define<&nativeAbs>("abs", pure);
+    registry.define<&nativeMin>("min", pure);
+    registry.define<&nativeMax>("max", pure);
+    registry.define<&nativeInt>("int", pure);
+    registry.define<&nativeFloat>("float", pure);
+    registry.define<&nativeStr>("str", pure);
+    registry.define<&nativeLen>("len", pure);
+    registry.define<&nativeSubstr>("substr", pure);
+    registry.define<&nativeFind>("find", pure);
+    registry.define<&nativeAt>("at", pure);
+    registry.define<&nativeUpper>("upper", pure);
+    registry.define<&nativeLower>("lower", pure);
+    registry.define<&nativeTrim>("trim", pure);
+    registry.define<&nativeOrd>("ord", pure);
+    registry.define<&nativeChr>("chr", pure);
+    return registry;
+}
+
+} // namespace
+
+const NativeRegistry& NativeRegistry::standard() {
+    static const NativeRegistry registry = buildStandard();
+    return registry;
+}
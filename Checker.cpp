@@ -0,0 +1,419 @@
+#include "Checker.h"
+#include "Parser.h"
+#include "ThreadPool.h"
+#include "Tokenizer.h"
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+// Markers on the operator stack, as in Parser::expression
+static constexpr int call = -3;
+static constexpr int mapOpen = -2;
+static constexpr int subscript = -1;
+static constexpr int group = 0;
+static constexpr int negate = 5;
+
+// --- Constructor ---
+Checker::Checker(const std::vector<Token>& tokens, size_t maxDepth) : tokens(tokens), maxDepth(maxDepth) {}
+
+// --- Entry Points ---
+std::vector<Diagnostic> Checker::check() {
+    while (!isAtEnd()) statement();
+    return std::move(diagnostics);
+}
+
+std::vector<Checker::FileReport> Checker::checkFiles(const std::vector<std::string>& paths, unsigned threads,
+                                                     size_t maxDepth) {
+    std::vector<FileReport> reports(paths.size());
+    auto checkFile = [&](size_t i) {
+        FileReport& report = reports[i];
+        report.path = paths[i];
+        std::ifstream file(paths[i]);
+        if (!file) {
+            report.diagnostics.push_back(Diagnostic{0, "", "Could not open file."});
+            return;
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+
+        std::vector<Token> tokens = Tokenizer::tokenize(buffer.str());
+        report.diagnostics = Checker(tokens, maxDepth).check();
+    };
+
+    if (threads <= 1 || paths.size() < 2) {
+        for (size_t i = 0; i < paths.size(); ++i) checkFile(i);
+    } else {
+        ThreadPool(threads - 1).run(paths.size(), checkFile);
+    }
+    return reports;
+}
+
+// --- Error Recovery ---
+// Records at most one diagnostic per token, so that an error at the end of
+// the input is not repeated by every statement still open there
+bool Checker::fail(const Token& token, const std::string& message) {
+    if (&token != lastFailed) diagnostics.push_back(Diagnostic{token.line, token.text, message});
+    lastFailed = &token;
+    return false;
+}
+
+// Skips the rest of a statement that failed: through its ';' or a braced
+// body, or up to a '}' that closes an open block or a keyword or assignment
+// that starts the next statement. Map literals left open by the failed
+// expression are skipped to their '}', and a '}' that closes nothing is
+// dropped. `depth` counts braces already open in the skipped statement.
+void Checker::synchronize(size_t depth) {
+    size_t pending = 0;
+    for (const PendingOp& op : ops) {
+        if (op.precedence == mapOpen) ++pending;
+    }
+    ops.clear();
+
+    while (!isAtEnd()) {
+        switch (peek().type) {
+            case TokenType::LeftBrace: ++depth; break;
+            case TokenType::RightBrace:
+                if (depth > 0) {
+                    if (--depth == 0) {
+                        advance();
+                        return;
+                    }
+                } else if (pending > 0) {
+                    --pending;
+                } else if (openBlocks > 0) {
+                    return;
+                }
+                break;
+            case TokenType::Semicolon:
+                if (depth == 0) {
+                    advance();
+                    return;
+                }
+                break;
+            case TokenType::If: case TokenType::While: case TokenType::For: case TokenType::Fun:
+            case TokenType::Print: case TokenType::Break: case TokenType::Continue: case TokenType::Return:
+                if (depth == 0) return;
+                break;
+            default:
+                if (depth == 0 && Parser::startsRemove(tokens, current)) return;
+                if (depth == 0 && pending == 0 && startsAssignment()) return;
+                break;
+        }
+        advance();
+    }
+}
+
+// `name =` or `name[`, after a token that can end the statement before it,
+// so that a missing ';' does not swallow the next assignment
+bool Checker::startsAssignment() const {
+    if (current == 0 || !check(TokenType::Identifier)) return false;
+    if (!checkNext(TokenType::Equal) && !checkNext(TokenType::LeftBracket)) return false;
+    switch (previous().type) {
+        case TokenType::Identifier: case TokenType::Integer: case TokenType::Float: case TokenType::Char:
+        case TokenType::String: case TokenType::RightParen: case TokenType::RightBracket:
+        case TokenType::RightBrace: case TokenType::Semicolon: case TokenType::Else:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// --- Helpers ---
+const Token& Checker::advance() {
+    if (!isAtEnd()) current++;
+    return tokens[current - 1];
+}
+
+bool Checker::match(TokenType type) {
+    if (check(type)) {
+        advance();
+        return true;
+    }
+    return false;
+}
+
+bool Checker::consume(TokenType type, const std::string& message) {
+    if (check(type)) {
+        advance();
+        return true;
+    }
+    return fail(peek(), message);
+}
+
+bool Checker::checkDepth(size_t depth) {
+    if (depth > maxDepth) return fail(previous(), "Nesting exceeds the depth limit of " + std::to_string(maxDepth) + ".");
+    return true;
+}
+
+// --- Statements ---
+// Mirrors Parser::statement. A failed statement ends at the point
+// synchronize() stops, and then closes the statements it completes as if
+// it had parsed.
+void Checker::statement() {
+    open.clear();
+    openBlocks = 0;
+
+    while (true) {
+        bool ok;
+        if (match(TokenType::If) || match(TokenType::While) || match(TokenType::For)) {
+            TokenType keyword = previous().type;
+            open.push_back(OpenStmt{keyword == TokenType::If ? StmtKind::If
+                                    : keyword == TokenType::While ? StmtKind::While : StmtKind::For, false});
+            if (checkDepth(open.size()) && header(open.back().kind)) continue;
+            ok = false;
+        } else if (match(TokenType::Fun)) {
+            if (!open.empty()) {
+                ok = fail(previous(), "Functions can only be declared at the top level.");
+            } else {
+                open.push_back(OpenStmt{StmtKind::Function, false});
+                if (functionHeader()) continue;
+                ok = false;
+            }
+        } else if (match(TokenType::LeftBrace)) {
+            if (!isAtEnd() && !check(TokenType::RightBrace)) {
+                open.push_back(OpenStmt{StmtKind::Block, false});
+                ++openBlocks;
+                if (checkDepth(open.size())) continue;
+
+                // Too deep: skip the whole block, as one statement of the one around it
+                open.pop_back();
+                --openBlocks;
+                synchronize(1);
+                ok = true;
+            } else {
+                ok = consume(TokenType::RightBrace, "Expect '}' after block.");
+            }
+        } else {
+            ok = simpleStatement();
+        }
+        if (!ok) synchronize();
+
+        // Close every open statement that this one completes
+        while (!open.empty()) {
+            OpenStmt& outer = open.back();
+            if (outer.kind == StmtKind::Block) {
+                if (!isAtEnd() && !check(TokenType::RightBrace)) break;
+                if (!consume(TokenType::RightBrace, "Expect '}' after block.")) {
+                    // The input ended; nothing is left to close the rest
+                    open.clear();
+                    function = false;
+                    return;
+                }
+                --openBlocks;
+            } else if (outer.kind == StmtKind::If && !outer.thenDone) {
+                outer.thenDone = true;
+                if (match(TokenType::Else)) break;
+            } else if (outer.kind == StmtKind::Function) {
+                function = false;
+            }
+            open.pop_back();
+        }
+        if (open.empty()) return;
+    }
+}
+
+bool Checker::simpleStatement() {
+    ExprKind kind;
+    if (match(TokenType::Print)) return expression() && consume(TokenType::Semicolon, "Expect ';' after value.");
+    if (match(TokenType::Break)) return consume(TokenType::Semicolon, "Expect ';' after 'break'.");
+    if (match(TokenType::Continue)) return consume(TokenType::Semicolon, "Expect ';' after 'continue'.");
+    if (Parser::startsRemove(tokens, current)) {
+        advance();
+        if (!expression(&kind)) return false;
+        if (kind != ExprKind::Index) return fail(previous(), "Expect a map element after 'remove'.");
+        return consume(TokenType::Semicolon, "Expect ';' after map element.");
+    }
+    if (match(TokenType::Return)) {
+        if (!function) return fail(previous(), "Can't return from outside a function.");
+        if (!check(TokenType::Semicolon) && !expression()) return false;
+        return consume(TokenType::Semicolon, "Expect ';' after return value.");
+    }
+    if (check(TokenType::Identifier) && checkNext(TokenType::Equal)) return assignment();
+    if (check(TokenType::Identifier) && checkNext(TokenType::LeftBracket)) {
+        if (!expression(&kind)) return false;
+        if (kind != ExprKind::Index) return fail(previous(), "Invalid assignment target.");
+        return consume(TokenType::Equal, "Expect '=' after map element.") && expression() &&
+               consume(TokenType::Semicolon, "Expect ';' after expression.");
+    }
+    return fail(peek(), "Expected a statement.");
+}
+
+bool Checker::assignment() {
+    advance();
+    return consume(TokenType::Equal, "Expect '=' after variable name.") && expression() &&
+           consume(TokenType::Semicolon, "Expect ';' after expression.");
+}
+
+bool Checker::header(StmtKind kind) {
+    if (kind == StmtKind::If) {
+        return consume(TokenType::LeftParen, "Expect '(' after 'if'.") && expression() &&
+               consume(TokenType::RightParen, "Expect ')' after condition.");
+    }
+    if (kind == StmtKind::While) {
+        return consume(TokenType::LeftParen, "Expect '(' after 'while'.") && expression() &&
+               consume(TokenType::RightParen, "Expect ')' after condition.");
+    }
+
+    if (!consume(TokenType::LeftParen, "Expect '(' after 'for'.")) return false;
+    if (check(TokenType::Identifier) && current + 1 < tokens.size() && Parser::isWord(tokens[current + 1], "in")) {
+        advance();
+        advance();
+        return expression() && consume(TokenType::RightParen, "Expect ')' after map.");
+    }
+    if (!match(TokenType::Semicolon)) {
+        if (!check(TokenType::Identifier) || !checkNext(TokenType::Equal))
+            return fail(peek(), "Invalid initializer in 'for' loop.");
+        if (!assignment()) return false;
+    }
+    return expression() && consume(TokenType::Semicolon, "Expect ';' after loop condition.") && assignment() &&
+           consume(TokenType::RightParen, "Expect ')' after for clauses.");
+}
+
+bool Checker::functionHeader() {
+    if (!consume(TokenType::Identifier, "Expect function name.") ||
+        !consume(TokenType::LeftParen, "Expect '(' after function name."))
+        return false;
+    function = true;
+    std::vector<const std::string*> params;
+    if (!check(TokenType::RightParen)) {
+        do {
+            if (!consume(TokenType::Identifier, "Expect parameter name.")) return false;
+            const Token& param = previous();
+            for (const std::string* seen : params) {
+                if (*seen == param.text) return fail(param, "Duplicate parameter name.");
+            }
+            params.push_back(&param.text);
+        } while (match(TokenType::Comma));
+    }
+    return consume(TokenType::RightParen, "Expect ')' after parameters.");
+}
+
+// --- Expressions ---
+// Mirrors Parser::expression, keeping only the kind of each operand: that
+// is all the statement rules look at.
+bool Checker::expression(ExprKind* kind) {
+    ops.clear();
+    operands.clear();
+
+    auto reduce = [&] {
+        operands.pop_back();
+        operands.back() = ExprKind::Binary;
+        ops.pop_back();
+    };
+
+    while (true) {
+        // Prefixes, then an operand
+        bool parsed = false;
+        ExprKind operand = ExprKind::Int;
+        while (!parsed) {
+            if (match(TokenType::Minus) || match(TokenType::LeftParen)) {
+                ops.push_back(PendingOp{previous().type == TokenType::Minus ? negate : group, 0});
+                if (!checkDepth(ops.size())) return false;
+            } else if (check(TokenType::Identifier) && checkNext(TokenType::LeftParen)) {
+                advance();
+                advance();
+                if (match(TokenType::RightParen)) {
+                    operand = ExprKind::Call;
+                    parsed = true;
+                } else {
+                    ops.push_back(PendingOp{call, operands.size()});
+                    if (!checkDepth(ops.size())) return false;
+                }
+            } else if (match(TokenType::LeftBrace)) {
+                if (match(TokenType::RightBrace)) {
+                    operand = ExprKind::Map;
+                    parsed = true;
+                } else {
+                    ops.push_back(PendingOp{mapOpen, operands.size()});
+                    if (!checkDepth(ops.size())) return false;
+                }
+            } else {
+                if (!primary(operand)) return false;
+                parsed = true;
+            }
+        }
+        operands.push_back(operand);
+
+        while (true) {
+            if (match(TokenType::LeftBracket)) {
+                ops.push_back(PendingOp{subscript, 0});
+                if (!checkDepth(ops.size())) return false;
+                break;
+            }
+
+            while (!ops.empty() && ops.back().precedence == negate) {
+                operands.back() = ExprKind::Unary;
+                ops.pop_back();
+            }
+
+            int precedence = isAtEnd() ? 0 : Parser::binaryPrecedence(peek());
+            if (precedence > 0) {
+                while (!ops.empty() && ops.back().precedence >= precedence) reduce();
+                ops.push_back(PendingOp{precedence, 0});
+                advance();
+                break;
+            }
+
+            // No operator follows: the innermost bracket, or the expression, ends
+            while (!ops.empty() && ops.back().precedence > group) reduce();
+            if (ops.empty()) {
+                if (kind) *kind = operands.back();
+                operands.pop_back();
+                return true;
+            }
+
+            if (ops.back().precedence == group) {
+                if (!consume(TokenType::RightParen, "Expect ')' after expression.")) return false;
+                ops.pop_back();
+            } else if (ops.back().precedence == call) {
+                if (match(TokenType::Comma)) break;
+                if (!consume(TokenType::RightParen, "Expect ')' after arguments.")) return false;
+                operands.resize(ops.back().base);
+                operands.push_back(ExprKind::Call);
+                ops.pop_back();
+            } else if (ops.back().precedence == subscript) {
+                if (!consume(TokenType::RightBracket, "Expect ']' after index.")) return false;
+                operands.pop_back();
+                operands.back() = ExprKind::Index;
+                ops.pop_back();
+            } else {
+                size_t base = ops.back().base;
+                if ((operands.size() - base) % 2 == 1) {
+                    if (!consume(TokenType::Colon, "Expect ':' after map key.")) return false;
+                    break;
+                }
+                if (match(TokenType::Comma)) break;
+                if (!consume(TokenType::RightBrace, "Expect '}' after map entries.")) return false;
+                operands.resize(base);
+                operands.push_back(ExprKind::Map);
+                ops.pop_back();
+            }
+        }
+    }
+}
+
+// Number literals the Parser's std::stoi and std::stof would reject are
+// errors too
+bool Checker::primary(ExprKind& kind) {
+    if (match(TokenType::Integer)) {
+        errno = 0;
+        long long value = std::strtoll(previous().text.c_str(), nullptr, 10);
+        if (errno == ERANGE || value > INT_MAX) return fail(previous(), "Integer literal out of range.");
+        kind = ExprKind::Int;
+        return true;
+    }
+    if (match(TokenType::Float)) {
+        errno = 0;
+        std::strtof(previous().text.c_str(), nullptr);
+        if (errno == ERANGE) return fail(previous(), "Float literal out of range.");
+        kind = ExprKind::Float;
+        return true;
+    }
+    if (match(TokenType::Char)) kind = ExprKind::Char;
+    else if (match(TokenType::String)) kind = ExprKind::String;
+    else if (match(TokenType::Identifier)) kind = ExprKind::Variable;
+    else return fail(peek(), "Expected expression.");
+    return true;
+}
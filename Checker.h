@@ -0,0 +1,86 @@
+#ifndef CHECKER_H
+#define CHECKER_H
+
+#include "Token.h"
+#include "AST.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// One syntax error, as the Parser would report it
+struct Diagnostic {
+    int line;
+    std::string token;  // text of the token the error is at
+    std::string message;
+};
+
+// The syntax check behind --check. It accepts exactly the programs the
+// Parser accepts, but builds no tree and throws nothing: each rule returns
+// false after recording a Diagnostic, and the checker skips to the next
+// statement boundary and carries on, so one pass finds every independent
+// error. The first diagnostic is the one the Parser would throw.
+class Checker {
+public:
+    Checker(const std::vector<Token>& tokens, size_t maxDepth);
+
+    std::vector<Diagnostic> check();
+
+    // The diagnostics of each file, or a single line-0 diagnostic if it
+    // could not be read. Files are checked on `threads` threads.
+    struct FileReport {
+        std::string path;
+        std::vector<Diagnostic> diagnostics;
+    };
+    static std::vector<FileReport> checkFiles(const std::vector<std::string>& paths, unsigned threads, size_t maxDepth);
+
+private:
+    const std::vector<Token>& tokens;
+    size_t current = 0;
+    size_t maxDepth;
+    std::vector<Diagnostic> diagnostics;
+    const Token* lastFailed = nullptr;
+
+    bool fail(const Token& token, const std::string& message);
+    void synchronize(size_t depth = 0);
+    bool startsAssignment() const;
+
+    // --- Utility ---
+    bool isAtEnd() const { return tokens[current].type == TokenType::EndOfFile; }
+    const Token& peek() const { return tokens[current]; }
+    const Token& previous() const { return tokens[current - 1]; }
+    const Token& advance();
+    bool check(TokenType type) const { return !isAtEnd() && peek().type == type; }
+    bool checkNext(TokenType type) const { return current + 1 < tokens.size() && tokens[current + 1].type == type; }
+    bool match(TokenType type);
+    bool consume(TokenType type, const std::string& message);
+    bool checkDepth(size_t depth);
+
+    // --- Statements ---
+    // A compound statement whose body is still being checked
+    struct OpenStmt {
+        StmtKind kind;
+        bool thenDone;  // if: the then branch is complete
+    };
+    std::vector<OpenStmt> open;
+    size_t openBlocks = 0;  // Block entries in `open`, each owed a '}'
+    bool function = false;
+
+    void statement();
+    bool simpleStatement();
+    bool assignment();
+    bool header(StmtKind kind);
+    bool functionHeader();
+
+    // --- Expressions ---
+    struct PendingOp {
+        int precedence;
+        size_t base;
+    };
+    std::vector<PendingOp> ops;
+    std::vector<ExprKind> operands;  // only the kind of each parsed operand
+
+    bool expression(ExprKind* kind = nullptr);
+    bool primary(ExprKind& kind);
+};
+
+#endif // CHECKER_H
@@ -0,0 +1,429 @@
+#include "CppEmitter.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+// --- Runtime ---
+// Mirrors Operators.cpp for values whose type is only known at run time.
+static const char* runtimePrelude = R"(#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <variant>
+
+namespace rt {
+
+using Value = std::variant<int, float, char, std::string>;
+
+enum Op { Plus, Minus, Star, Slash, DoubleEqual, NotEqual, Less, LessEqual, Greater, GreaterEqual, Other };
+
+[[noreturn]] inline void fail(const std::string& message) { throw std::runtime_error(message); }
+
+inline Value binary(Op op, const char* text, const Value& left, const Value& right) {
+    return std::visit([&](const auto& l, const auto& r) -> Value {
+        using L = std::decay_t<decltype(l)>;
+        using R = std::decay_t<decltype(r)>;
+        if constexpr (std::is_arithmetic_v<L> && std::is_arithmetic_v<R>) {
+            switch (op) {
+                case Plus: return l + r;
+                case Minus: return l - r;
+                case Star: return l * r;
+                case Slash:
+                    if (r == 0) fail("Division by zero");
+                    return l / r;
+                case DoubleEqual: return static_cast<int>(l == r);
+                case NotEqual: return static_cast<int>(l != r);
+                case Less: return static_cast<int>(l < r);
+                case LessEqual: return static_cast<int>(l <= r);
+                case Greater: return static_cast<int>(l > r);
+                case GreaterEqual: return static_cast<int>(l >= r);
+                default: break;
+            }
+        } else if constexpr (std::is_same_v<L, std::string> && std::is_same_v<R, std::string>) {
+            if (op == Plus) return l + r;
+            if (op == DoubleEqual) return static_cast<int>(l == r);
+            if (op == NotEqual) return static_cast<int>(l != r);
+        }
+        fail(std::string("Unsupported binary operation: ") + text);
+    }, left, right);
+}
+
+inline Value unary(Op op, const char* text, const Value& operand) {
+    return std::visit([&](const auto& val) -> Value {
+        using T = std::decay_t<decltype(val)>;
+        if constexpr (std::is_arithmetic_v<T>) {
+            if (op == Minus) return -val;
+            if (op == Plus) return val;
+            if (std::string(text) == "!") return static_cast<int>(!val);
+        }
+        fail("Unsupported unary operation on type");
+    }, operand);
+}
+
+inline bool truthy(int v) { return v != 0; }
+inline bool truthy(float v) { return v != 0.0f; }
+inline bool truthy(char v) { return v != '\0'; }
+inline bool truthy(const std::string& v) { return !v.empty(); }
+inline bool truthy(const Value& v) {
+    return std::visit([](const auto& val) { return truthy(val); }, v);
+}
+
+template <typename T> inline T as(const Value& v) { return std::get<T>(v); }
+
+template <typename T> inline void print(const T& v) { std::cout << v << '\n'; }
+inline void print(const Value& v) {
+    std::visit([](const auto& val) { std::cout << val << '\n'; }, v);
+}
+
+} // namespace rt
+
+)";
+
+static const char* opName(TokenType type) {
+    switch (type) {
+        case TokenType::Plus: return "rt::Plus";
+        case TokenType::Minus: return "rt::Minus";
+        case TokenType::Star: return "rt::Star";
+        case TokenType::Slash: return "rt::Slash";
+        case TokenType::DoubleEqual: return "rt::DoubleEqual";
+        case TokenType::NotEqual: return "rt::NotEqual";
+        case TokenType::Less: return "rt::Less";
+        case TokenType::LessEqual: return "rt::LessEqual";
+        case TokenType::Greater: return "rt::Greater";
+        case TokenType::GreaterEqual: return "rt::GreaterEqual";
+        default: return "rt::Other";
+    }
+}
+
+static std::string quote(const std::string& text) {
+    std::ostringstream out;
+    out << '"';
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') out << '\\' << c;
+        else if (c >= 0x20 && c < 0x7f) out << c;
+        else {
+            char buffer[8];
+            std::snprintf(buffer, sizeof buffer, "\\%03o", c);
+            out << buffer;
+        }
+    }
+    out << '"';
+    return out.str();
+}
+
+// --- Types ---
+CppEmitter::Kind CppEmitter::kindOf(int value) {
+    const IRInstr& instr = program->values[value];
+    if (instr.op == IROp::Const) {
+        switch (instr.constant.index()) {
+            case 0: return Kind::Int;
+            case 1: return Kind::Float;
+            case 2: return Kind::Char;
+            default: return Kind::String;
+        }
+    }
+    if (types.maybeUndefined(value)) return Kind::Dynamic;
+    switch (types.of(value)) {
+        case IRTypes::Int: return Kind::Int;
+        case IRTypes::Float: return Kind::Float;
+        case IRTypes::Char: return Kind::Char;
+        case IRTypes::String: return Kind::String;
+        default: return Kind::Dynamic;
+    }
+}
+
+const char* CppEmitter::typeName(Kind kind) {
+    switch (kind) {
+        case Kind::Int: return "int";
+        case Kind::Float: return "float";
+        case Kind::Char: return "char";
+        case Kind::String: return "std::string";
+        case Kind::Dynamic: break;
+    }
+    return "rt::Value";
+}
+
+// --- Operands ---
+std::string CppEmitter::reg(int value) const {
+    if (program->values[value].op == IROp::Const) return literal(program->values[value].constant);
+    return "r" + std::to_string(value);
+}
+
+std::string CppEmitter::literal(const Value& value) const {
+    return std::visit([](const auto& val) -> std::string {
+        using T = std::decay_t<decltype(val)>;
+        if constexpr (std::is_same_v<T, int>) {
+            if (val == std::numeric_limits<int>::min()) return "(-2147483647 - 1)";
+            return std::to_string(val);
+        }
+        if constexpr (std::is_same_v<T, float>) {
+            if (std::isnan(val)) return "std::numeric_limits<float>::quiet_NaN()";
+            if (std::isinf(val)) return val > 0 ? "std::numeric_limits<float>::infinity()"
+                                                 : "(-std::numeric_limits<float>::infinity())";
+            char buffer[64];
+            std::snprintf(buffer, sizeof buffer, "%af", static_cast<double>(val));
+            return std::string("(") + buffer + ")";
+        }
+        if constexpr (std::is_same_v<T, char>) return "static_cast<char>(" + std::to_string(static_cast<int>(val)) + ")";
+        if constexpr (std::is_same_v<T, SharedString>) return "std::string(" + quote(val.str()) + ", " + std::to_string(val.size()) + ")";
+        return "";
+    }, value);
+}
+
+std::string CppEmitter::operand(int value, Kind wanted) {
+    const IRInstr& instr = program->values[value];
+    Kind kind = kindOf(value);
+    std::string text = instr.op == IROp::Const && kind == Kind::String ? "k" + std::to_string(value) : reg(value);
+
+    if (kind == wanted) return text;
+    if (wanted == Kind::Dynamic) return "rt::Value(" + text + ")";
+    if (kind == Kind::Dynamic) return std::string("rt::as<") + typeName(wanted) + ">(" + text + ")";
+    return std::string("rt::as<") + typeName(wanted) + ">(rt::Value(" + text + "))";
+}
+
+std::string CppEmitter::defined(int value) {
+    if (types.maybeUndefined(value) && program->values[value].op != IROp::Const) return "d" + std::to_string(value);
+    return "true";
+}
+
+// --- Emission ---
+void CppEmitter::emit(const IRProgram& prog, std::ostream& out) {
+    program = &prog;
+    types.compute(prog);
+
+    out << "// Generated by miniscript --emit-cpp\n" << runtimePrelude;
+
+    for (const auto& block : program->blocks) {
+        if (block.removed) continue;
+        for (int id : block.body) {
+            const IRInstr& instr = program->values[id];
+            if (instr.op == IROp::Const && instr.constant.index() == 3)
+                out << "static const std::string k" << id << " = " << literal(instr.constant) << ";\n";
+        }
+    }
+
+    out << "\nint main() {\n"
+        << "    std::ios::sync_with_stdio(false);\n"
+        << "    try {\n";
+
+    for (const auto& block : program->blocks) {
+        if (block.removed) continue;
+        auto declare = [&](int id) {
+            const IRInstr& instr = program->values[id];
+            if (instr.op == IROp::Const || instr.op == IROp::Print) return;
+            Kind kind = kindOf(id);
+            out << "        " << typeName(kind) << " r" << id;
+            out << (kind == Kind::Dynamic || kind == Kind::String ? "" : " = 0") << ";\n";
+            if (types.maybeUndefined(id)) out << "        bool d" << id << " = false;\n";
+        };
+        for (int id : block.phis) declare(id);
+        for (int id : block.body) declare(id);
+    }
+
+    out << "        goto bb" << program->entry << ";\n";
+
+    for (size_t b = 0; b < program->blocks.size(); ++b) {
+        const IRBlock& block = program->blocks[b];
+        if (block.removed) continue;
+
+        out << "    bb" << b << ":\n";
+        for (int id : block.body) emitInstr(id, out);
+
+        switch (block.term) {
+            case IRTerm::Jump:
+                emitEdge(static_cast<int>(b), block.succs[0], out);
+                break;
+            case IRTerm::Branch:
+                out << "        if (rt::truthy(" << operand(block.cond, kindOf(block.cond)) << ")) {\n";
+                emitEdge(static_cast<int>(b), block.succs[0], out);
+                out << "        } else {\n";
+                emitEdge(static_cast<int>(b), block.succs[1], out);
+                out << "        }\n";
+                break;
+            case IRTerm::Exit:
+            case IRTerm::None:
+                out << "        goto done;\n";
+                break;
+        }
+    }
+
+    out << "    done:;\n"
+        << "    } catch (const std::runtime_error& e) {\n"
+        << "        std::cout.flush();\n"
+        << "        std::cerr << \"Runtime error: \" << e.what() << std::endl;\n"
+        << "    }\n"
+        << "    std::cout.flush();\n"
+        << "    return 0;\n"
+        << "}\n";
+}
+
+void CppEmitter::emitEdge(int from, int to, std::ostream& out) {
+    const IRBlock& target = program->blocks[to];
+    if (!target.phis.empty()) {
+        size_t edge = 0;
+        while (target.preds[edge] != from) ++edge;
+
+        // Parallel copy: read every incoming value before writing any phi
+        out << "        {\n";
+        for (size_t i = 0; i < target.phis.size(); ++i) {
+            int phi = target.phis[i];
+            int source = program->values[phi].operands[edge];
+            out << "            " << typeName(kindOf(phi)) << " t" << i << " = " << operand(source, kindOf(phi)) << ";\n";
+            if (types.maybeUndefined(phi)) out << "            bool u" << i << " = " << defined(source) << ";\n";
+        }
+        for (size_t i = 0; i < target.phis.size(); ++i) {
+            int phi = target.phis[i];
+            out << "            r" << phi << " = std::move(t" << i << ");\n";
+            if (types.maybeUndefined(phi)) out << "            d" << phi << " = u" << i << ";\n";
+        }
+        out << "        }\n";
+    }
+    out << "        goto bb" << to << ";\n";
+}
+
+void CppEmitter::emitInstr(int id, std::ostream& out) {
+    const IRInstr& instr = program->values[id];
+    std::string r = "r" + std::to_string(id);
+
+    switch (instr.op) {
+        case IROp::Const:
+        case IROp::Phi:
+            break;
+        case IROp::Undef:
+            out << "        d" << id << " = false;\n";
+            break;
+        case IROp::Check: {
+            int source = instr.operands[0];
+            if (types.maybeUndefined(source))
+                out << "        if (!" << defined(source) << ") rt::fail(" << quote("Undefined variable: " + instr.name.str()) << ");\n";
+            out << "        " << r << " = " << operand(source, kindOf(id)) << ";\n";
+            break;
+        }
+        case IROp::Binary:
+            emitBinary(id, instr, out);
+            break;
+        case IROp::Unary: {
+            int source = instr.operands[0];
+            Kind kind = kindOf(source);
+            bool arithmetic = kind == Kind::Int || kind == Kind::Float || kind == Kind::Char;
+            std::string expr;
+            if (arithmetic && instr.opToken.type == TokenType::Minus) expr = "-" + operand(source, kind);
+            else if (arithmetic && instr.opToken.type == TokenType::Plus) expr = operand(source, kind);
+            else if (arithmetic && instr.opToken.text == "!") expr = "static_cast<int>(!" + operand(source, kind) + ")";
+            else if (kind == Kind::String) {
+                out << "        rt::fail(\"Unsupported unary operation on type\");\n";
+                break;
+            } else {
+                out << "        " << r << " = " << (kindOf(id) == Kind::Dynamic ? "" : std::string("rt::as<") + typeName(kindOf(id)) + ">(")
+                    << "rt::unary(" << opName(instr.opToken.type) << ", " << quote(instr.opToken.text) << ", "
+                    << operand(source, Kind::Dynamic) << ")" << (kindOf(id) == Kind::Dynamic ? "" : ")") << ";\n";
+                break;
+            }
+            out << "        " << r << " = " << (kindOf(id) == Kind::Dynamic ? "rt::Value(" + expr + ")" : expr) << ";\n";
+            break;
+        }
+        case IROp::Print: {
+            int source = instr.operands[0];
+            out << "        rt::print(" << operand(source, kindOf(source)) << ");\n";
+            break;
+        }
+    }
+}
+
+void CppEmitter::emitBinary(int id, const IRInstr& instr, std::ostream& out) {
+    int left = instr.operands[0];
+    int right = instr.operands[1];
+    Kind lk = kindOf(left);
+    Kind rk = kindOf(right);
+    Kind result = kindOf(id);
+    std::string r = "r" + std::to_string(id);
+    TokenType op = instr.opToken.type;
+
+    auto isArithmetic = [](Kind k) { return k == Kind::Int || k == Kind::Float || k == Kind::Char; };
+    auto assign = [&](const std::string& expr) {
+        out << "        " << r << " = " << (result == Kind::Dynamic ? "rt::Value(" + expr + ")" : expr) << ";\n";
+    };
+    std::string unsupported = "        rt::fail(" + quote("Unsupported binary operation: " + instr.opToken.text) + ");\n";
+
+    if (isArithmetic(lk) && isArithmetic(rk)) {
+        std::string l = operand(left, lk);
+        std::string rr = operand(right, rk);
+        switch (op) {
+            case TokenType::Plus: assign(l + " + " + rr); return;
+            case TokenType::Minus: assign(l + " - " + rr); return;
+            case TokenType::Star: assign(l + " * " + rr); return;
+            case TokenType::Slash:
+                out << "        if (" << rr << " == 0) rt::fail(\"Division by zero\");\n";
+                assign(l + " / " + rr);
+                return;
+            case TokenType::DoubleEqual: assign("static_cast<int>(" + l + " == " + rr + ")"); return;
+            case TokenType::NotEqual: assign("static_cast<int>(" + l + " != " + rr + ")"); return;
+            case TokenType::Less: assign("static_cast<int>(" + l + " < " + rr + ")"); return;
+            case TokenType::LessEqual: assign("static_cast<int>(" + l + " <= " + rr + ")"); return;
+            case TokenType::Greater: assign("static_cast<int>(" + l + " > " + rr + ")"); return;
+            case TokenType::GreaterEqual: assign("static_cast<int>(" + l + " >= " + rr + ")"); return;
+            default: out << unsupported; return;
+        }
+    }
+
+    if (lk == Kind::String && rk == Kind::String) {
+        std::string l = operand(left, lk);
+        std::string rr = operand(right, rk);
+        switch (op) {
+            case TokenType::Plus: assign(l + " + " + rr); return;
+            case TokenType::DoubleEqual: assign("static_cast<int>(" + l + " == " + rr + ")"); return;
+            case TokenType::NotEqual: assign("static_cast<int>(" + l + " != " + rr + ")"); return;
+            default: out << unsupported; return;
+        }
+    }
+
+    if (lk != Kind::Dynamic && rk != Kind::Dynamic) {
+        out << unsupported;
+        return;
+    }
+
+    std::string call = std::string("rt::binary(") + opName(op) + ", " + quote(instr.opToken.text) + ", " +
+                       operand(left, Kind::Dynamic) + ", " + operand(right, Kind::Dynamic) + ")";
+    if (result == Kind::Dynamic) out << "        " << r << " = " << call << ";\n";
+    else out << "        " << r << " = rt::as<" << typeName(result) << ">(" << call << ");\n";
+}
+
+// --- Compilation ---
+static std::string shellQuote(const std::string& text) {
+    std::string quoted = "'";
+    for (char c : text) {
+        if (c == '\'') quoted += "'\\''";
+        else quoted += c;
+    }
+    return quoted + "'";
+}
+
+bool CppEmitter::compile(const std::string& source, const std::string& output, std::string& error) {
+    char path[] = "/tmp/miniscript-XXXXXX.cpp";
+    int fd = mkstemps(path, 4);
+    if (fd < 0) {
+        error = "Could not create temporary file";
+        return false;
+    }
+    close(fd);
+
+    std::ofstream file(path);
+    file << source;
+    file.close();
+
+    const char* cxx = std::getenv("CXX");
+    std::string command = std::string(cxx && *cxx ? cxx : "g++") + " -std=c++17 -O2 -fwrapv -w -o " +
+                          shellQuote(output) + " " + shellQuote(path);
+    int status = std::system(command.c_str());
+    std::remove(path);
+
+    if (status != 0) {
+        error = "C++ compiler failed: " + command;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,41 @@
+#ifndef CPP_EMITTER_H
+#define CPP_EMITTER_H
+
+#include "IR.h"
+#include "IRTypes.h"
+#include <ostream>
+#include <string>
+
+// Generates a standalone C++ program from an SSA program. Values whose type
+// is statically known become native C++ variables; the rest use a small
+// variant runtime, emitted alongside, that mirrors Operators.cpp exactly.
+// Control flow is lowered to labels and gotos, and phis to parallel copies
+// on each edge.
+class CppEmitter {
+public:
+    void emit(const IRProgram& program, std::ostream& out);
+
+    // Compiles generated source with the system C++ compiler ($CXX, or g++).
+    // Returns false and fills `error` on failure.
+    static bool compile(const std::string& source, const std::string& output, std::string& error);
+
+private:
+    enum class Kind { Dynamic, Int, Float, Char, String };
+
+    const IRProgram* program = nullptr;
+    IRTypes types;
+
+    Kind kindOf(int value);
+    static const char* typeName(Kind kind);
+
+    std::string reg(int value) const;
+    std::string literal(const Value& value) const;
+    std::string operand(int value, Kind wanted);
+    std::string defined(int value);
+
+    void emitInstr(int id, std::ostream& out);
+    void emitBinary(int id, const IRInstr& instr, std::ostream& out);
+    void emitEdge(int from, int to, std::ostream& out);
+};
+
+#endif // CPP_EMITTER_H
@@ -5,26 +5,68 @@ Environment::Environment() {
     scopes.emplace_back();
 }
 
-void Environment::set(const std::string& name, Value value) {
+void Environment::set(const SharedString& name, Value value) {
     if (scopes.empty()) throw std::runtime_error("No scope to define variable in.");
-    scopes.back()[name] = value;
+    if (accessLog && scopes.size() == 1) accessLog->write(name, value);
+    scopes.back()[name] = std::move(value);
 }
 
-Value Environment::get(const std::string& name) const {
+Value Environment::get(const SharedString& name) const {
     for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
         auto found = it->find(name);
-        if (found != it->end()) return found->second;
+        if (found != it->end()) {
+            if (accessLog && it + 1 == scopes.rend()) accessLog->read(name, &found->second);
+            return found->second;
+        }
     }
-    throw std::runtime_error("Variable not found: " + name);
+    if (accessLog) accessLog->read(name, nullptr);
+    throw std::runtime_error("Variable not found: " + name.str());
 }
 
-bool Environment::exists(const std::string& name) const {
+const Value* Environment::find(const SharedString& name) const {
     for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
-        if (it->count(name)) return true;
+        auto found = it->find(name);
+        if (found != it->end()) {
+            if (accessLog && it + 1 == scopes.rend()) accessLog->read(name, &found->second);
+            return &found->second;
+        }
+    }
+    if (accessLog) accessLog->read(name, nullptr);
+    return nullptr;
+}
+
+const Value* Environment::findGlobal(const SharedString& name) const {
+    auto found = scopes.front().find(name);
+    const Value* value = found != scopes.front().end() ? &found->second : nullptr;
+    if (accessLog) accessLog->read(name, value);
+    return value;
+}
+
+bool Environment::exists(const SharedString& name) const {
+    for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
+        auto found = it->find(name);
+        if (found != it->end()) {
+            if (accessLog && it + 1 == scopes.rend()) accessLog->read(name, &found->second);
+            return true;
+        }
     }
+    if (accessLog) accessLog->read(name, nullptr);
     return false;
 }
 
+bool Environment::isLocal(const SharedString& name) const {
+    if (scopes.empty()) return false;
+    auto found = scopes.back().find(name);
+    if (accessLog && scopes.size() == 1) accessLog->read(name, found != scopes.back().end() ? &found->second : nullptr);
+    return found != scopes.back().end();
+}
+
+Value* Environment::innermost(const SharedString& name) {
+    if (accessLog || scopes.empty()) return nullptr;
+    auto found = scopes.back().find(name);
+    return found != scopes.back().end() ? &found->second : nullptr;
+}
+
 void Environment::pushScope() {
     scopes.emplace_back();
 }
@@ -33,3 +75,15 @@ void Environment::popScope() {
     if (scopes.empty()) throw std::runtime_error("No scope to pop.");
     scopes.pop_back();
 }
+
+// --- Access Log ---
+void AccessLog::read(const SharedString& name, const Value* value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (writes.count(name) || reads.count(name)) return;
+    reads.emplace(name, value ? std::optional<Value>(*value) : std::nullopt);
+}
+
+void AccessLog::write(const SharedString& name, const Value& value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    writes[name] = value;
+}
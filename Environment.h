@@ -1,30 +1,59 @@
 #ifndef ENVIRONMENT_H
 #define ENVIRONMENT_H
 
+#include "SharedString.h"
+#include "Value.h"
+#include <mutex>
+#include <optional>
 #include <unordered_map>
 #include <string>
 #include <variant>
 #include <vector>
 #include <stdexcept>
 
-// Expanded Value type to match Interpreter's usage
-using Value = std::variant<int, float, char, std::string>;
+// Global variables a statement read (with the value it first saw, or nullopt
+// if undefined) and wrote, for incremental re-execution. Reads of a name the
+// statement already wrote are not inputs and are skipped.
+struct AccessLog {
+    std::mutex mutex;  // parallel loop workers share the log
+    std::unordered_map<SharedString, std::optional<Value>, SharedStringHash> reads;
+    std::unordered_map<SharedString, Value, SharedStringHash> writes;
+
+    void read(const SharedString& name, const Value* value);
+    void write(const SharedString& name, const Value& value);
+};
 
 class Environment {
 public:
     Environment();
 
     // Variable management
-    void set(const std::string& name, Value value);
-    Value get(const std::string& name) const;
-    bool exists(const std::string& name) const;
+    // Names are interned identifiers, so lookups hash and compare by pointer.
+    void set(const SharedString& name, Value value);
+    Value get(const SharedString& name) const;
+    const Value* find(const SharedString& name) const;  // nullptr if undefined
+    const Value* findGlobal(const SharedString& name) const;  // outermost scope only
+    bool exists(const SharedString& name) const;
+    bool isLocal(const SharedString& name) const;  // defined in the innermost scope
+
+    // The variable, if the innermost scope defines it and accesses are not
+    // being logged, for updating in place
+    Value* innermost(const SharedString& name);
+
+    // Record global accesses into `log` (nullptr to stop). Copies of the
+    // environment keep recording into the same log.
+    void setAccessLog(AccessLog* log) { accessLog = log; }
+
+    // Variables of the outermost scope
+    const std::unordered_map<SharedString, Value, SharedStringHash>& globals() const { return scopes.front(); }
 
     // Scope control
     void pushScope();
     void popScope();
 
 private:
-    std::vector<std::unordered_map<std::string, Value>> scopes;
+    std::vector<std::unordered_map<SharedString, Value, SharedStringHash>> scopes;
+    AccessLog* accessLog = nullptr;
 };
 
 #endif // ENVIRONMENT_H
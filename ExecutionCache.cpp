@@ -0,0 +1,340 @@
+#include "ExecutionCache.h"
+#include "Parser.h"
+#include "RecursionGuard.h"
+#include "Utils.h"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+const char magic[4] = {'M', 'S', 'I', 'C'};
+const uint32_t formatVersion = 2;
+
+// --- Fingerprints ---
+void put(std::string& out, const void* bytes, size_t length) {
+    out.append(static_cast<const char*>(bytes), length);
+}
+
+void putText(std::string& out, std::string_view text) {
+    uint32_t length = static_cast<uint32_t>(text.size());
+    put(out, &length, sizeof length);
+    out.append(text);
+}
+
+void describe(const Expr* expr, std::string& out) {
+    RecursionGuard guard;
+    if (auto intExpr = dynamic_cast<const IntExpr*>(expr)) {
+        out += 'i';
+        put(out, &intExpr->value, sizeof intExpr->value);
+    } else if (auto floatExpr = dynamic_cast<const FloatExpr*>(expr)) {
+        out += 'f';
+        put(out, &floatExpr->value, sizeof floatExpr->value);
+    } else if (auto charExpr = dynamic_cast<const CharExpr*>(expr)) {
+        out += 'c';
+        out += charExpr->value;
+    } else if (auto stringExpr = dynamic_cast<const StringExpr*>(expr)) {
+        out += 's';
+        putText(out, stringExpr->value.view());
+    } else if (auto var = dynamic_cast<const VariableExpr*>(expr)) {
+        out += var->local == scope::global ? 'g' : 'v';
+        putText(out, var->name.view());
+    } else if (auto bin = dynamic_cast<const BinaryExpr*>(expr)) {
+        out += 'b';
+        putText(out, bin->op.text);
+        describe(bin->left.get(), out);
+        describe(bin->right.get(), out);
+    } else if (auto unary = dynamic_cast<const UnaryExpr*>(expr)) {
+        out += 'u';
+        putText(out, unary->op.text);
+        describe(unary->right.get(), out);
+    } else if (auto mapExpr = dynamic_cast<const MapExpr*>(expr)) {
+        out += 'm';
+        uint32_t count = static_cast<uint32_t>(mapExpr->keys.size());
+        put(out, &count, sizeof count);
+        for (size_t i = 0; i < mapExpr->keys.size(); ++i) {
+            describe(mapExpr->keys[i].get(), out);
+            describe(mapExpr->values[i].get(), out);
+        }
+    } else if (auto index = dynamic_cast<const IndexExpr*>(expr)) {
+        out += 'x';
+        describe(index->object.get(), out);
+        describe(index->index.get(), out);
+    } else if (auto call = dynamic_cast<const CallExpr*>(expr)) {
+        out += 'k';
+        putText(out, call->name.view());
+        uint32_t count = static_cast<uint32_t>(call->args.size());
+        put(out, &count, sizeof count);
+        for (const auto& arg : call->args) describe(arg.get(), out);
+    } else {
+        out += '_';
+    }
+}
+
+void describe(const Stmt* stmt, std::string& out) {
+    RecursionGuard guard;
+    if (!stmt) {
+        out += '_';
+    } else if (auto printStmt = dynamic_cast<const PrintStmt*>(stmt)) {
+        out += 'P';
+        describe(printStmt->expression.get(), out);
+    } else if (auto assignStmt = dynamic_cast<const AssignStmt*>(stmt)) {
+        out += 'A';
+        putText(out, assignStmt->name.view());
+        describe(assignStmt->value.get(), out);
+    } else if (auto ifStmt = dynamic_cast<const IfStmt*>(stmt)) {
+        out += 'I';
+        describe(ifStmt->condition.get(), out);
+        describe(ifStmt->thenBranch.get(), out);
+        describe(ifStmt->elseBranch.get(), out);
+    } else if (auto whileStmt = dynamic_cast<const WhileStmt*>(stmt)) {
+        out += 'W';
+        describe(whileStmt->condition.get(), out);
+        describe(whileStmt->body.get(), out);
+    } else if (auto forStmt = dynamic_cast<const ForStmt*>(stmt)) {
+        out += 'F';
+        describe(forStmt->initializer.get(), out);
+        if (forStmt->condition) describe(forStmt->condition.get(), out);
+        else out += '_';
+        describe(forStmt->increment.get(), out);
+        describe(forStmt->body.get(), out);
+    } else if (auto lazy = dynamic_cast<const LazyBlockStmt*>(stmt)) {
+        // By its tokens, so that fingerprinting does not parse it
+        out += 'L';
+        const std::vector<Token>& tokens = *lazy->source->tokens;
+        for (size_t i = lazy->begin; i <= lazy->source->closing[lazy->begin]; ++i) putText(out, tokens[i].text);
+    } else if (auto blockStmt = dynamic_cast<const BlockStmt*>(stmt)) {
+        out += 'B';
+        uint32_t count = static_cast<uint32_t>(blockStmt->statements.size());
+        put(out, &count, sizeof count);
+        for (const auto& s : blockStmt->statements) describe(s.get(), out);
+    } else if (dynamic_cast<const BreakStmt*>(stmt)) {
+        out += 'K';
+    } else if (dynamic_cast<const ContinueStmt*>(stmt)) {
+        out += 'C';
+    } else if (auto assign = dynamic_cast<const IndexAssignStmt*>(stmt)) {
+        out += 'X';
+        describe(assign->object.get(), out);
+        describe(assign->index.get(), out);
+        describe(assign->value.get(), out);
+    } else if (auto removeStmt = dynamic_cast<const RemoveStmt*>(stmt)) {
+        out += 'R';
+        describe(removeStmt->object.get(), out);
+        describe(removeStmt->index.get(), out);
+    } else if (auto forIn = dynamic_cast<const ForInStmt*>(stmt)) {
+        out += 'E';
+        putText(out, forIn->name.view());
+        describe(forIn->map.get(), out);
+        describe(forIn->body.get(), out);
+    } else {
+        out += '?';
+    }
+}
+
+bool sameValue(const Value& a, const Value& b) {
+    if (a.index() != b.index()) return false;
+    if (auto fa = std::get_if<float>(&a)) return std::memcmp(fa, &std::get<float>(b), sizeof(float)) == 0;
+    return a == b;
+}
+
+// --- Encoding ---
+void putValue(std::string& out, const std::optional<Value>& value) {
+    if (!value) {
+        out += static_cast<char>(0xff);
+        return;
+    }
+    out += static_cast<char>(value->index());
+    std::visit([&](const auto& val) {
+        using T = std::decay_t<decltype(val)>;
+        if constexpr (std::is_same_v<T, SharedString>) putText(out, val.view());
+        else put(out, &val, sizeof val);
+    }, *value);
+}
+
+class Reader {
+public:
+    Reader(const std::string& data) : data(data) {}
+
+    bool bytes(void* out, size_t length) {
+        if (data.size() - pos < length) return false;
+        std::memcpy(out, data.data() + pos, length);
+        pos += length;
+        return true;
+    }
+
+    bool text(std::string_view& out) {
+        uint32_t length;
+        if (!bytes(&length, sizeof length) || data.size() - pos < length) return false;
+        out = std::string_view(data.data() + pos, length);
+        pos += length;
+        return true;
+    }
+
+    bool name(SharedString& out) {
+        std::string_view view;
+        if (!text(view)) return false;
+        out = StringTable::global().intern(view);
+        return true;
+    }
+
+    bool value(std::optional<Value>& out) {
+        unsigned char tag;
+        if (!bytes(&tag, 1)) return false;
+        switch (tag) {
+            case 0xff: out.reset(); return true;
+            case 0: { int v; if (!bytes(&v, sizeof v)) return false; out = v; return true; }
+            case 1: { float v; if (!bytes(&v, sizeof v)) return false; out = v; return true; }
+            case 2: { char v; if (!bytes(&v, sizeof v)) return false; out = v; return true; }
+            case 3: {
+                std::string_view view;
+                if (!text(view)) return false;
+                out = SharedString(view);
+                return true;
+            }
+            default: return false;
+        }
+    }
+
+    bool done() const { return pos == data.size(); }
+
+private:
+    const std::string& data;
+    size_t pos = 0;
+};
+
+} // namespace
+
+std::string ExecutionCache::describe(const Stmt* stmt) {
+    std::string description;
+    ::describe(stmt, description);
+    return description;
+}
+
+uint64_t ExecutionCache::fingerprint(const std::string& description) {
+    return SharedString::hashBytes(description.data(), description.size());
+}
+
+// --- Lookup ---
+const ExecutionCache::Entry* ExecutionCache::lookup(uint64_t key, const std::string& description,
+                                                    const Environment& env) {
+    auto found = previous.find(key);
+    if (found == previous.end()) {
+        ++misses;
+        return nullptr;
+    }
+
+    for (auto& entry : found->second) {
+        if (entry.description != description) continue;  // a hash collision
+        bool valid = true;
+        for (const auto& [name, value] : entry.reads) {
+            bool defined = env.exists(name);
+            valid = value ? defined && sameValue(env.get(name), *value) : !defined;
+            if (!valid) break;
+        }
+        if (valid) {
+            ++hits;
+            current.push_back(entry);
+            return &current.back();
+        }
+    }
+    ++misses;
+    return nullptr;
+}
+
+void ExecutionCache::record(uint64_t key, std::string description, const AccessLog& log, const std::string& output) {
+    // Maps are shared and mutable: a statement that saw one may have changed
+    // it, which the log cannot capture, so such statements always re-run
+    auto isMap = [](const Value& value) { return std::holds_alternative<MapRef>(value); };
+    for (const auto& read : log.reads)
+        if (read.second && isMap(*read.second)) return;
+    for (const auto& write : log.writes)
+        if (isMap(write.second)) return;
+
+    Entry entry;
+    entry.key = key;
+    entry.description = std::move(description);
+    entry.reads.assign(log.reads.begin(), log.reads.end());
+    entry.writes.assign(log.writes.begin(), log.writes.end());
+    entry.output = output;
+    current.push_back(std::move(entry));
+}
+
+// --- Persistence ---
+void ExecutionCache::load(const std::string& path) {
+    previous.clear();
+    current.clear();
+
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return;
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    Reader reader(data);
+
+    char header[4];
+    uint32_t version;
+    uint64_t count;
+    if (!reader.bytes(header, sizeof header) || std::memcmp(header, magic, sizeof magic) != 0 ||
+        !reader.bytes(&version, sizeof version) || version != formatVersion || !reader.bytes(&count, sizeof count))
+        return;
+
+    std::unordered_map<uint64_t, std::vector<Entry>> loaded;
+    for (uint64_t i = 0; i < count; ++i) {
+        Entry entry;
+        uint32_t reads, writes;
+        std::string_view description;
+        if (!reader.bytes(&entry.key, sizeof entry.key) || !reader.text(description) ||
+            !reader.bytes(&reads, sizeof reads))
+            return;
+        entry.description = std::string(description);
+        for (uint32_t r = 0; r < reads; ++r) {
+            SharedString name;
+            std::optional<Value> value;
+            if (!reader.name(name) || !reader.value(value)) return;
+            entry.reads.emplace_back(name, std::move(value));
+        }
+        if (!reader.bytes(&writes, sizeof writes)) return;
+        for (uint32_t w = 0; w < writes; ++w) {
+            SharedString name;
+            std::optional<Value> value;
+            if (!reader.name(name) || !reader.value(value) || !value) return;
+            entry.writes.emplace_back(name, std::move(*value));
+        }
+        std::string_view output;
+        if (!reader.text(output)) return;
+        entry.output = std::string(output);
+        loaded[entry.key].push_back(std::move(entry));
+    }
+    if (reader.done()) previous = std::move(loaded);
+}
+
+bool ExecutionCache::save(const std::string& path) const {
+    std::string out(magic, sizeof magic);
+    put(out, &formatVersion, sizeof formatVersion);
+    uint64_t count = current.size();
+    put(out, &count, sizeof count);
+
+    for (const auto& entry : current) {
+        put(out, &entry.key, sizeof entry.key);
+        putText(out, entry.description);
+        uint32_t reads = static_cast<uint32_t>(entry.reads.size());
+        put(out, &reads, sizeof reads);
+        for (const auto& [name, value] : entry.reads) {
+            putText(out, name.view());
+            putValue(out, value);
+        }
+        uint32_t writes = static_cast<uint32_t>(entry.writes.size());
+        put(out, &writes, sizeof writes);
+        for (const auto& [name, value] : entry.writes) {
+            putText(out, name.view());
+            putValue(out, value);
+        }
+        putText(out, entry.output);
+    }
+
+    // Never in place, so a crash never leaves a torn cache
+    try {
+        write_atomically(path, out);
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+    return true;
+}
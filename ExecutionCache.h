@@ -0,0 +1,61 @@
+#ifndef EXECUTION_CACHE_H
+#define EXECUTION_CACHE_H
+
+#include "AST.h"
+#include "Environment.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Memoized results of top-level statements, persisted between runs.
+//
+// An entry is keyed by a hash of the statement's structural description,
+// keeps the description itself to confirm a key match (as ProgramCache keeps
+// the source), and records the global variables it read (and the values it
+// saw), the globals it wrote (final values) and the output it printed. A
+// later run may reuse an entry when the statement is unchanged and every
+// recorded input still has the same value; otherwise the statement runs
+// again and its new entry replaces the old one. Statements downstream of a
+// changed input see different values and re-run in turn, so only the
+// affected part of a script executes.
+class ExecutionCache {
+public:
+    struct Entry {
+        uint64_t key = 0;
+        std::string description;
+        std::vector<std::pair<SharedString, std::optional<Value>>> reads;
+        std::vector<std::pair<SharedString, Value>> writes;
+        std::string output;
+    };
+
+    // Loads entries saved by a previous run. A missing, stale or damaged file
+    // just means an empty cache.
+    void load(const std::string& path);
+
+    // Writes the entries used or recorded since load(). Returns false if the
+    // file could not be written.
+    bool save(const std::string& path) const;
+
+    // The statement's structure as bytes, and the key of that description
+    static std::string describe(const Stmt* stmt);
+    static uint64_t fingerprint(const std::string& description);
+
+    // An entry for this statement whose inputs all match `env`, or nullptr.
+    const Entry* lookup(uint64_t key, const std::string& description, const Environment& env);
+
+    // Statements that read or wrote a map are not recorded, and the
+    // interpreter does not record statements that called an impure function.
+    void record(uint64_t key, std::string description, const AccessLog& log, const std::string& output);
+
+    size_t reused() const { return hits; }
+    size_t executed() const { return misses; }
+
+private:
+    std::unordered_map<uint64_t, std::vector<Entry>> previous;
+    std::vector<Entry> current;
+    size_t hits = 0;
+    size_t misses = 0;
+};
+
+#endif // EXECUTION_CACHE_H
@@ -0,0 +1,164 @@
+#include "Fuser.h"
+
+namespace {
+
+bool isComparison(TokenType type) {
+    return type == TokenType::Less || type == TokenType::LessEqual || type == TokenType::Greater ||
+           type == TokenType::GreaterEqual || type == TokenType::DoubleEqual || type == TokenType::NotEqual;
+}
+
+// `expr` reads the variable that `assign` writes
+bool readsTarget(const Expr* expr, const AssignStmt* assign) {
+    if (expr->kind != ExprKind::Variable) return false;
+    auto var = static_cast<const VariableExpr*>(expr);
+    return var->name == assign->name && var->local == assign->local;
+}
+
+// The fused form of an assignment, or nullptr
+std::unique_ptr<Stmt> fuse(AssignStmt* assign) {
+    if (assign->value->kind != ExprKind::Binary) return nullptr;
+    auto bin = static_cast<const BinaryExpr*>(assign->value.get());
+    if (!readsTarget(bin->left.get(), assign)) return nullptr;
+
+    std::unique_ptr<AssignStmt> fused;
+    TokenType op = bin->op.type;
+    if ((op == TokenType::Plus || op == TokenType::Minus) && bin->right->kind == ExprKind::Int)
+        fused = std::make_unique<IncrementStmt>(assign->name, std::move(assign->value));
+    else if (op == TokenType::Plus && bin->right->kind == ExprKind::String)
+        fused = std::make_unique<AppendStmt>(assign->name, std::move(assign->value));
+    else
+        return nullptr;
+    fused->local = assign->local;
+    fused->line = assign->line;
+    return fused;
+}
+
+// The fused form of an expression, or nullptr
+std::unique_ptr<Expr> fuse(BinaryExpr* bin) {
+    if (!isComparison(bin->op.type) || bin->left->kind != ExprKind::Variable || bin->right->kind != ExprKind::Int)
+        return nullptr;
+    return std::make_unique<CompareConstExpr>(std::move(bin->left), bin->op, std::move(bin->right));
+}
+
+} // namespace
+
+size_t Fuser::run(std::vector<std::unique_ptr<Stmt>>& program) {
+    size_t fused = 0;
+    for (auto& stmt : program) fused += rewrite(stmt);
+    return fused;
+}
+
+// Visits every node below `root` with explicit stacks, since the program
+// may be nested far deeper than the machine stack allows
+size_t Fuser::rewrite(std::unique_ptr<Stmt>& root) {
+    size_t fused = 0;
+    std::vector<std::unique_ptr<Stmt>*> stmts{&root};
+    std::vector<std::unique_ptr<Expr>*> exprs;
+    auto addStmt = [&](std::unique_ptr<Stmt>& stmt) {
+        if (stmt) stmts.push_back(&stmt);
+    };
+    auto addExpr = [&](std::unique_ptr<Expr>& expr) {
+        if (expr) exprs.push_back(&expr);
+    };
+
+    while (!stmts.empty()) {
+        std::unique_ptr<Stmt>& slot = *stmts.back();
+        stmts.pop_back();
+        Stmt* stmt = slot.get();
+        switch (stmt->kind) {
+            case StmtKind::Print: addExpr(static_cast<PrintStmt*>(stmt)->expression); break;
+            case StmtKind::Assign: {
+                if (auto replacement = fuse(static_cast<AssignStmt*>(stmt))) {
+                    slot = std::move(replacement);
+                    ++fused;
+                    break;
+                }
+                addExpr(static_cast<AssignStmt*>(stmt)->value);
+                break;
+            }
+            case StmtKind::If: {
+                auto ifStmt = static_cast<IfStmt*>(stmt);
+                addExpr(ifStmt->condition);
+                addStmt(ifStmt->thenBranch);
+                addStmt(ifStmt->elseBranch);
+                break;
+            }
+            case StmtKind::While: {
+                auto whileStmt = static_cast<WhileStmt*>(stmt);
+                addExpr(whileStmt->condition);
+                addStmt(whileStmt->body);
+                break;
+            }
+            case StmtKind::For: {
+                auto forStmt = static_cast<ForStmt*>(stmt);
+                addStmt(forStmt->initializer);
+                addExpr(forStmt->condition);
+                addStmt(forStmt->increment);
+                addStmt(forStmt->body);
+                break;
+            }
+            case StmtKind::Block:
+                for (auto& child : static_cast<BlockStmt*>(stmt)->statements) addStmt(child);
+                break;
+            case StmtKind::IndexAssign: {
+                auto assign = static_cast<IndexAssignStmt*>(stmt);
+                addExpr(assign->object);
+                addExpr(assign->index);
+                addExpr(assign->value);
+                break;
+            }
+            case StmtKind::Remove: {
+                auto removeStmt = static_cast<RemoveStmt*>(stmt);
+                addExpr(removeStmt->object);
+                addExpr(removeStmt->index);
+                break;
+            }
+            case StmtKind::ForIn: {
+                auto forIn = static_cast<ForInStmt*>(stmt);
+                addExpr(forIn->map);
+                addStmt(forIn->body);
+                break;
+            }
+            case StmtKind::Function: addStmt(static_cast<FunctionStmt*>(stmt)->body); break;
+            case StmtKind::Return: addExpr(static_cast<ReturnStmt*>(stmt)->value); break;
+            case StmtKind::LazyBlock: break;  // fused when parsed
+            default: break;
+        }
+    }
+
+    while (!exprs.empty()) {
+        std::unique_ptr<Expr>& slot = *exprs.back();
+        exprs.pop_back();
+        switch (slot->kind) {
+            case ExprKind::Binary: {
+                auto bin = static_cast<BinaryExpr*>(slot.get());
+                if (auto replacement = fuse(bin)) {
+                    slot = std::move(replacement);
+                    ++fused;
+                    break;
+                }
+                addExpr(bin->left);
+                addExpr(bin->right);
+                break;
+            }
+            case ExprKind::Unary: addExpr(static_cast<UnaryExpr*>(slot.get())->right); break;
+            case ExprKind::Map: {
+                auto map = static_cast<MapExpr*>(slot.get());
+                for (auto& key : map->keys) addExpr(key);
+                for (auto& value : map->values) addExpr(value);
+                break;
+            }
+            case ExprKind::Index: {
+                auto index = static_cast<IndexExpr*>(slot.get());
+                addExpr(index->object);
+                addExpr(index->index);
+                break;
+            }
+            case ExprKind::Call:
+                for (auto& arg : static_cast<CallExpr*>(slot.get())->args) addExpr(arg);
+                break;
+            default: break;
+        }
+    }
+    return fused;
+}
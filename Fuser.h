@@ -0,0 +1,25 @@
+#ifndef FUSER_H
+#define FUSER_H
+
+#include "AST.h"
+#include <memory>
+#include <vector>
+
+// Replaces the idioms that dominate typical scripts (as counted by
+// miniscript-idioms) with the fused node kinds at the end of AST.h:
+//
+//   v = v + <int>, v = v - <int>       IncrementStmt: updates an int in place
+//   v = v + "<text>"                   AppendStmt: appends to the string in place
+//   w < <int>, w == <int>, ...         CompareConstExpr: compares without copying w
+//
+// Each fused node falls back to the plain evaluation whenever its shortcut
+// does not apply, so results and errors are unchanged. Run it after the
+// Inliner, which only knows the plain node kinds.
+class Fuser {
+public:
+    // Returns the number of nodes replaced
+    size_t run(std::vector<std::unique_ptr<Stmt>>& program);
+    size_t rewrite(std::unique_ptr<Stmt>& root);
+};
+
+#endif // FUSER_H
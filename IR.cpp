@@ -0,0 +1,99 @@
+#include "IR.h"
+
+// --- Construction ---
+int IRProgram::addBlock() {
+    blocks.emplace_back();
+    return static_cast<int>(blocks.size()) - 1;
+}
+
+int IRProgram::addInstr(int block, IRInstr instr) {
+    int id = static_cast<int>(values.size());
+    instr.block = block;
+    bool isPhi = instr.op == IROp::Phi;
+    values.push_back(std::move(instr));
+    if (isPhi) blocks[block].phis.push_back(id);
+    else blocks[block].body.push_back(id);
+    return id;
+}
+
+void IRProgram::jump(int from, int to) {
+    blocks[from].term = IRTerm::Jump;
+    blocks[from].succs = {to};
+    blocks[to].preds.push_back(from);
+}
+
+void IRProgram::branch(int from, int cond, int thenBlock, int elseBlock) {
+    blocks[from].term = IRTerm::Branch;
+    blocks[from].cond = cond;
+    blocks[from].succs = {thenBlock, elseBlock};
+    blocks[thenBlock].preds.push_back(from);
+    blocks[elseBlock].preds.push_back(from);
+}
+
+// --- Dump ---
+static void dumpConstant(std::ostream& out, const Value& value) {
+    std::visit([&](const auto& val) {
+        using T = std::decay_t<decltype(val)>;
+        if constexpr (std::is_same_v<T, int>) out << "int " << val;
+        if constexpr (std::is_same_v<T, float>) out << "float " << val;
+        if constexpr (std::is_same_v<T, char>) out << "char '" << val << "'";
+        if constexpr (std::is_same_v<T, SharedString>) out << "string \"" << val << "\"";
+    }, value);
+}
+
+static const char* opName(IROp op) {
+    switch (op) {
+        case IROp::Const: return "const";
+        case IROp::Undef: return "undef";
+        case IROp::Phi: return "phi";
+        case IROp::Check: return "check";
+        case IROp::Binary: return "binary";
+        case IROp::Unary: return "unary";
+        case IROp::Print: return "print";
+    }
+    return "?";
+}
+
+void IRProgram::dump(std::ostream& out) const {
+    for (size_t b = 0; b < blocks.size(); ++b) {
+        const IRBlock& block = blocks[b];
+        if (block.removed) continue;
+
+        out << "bb" << b << ":";
+        if (!block.preds.empty()) {
+            out << "  ; preds";
+            for (int p : block.preds) out << " bb" << p;
+        }
+        out << "\n";
+
+        auto dumpInstr = [&](int id) {
+            const IRInstr& in = values[id];
+            out << "  ";
+            if (in.op != IROp::Print) out << "%" << id << " = ";
+            out << opName(in.op);
+            if (in.op == IROp::Binary || in.op == IROp::Unary) out << " " << in.opToken.text;
+            if (in.op == IROp::Const) {
+                out << " ";
+                dumpConstant(out, in.constant);
+            }
+            if (in.op == IROp::Undef || in.op == IROp::Check) out << " " << in.name;
+            for (size_t i = 0; i < in.operands.size(); ++i) {
+                out << (i == 0 ? " " : ", ") << "%" << in.operands[i];
+                if (in.op == IROp::Phi) out << " [bb" << block.preds[i] << "]";
+            }
+            out << "\n";
+        };
+
+        for (int id : block.phis) dumpInstr(id);
+        for (int id : block.body) dumpInstr(id);
+
+        switch (block.term) {
+            case IRTerm::None: out << "  <unterminated>\n"; break;
+            case IRTerm::Jump: out << "  jump bb" << block.succs[0] << "\n"; break;
+            case IRTerm::Branch:
+                out << "  branch %" << block.cond << ", bb" << block.succs[0] << ", bb" << block.succs[1] << "\n";
+                break;
+            case IRTerm::Exit: out << "  exit\n"; break;
+        }
+    }
+}
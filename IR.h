@@ -0,0 +1,65 @@
+#ifndef IR_H
+#define IR_H
+
+#include "Environment.h"
+#include "Token.h"
+#include <ostream>
+#include <vector>
+
+// Mid-level SSA IR: a control-flow graph of basic blocks whose instructions
+// each define at most one value. Values are identified by their index in
+// IRProgram::values; phis take one operand per predecessor, in `preds` order.
+
+enum class IROp {
+    Const,   // constant
+    Undef,   // variable read before any assignment; `name` is the variable
+    Phi,     // merge at block entry
+    Check,   // yields operand 0, or throws "Undefined variable: name" if undefined
+    Binary,  // `opToken` applied to operands 0 and 1
+    Unary,   // `opToken` applied to operand 0
+    Print    // side effect only
+};
+
+enum class IRTerm {
+    None,    // block still under construction
+    Jump,    // succs[0]
+    Branch,  // operand `cond`: truthy -> succs[0], otherwise succs[1]
+    Exit
+};
+
+struct IRInstr {
+    IROp op;
+    int block = -1;
+    std::vector<int> operands;
+    Value constant;
+    SharedString name;
+    Token opToken{TokenType::Unknown, "", 0};
+    bool removed = false;
+
+    IRInstr(IROp o) : op(o) {}
+};
+
+struct IRBlock {
+    std::vector<int> phis;
+    std::vector<int> body;
+    std::vector<int> preds;
+    std::vector<int> succs;
+    IRTerm term = IRTerm::None;
+    int cond = -1;
+    bool removed = false;
+};
+
+struct IRProgram {
+    std::vector<IRInstr> values;
+    std::vector<IRBlock> blocks;
+    int entry = 0;
+
+    int addBlock();
+    int addInstr(int block, IRInstr instr);
+    void jump(int from, int to);
+    void branch(int from, int cond, int thenBlock, int elseBlock);
+
+    void dump(std::ostream& out) const;
+};
+
+#endif // IR_H
@@ -0,0 +1,431 @@
+#include "IRBuilder.h"
+#include "RecursionGuard.h"
+#include <stdexcept>
+
+// The SSA IR has no map operations; such programs run on the tree walker
+static const char* const mapsUnsupported = "Maps are only supported by the tree-walking interpreter";
+static const char* const functionsUnsupported = "Functions are only supported by the tree-walking interpreter";
+
+// --- Entry Point ---
+IRProgram IRBuilder::build(const std::vector<std::unique_ptr<Stmt>>& statements) {
+    program = IRProgram();
+    scopes.clear();
+    loops.clear();
+    varNames.clear();
+    currentDef.clear();
+    incompletePhis.clear();
+    sealed.clear();
+    forward.clear();
+
+    scopes.push_back(Scope{-1, {}});
+    currentScope = 0;
+
+    current = newBlock();
+    sealBlock(current);
+    program.entry = current;
+    exitBlock = newBlock();
+
+    for (const auto& stmt : statements) lowerStmt(stmt.get());
+
+    terminateWithJump(exitBlock);
+    sealBlock(exitBlock);
+    program.blocks[exitBlock].term = IRTerm::Exit;
+
+    // Point every operand past phis that were found to be trivial
+    for (auto& instr : program.values)
+        for (int& operand : instr.operands) operand = find(operand);
+    for (auto& block : program.blocks)
+        if (block.cond >= 0) block.cond = find(block.cond);
+
+    return std::move(program);
+}
+
+// --- Blocks ---
+int IRBuilder::newBlock() {
+    int block = program.addBlock();
+    incompletePhis.emplace_back();
+    sealed.push_back(false);
+    return block;
+}
+
+void IRBuilder::sealBlock(int block) {
+    auto pending = std::move(incompletePhis[block]);
+    incompletePhis[block].clear();
+    for (auto& [var, phi] : pending) addPhiOperands(var, phi);
+    sealed[block] = true;
+}
+
+void IRBuilder::terminateWithJump(int target) {
+    if (program.blocks[current].term == IRTerm::None) program.jump(current, target);
+}
+
+int IRBuilder::emit(IRInstr instr) {
+    int id = program.addInstr(current, std::move(instr));
+    forward.push_back(id);
+    return id;
+}
+
+int IRBuilder::constant(Value value) {
+    IRInstr instr(IROp::Const);
+    instr.constant = std::move(value);
+    return emit(std::move(instr));
+}
+
+// --- Variables ---
+int IRBuilder::variable(int scope, const SharedString& name) {
+    auto found = scopes[scope].vars.find(name);
+    if (found != scopes[scope].vars.end()) return found->second;
+
+    int var = static_cast<int>(varNames.size());
+    varNames.push_back(name);
+    currentDef.emplace_back();
+    scopes[scope].vars.emplace(name, var);
+    return var;
+}
+
+int IRBuilder::resolve(int scope, const SharedString& name) {
+    for (int s = scope; s > 0; s = scopes[s].parent) {
+        auto found = scopes[s].vars.find(name);
+        if (found != scopes[s].vars.end()) return found->second;
+    }
+    return variable(0, name);
+}
+
+void IRBuilder::writeVariable(int var, int block, int value) {
+    currentDef[var][block] = value;
+}
+
+int IRBuilder::readVariable(int var, int block) {
+    auto found = currentDef[var].find(block);
+    if (found != currentDef[var].end()) return find(found->second);
+    return readVariableRecursive(var, block);
+}
+
+// Braun et al.'s readVariableRecursive, with the walk back over
+// predecessors kept on an explicit stack: a long run of blocks would
+// otherwise recurse once per block. Each frame is a block waiting for the
+// value from its single predecessor, or a phi collecting one operand per
+// predecessor.
+int IRBuilder::readVariableRecursive(int var, int block) {
+    struct Frame {
+        int block;
+        int phi;      // -1 for a block with a single predecessor
+        size_t next;  // predecessors read so far, for a phi
+    };
+    std::vector<Frame> frames;
+    int value = -1;    // the value read last, or -1 if there is none to hand over
+    int read = block;  // the block to read `var` in next, or -1
+
+    while (true) {
+        if (read >= 0) {
+            int b = read;
+            read = -1;
+            const IRBlock& node = program.blocks[b];
+            auto found = currentDef[var].find(b);
+            if (found != currentDef[var].end()) {
+                value = find(found->second);
+            } else if (!sealed[b]) {
+                IRInstr phi(IROp::Phi);
+                value = program.addInstr(b, std::move(phi));
+                forward.push_back(value);
+                incompletePhis[b].emplace_back(var, value);
+                writeVariable(var, b, value);
+            } else if (node.preds.empty()) {
+                // Program entry, or code after a break: the variable is unassigned
+                IRInstr undef(IROp::Undef);
+                undef.name = varNames[var];
+                undef.block = program.entry;
+                value = static_cast<int>(program.values.size());
+                program.values.push_back(std::move(undef));
+                auto& entryBody = program.blocks[program.entry].body;
+                entryBody.insert(entryBody.begin(), value);
+                forward.push_back(value);
+                writeVariable(var, b, value);
+            } else if (node.preds.size() == 1) {
+                frames.push_back(Frame{b, -1, 0});
+                read = node.preds[0];
+                continue;
+            } else {
+                IRInstr phi(IROp::Phi);
+                int id = program.addInstr(b, std::move(phi));
+                forward.push_back(id);
+                writeVariable(var, b, id);
+                frames.push_back(Frame{b, id, 0});
+                value = -1;
+            }
+        }
+
+        if (frames.empty()) return value;
+        Frame& frame = frames.back();
+        if (frame.phi < 0) {
+            writeVariable(var, frame.block, value);
+            frames.pop_back();
+            continue;
+        }
+        if (value >= 0) program.values[frame.phi].operands.push_back(value);
+        const std::vector<int>& preds = program.blocks[frame.block].preds;
+        if (frame.next < preds.size()) {
+            read = preds[frame.next++];
+            continue;
+        }
+        value = tryRemoveTrivialPhi(frame.phi);
+        writeVariable(var, frame.block, value);
+        frames.pop_back();
+    }
+}
+
+int IRBuilder::addPhiOperands(int var, int phi) {
+    int block = program.values[phi].block;
+    for (int pred : std::vector<int>(program.blocks[block].preds)) {
+        int operand = readVariable(var, pred);
+        program.values[phi].operands.push_back(operand);
+    }
+    return tryRemoveTrivialPhi(phi);
+}
+
+int IRBuilder::tryRemoveTrivialPhi(int phi) {
+    int same = -1;
+    for (int operand : program.values[phi].operands) {
+        operand = find(operand);
+        if (operand == same || operand == phi) continue;
+        if (same != -1) return phi;
+        same = operand;
+    }
+    if (same == -1) return phi;  // only self-references: leave for the optimizer
+
+    forward[phi] = same;
+    program.values[phi].removed = true;
+    auto& phis = program.blocks[program.values[phi].block].phis;
+    for (auto it = phis.begin(); it != phis.end(); ++it) {
+        if (*it == phi) {
+            phis.erase(it);
+            break;
+        }
+    }
+    return same;
+}
+
+int IRBuilder::find(int value) {
+    while (forward[value] != value) {
+        forward[value] = forward[forward[value]];
+        value = forward[value];
+    }
+    return value;
+}
+
+// --- Scopes ---
+void IRBuilder::collectAssigned(const Stmt* stmt, Scope& scope) {
+    RecursionGuard guard;
+    if (!stmt) return;
+
+    if (auto assignStmt = dynamic_cast<const AssignStmt*>(stmt)) {
+        scope.vars.emplace(assignStmt->name, -1);
+    } else if (auto ifStmt = dynamic_cast<const IfStmt*>(stmt)) {
+        collectAssigned(ifStmt->thenBranch.get(), scope);
+        collectAssigned(ifStmt->elseBranch.get(), scope);
+    } else if (auto whileStmt = dynamic_cast<const WhileStmt*>(stmt)) {
+        collectAssigned(whileStmt->body.get(), scope);
+    }
+    // BlockStmt and ForStmt open scopes of their own
+}
+
+void IRBuilder::enterScope(const std::vector<const Stmt*>& body) {
+    Scope scope{currentScope, {}};
+    for (const Stmt* stmt : body) collectAssigned(stmt, scope);
+
+    int index = static_cast<int>(scopes.size());
+    scopes.push_back(Scope{currentScope, {}});
+
+    // Seed each local with the value visible from the enclosing scope
+    for (auto& entry : scope.vars) {
+        int outer = readVariable(resolve(currentScope, entry.first), current);
+        writeVariable(variable(index, entry.first), current, outer);
+    }
+    currentScope = index;
+}
+
+void IRBuilder::exitScope() {
+    currentScope = scopes[currentScope].parent;
+}
+
+// --- Statements ---
+void IRBuilder::lowerStmt(const Stmt* stmt) {
+    RecursionGuard guard;
+    if (auto printStmt = dynamic_cast<const PrintStmt*>(stmt)) {
+        IRInstr print(IROp::Print);
+        print.operands = {lowerExpr(printStmt->expression.get())};
+        emit(std::move(print));
+        return;
+    }
+
+    if (auto assignStmt = dynamic_cast<const AssignStmt*>(stmt)) {
+        int value = lowerExpr(assignStmt->value.get());
+        writeVariable(variable(currentScope, assignStmt->name), current, value);
+        return;
+    }
+
+    if (auto ifStmt = dynamic_cast<const IfStmt*>(stmt)) {
+        int cond = lowerExpr(ifStmt->condition.get());
+        int thenBlock = newBlock();
+        int join = newBlock();
+        int elseBlock = ifStmt->elseBranch ? newBlock() : join;
+        program.branch(current, cond, thenBlock, elseBlock);
+
+        sealBlock(thenBlock);
+        current = thenBlock;
+        lowerStmt(ifStmt->thenBranch.get());
+        terminateWithJump(join);
+
+        if (ifStmt->elseBranch) {
+            sealBlock(elseBlock);
+            current = elseBlock;
+            lowerStmt(ifStmt->elseBranch.get());
+            terminateWithJump(join);
+        }
+
+        sealBlock(join);
+        current = join;
+        return;
+    }
+
+    if (auto whileStmt = dynamic_cast<const WhileStmt*>(stmt)) {
+        int header = newBlock();
+        int body = newBlock();
+        int exit = newBlock();
+
+        terminateWithJump(header);
+        current = header;
+        int cond = lowerExpr(whileStmt->condition.get());
+        program.branch(current, cond, body, exit);
+
+        sealBlock(body);
+        current = body;
+        loops.push_back(LoopTargets{exit, header});
+        lowerStmt(whileStmt->body.get());
+        loops.pop_back();
+        terminateWithJump(header);
+
+        sealBlock(header);
+        sealBlock(exit);
+        current = exit;
+        return;
+    }
+
+    if (auto forStmt = dynamic_cast<const ForStmt*>(stmt)) {
+        enterScope({forStmt->initializer.get(), forStmt->increment.get(), forStmt->body.get()});
+        if (forStmt->initializer) lowerStmt(forStmt->initializer.get());
+
+        int header = newBlock();
+        int body = newBlock();
+        int increment = newBlock();
+        int exit = newBlock();
+
+        terminateWithJump(header);
+        current = header;
+        if (forStmt->condition) {
+            int cond = lowerExpr(forStmt->condition.get());
+            program.branch(current, cond, body, exit);
+        } else {
+            program.jump(current, body);
+        }
+
+        sealBlock(body);
+        current = body;
+        loops.push_back(LoopTargets{exit, increment});
+        lowerStmt(forStmt->body.get());
+        loops.pop_back();
+        terminateWithJump(increment);
+
+        sealBlock(increment);
+        current = increment;
+        if (forStmt->increment) lowerStmt(forStmt->increment.get());
+        terminateWithJump(header);
+
+        sealBlock(header);
+        sealBlock(exit);
+        current = exit;
+        exitScope();
+        return;
+    }
+
+    if (auto lazy = dynamic_cast<const LazyBlockStmt*>(stmt)) {
+        lowerStmt(lazy->body());
+        return;
+    }
+
+    if (auto blockStmt = dynamic_cast<const BlockStmt*>(stmt)) {
+        std::vector<const Stmt*> body;
+        for (const auto& s : blockStmt->statements) body.push_back(s.get());
+        enterScope(body);
+        for (const auto& s : blockStmt->statements) lowerStmt(s.get());
+        exitScope();
+        return;
+    }
+
+    bool isBreak = dynamic_cast<const BreakStmt*>(stmt) != nullptr;
+    if (isBreak || dynamic_cast<const ContinueStmt*>(stmt)) {
+        // Outside any loop, break and continue skip the rest of the program
+        int target = exitBlock;
+        if (!loops.empty()) target = isBreak ? loops.back().breakTarget : loops.back().continueTarget;
+        terminateWithJump(target);
+
+        current = newBlock();
+        sealBlock(current);
+        return;
+    }
+
+    if (stmt->kind == StmtKind::IndexAssign || stmt->kind == StmtKind::Remove || stmt->kind == StmtKind::ForIn)
+        throw std::runtime_error(mapsUnsupported);
+    if (stmt->kind == StmtKind::Function || stmt->kind == StmtKind::Return) throw std::runtime_error(functionsUnsupported);
+
+    throw std::runtime_error("Unknown statement type");
+}
+
+// --- Expressions ---
+int IRBuilder::lowerExpr(const Expr* expr) {
+    RecursionGuard guard;
+    if (auto intExpr = dynamic_cast<const IntExpr*>(expr)) {
+        return constant(intExpr->value);
+    }
+
+    if (auto floatExpr = dynamic_cast<const FloatExpr*>(expr)) {
+        return constant(floatExpr->value);
+    }
+
+    if (auto charExpr = dynamic_cast<const CharExpr*>(expr)) {
+        return constant(charExpr->value);
+    }
+
+    if (auto stringExpr = dynamic_cast<const StringExpr*>(expr)) {
+        return constant(stringExpr->value);
+    }
+
+    if (auto var = dynamic_cast<const VariableExpr*>(expr)) {
+        IRInstr check(IROp::Check);
+        check.name = var->name;
+        check.operands = {readVariable(resolve(currentScope, var->name), current)};
+        return emit(std::move(check));
+    }
+
+    if (auto bin = dynamic_cast<const BinaryExpr*>(expr)) {
+        if (bin->op.type == TokenType::In) throw std::runtime_error(mapsUnsupported);
+        int left = lowerExpr(bin->left.get());
+        int right = lowerExpr(bin->right.get());
+        IRInstr instr(IROp::Binary);
+        instr.opToken = bin->op;
+        instr.operands = {left, right};
+        return emit(std::move(instr));
+    }
+
+    if (auto unary = dynamic_cast<const UnaryExpr*>(expr)) {
+        IRInstr instr(IROp::Unary);
+        instr.opToken = unary->op;
+        instr.operands = {lowerExpr(unary->right.get())};
+        return emit(std::move(instr));
+    }
+
+    if (expr->kind == ExprKind::Map || expr->kind == ExprKind::Index) throw std::runtime_error(mapsUnsupported);
+    if (expr->kind == ExprKind::Call) throw std::runtime_error(functionsUnsupported);
+
+    throw std::runtime_error("Unknown expression type");
+}
@@ -0,0 +1,72 @@
+#ifndef IR_BUILDER_H
+#define IR_BUILDER_H
+
+#include "AST.h"
+#include "IR.h"
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Lowers a parsed program to SSA form, following Braun et al.'s on-the-fly
+// construction with sealed blocks.
+//
+// Environment scopes are lexical: a BlockStmt or ForStmt pushes a scope and
+// every assignment lands in the innermost one. While control is inside a
+// scope the enclosing scopes cannot change, so each (scope, name) pair is
+// lowered as its own SSA variable, seeded on scope entry with the value
+// visible from outside.
+class IRBuilder {
+public:
+    IRProgram build(const std::vector<std::unique_ptr<Stmt>>& statements);
+
+private:
+    struct Scope {
+        int parent;
+        std::unordered_map<SharedString, int, SharedStringHash> vars;
+    };
+
+    struct LoopTargets {
+        int breakTarget;
+        int continueTarget;
+    };
+
+    IRProgram program;
+    int current = 0;
+    int exitBlock = 0;
+
+    std::vector<Scope> scopes;
+    int currentScope = 0;
+    std::vector<LoopTargets> loops;
+
+    // SSA construction state, indexed by variable id / block id
+    std::vector<SharedString> varNames;
+    std::vector<std::unordered_map<int, int>> currentDef;
+    std::vector<std::vector<std::pair<int, int>>> incompletePhis;
+    std::vector<bool> sealed;
+    std::vector<int> forward;
+
+    int newBlock();
+    void sealBlock(int block);
+
+    int variable(int scope, const SharedString& name);
+    int resolve(int scope, const SharedString& name);
+    void writeVariable(int var, int block, int value);
+    int readVariable(int var, int block);
+    int readVariableRecursive(int var, int block);
+    int addPhiOperands(int var, int phi);
+    int tryRemoveTrivialPhi(int phi);
+    int find(int value);
+
+    void enterScope(const std::vector<const Stmt*>& body);
+    void exitScope();
+    void collectAssigned(const Stmt* stmt, Scope& scope);
+
+    int emit(IRInstr instr);
+    int constant(Value value);
+    void terminateWithJump(int target);
+
+    void lowerStmt(const Stmt* stmt);
+    int lowerExpr(const Expr* expr);
+};
+
+#endif // IR_BUILDER_H
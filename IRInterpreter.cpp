@@ -0,0 +1,79 @@
+#include "IRInterpreter.h"
+#include "Operators.h"
+#include <iostream>
+#include <stdexcept>
+
+bool IRInterpreter::run(const IRProgram& program) {
+    try {
+        execute(program);
+    } catch (const std::runtime_error& e) {
+        *errors << "Runtime error: " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void IRInterpreter::execute(const IRProgram& program) {
+    registers.assign(program.values.size(), Register());
+    std::vector<Register> incoming;
+
+    int block = program.entry;
+    int previous = -1;
+
+    while (true) {
+        const IRBlock& b = program.blocks[block];
+
+        // Phis read their operands before any of them is written
+        if (!b.phis.empty()) {
+            size_t edge = 0;
+            while (b.preds[edge] != previous) ++edge;
+            incoming.clear();
+            for (int phi : b.phis) incoming.push_back(registers[program.values[phi].operands[edge]]);
+            for (size_t i = 0; i < b.phis.size(); ++i) registers[b.phis[i]] = std::move(incoming[i]);
+        }
+
+        for (int id : b.body) {
+            const IRInstr& instr = program.values[id];
+            Register& out = registers[id];
+            switch (instr.op) {
+                case IROp::Const:
+                    out.value = instr.constant;
+                    out.defined = true;
+                    break;
+                case IROp::Undef:
+                    out.defined = false;
+                    break;
+                case IROp::Check: {
+                    const Register& in = registers[instr.operands[0]];
+                    if (!in.defined) throw std::runtime_error("Undefined variable: " + instr.name.str());
+                    out = in;
+                    break;
+                }
+                case IROp::Binary:
+                    out.value = applyBinaryOperator(instr.opToken, registers[instr.operands[0]].value,
+                                                    registers[instr.operands[1]].value);
+                    out.defined = true;
+                    break;
+                case IROp::Unary:
+                    out.value = applyUnaryOperator(instr.opToken, registers[instr.operands[0]].value);
+                    out.defined = true;
+                    break;
+                case IROp::Print:
+                    std::visit([this](const auto& val) {
+                        *output << val << std::endl;
+                    }, registers[instr.operands[0]].value);
+                    break;
+                case IROp::Phi:
+                    break;
+            }
+        }
+
+        previous = block;
+        switch (b.term) {
+            case IRTerm::Jump: block = b.succs[0]; break;
+            case IRTerm::Branch: block = b.succs[isTruthy(registers[b.cond].value) ? 0 : 1]; break;
+            case IRTerm::Exit:
+            case IRTerm::None: return;
+        }
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef IR_INTERPRETER_H
+#define IR_INTERPRETER_H
+
+#include "IR.h"
+#include <iostream>
+#include <vector>
+
+// Executes an SSA program directly: one register per value, phis resolved
+// as parallel copies on each edge.
+class IRInterpreter {
+public:
+    // Program output goes to `out`, runtime errors to `err`
+    explicit IRInterpreter(std::ostream& out = std::cout, std::ostream& err = std::cerr) : output(&out), errors(&err) {}
+
+    // Runs the program; false if a runtime error stopped it
+    bool run(const IRProgram& program);
+
+private:
+    struct Register {
+        Value value;
+        bool defined = false;
+    };
+
+    std::ostream* output;
+    std::ostream* errors;
+    std::vector<Register> registers;
+
+    void execute(const IRProgram& program);
+};
+
+#endif // IR_INTERPRETER_H
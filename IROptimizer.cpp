@@ -0,0 +1,373 @@
+#include "IROptimizer.h"
+#include "Operators.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+// --- Entry Point ---
+void IROptimizer::run(IRProgram& prog) {
+    program = &prog;
+    forward.resize(program->values.size());
+    for (size_t i = 0; i < forward.size(); ++i) forward[i] = static_cast<int>(i);
+
+    for (int round = 0; round < 16; ++round) {
+        bool changed = false;
+        changed |= removeUnreachable();
+        changed |= simplifyCopies();
+        changed |= numberValues();
+        changed |= eliminateDeadCode();
+        if (!changed) break;
+    }
+}
+
+// --- Helpers ---
+int IROptimizer::find(int value) {
+    while (forward[value] != value) {
+        forward[value] = forward[forward[value]];
+        value = forward[value];
+    }
+    return value;
+}
+
+void IROptimizer::replace(int value, int with) {
+    forward[value] = find(with);
+    program->values[value].removed = true;
+}
+
+void IROptimizer::rewriteOperands() {
+    for (auto& instr : program->values)
+        for (int& operand : instr.operands) operand = find(operand);
+
+    for (auto& block : program->blocks) {
+        if (block.cond >= 0) block.cond = find(block.cond);
+        auto isRemoved = [&](int id) { return program->values[id].removed; };
+        block.phis.erase(std::remove_if(block.phis.begin(), block.phis.end(), isRemoved), block.phis.end());
+        block.body.erase(std::remove_if(block.body.begin(), block.body.end(), isRemoved), block.body.end());
+    }
+}
+
+void IROptimizer::removeEdge(int from, int to) {
+    IRBlock& target = program->blocks[to];
+    auto it = std::find(target.preds.begin(), target.preds.end(), from);
+    if (it == target.preds.end()) return;
+
+    size_t index = static_cast<size_t>(it - target.preds.begin());
+    target.preds.erase(it);
+    for (int phi : target.phis) {
+        auto& operands = program->values[phi].operands;
+        operands.erase(operands.begin() + static_cast<long>(index));
+    }
+}
+
+// --- Control Flow ---
+std::vector<int> IROptimizer::reversePostorder() {
+    std::vector<int> order;
+    std::vector<bool> visited(program->blocks.size(), false);
+    std::vector<std::pair<int, size_t>> stack{{program->entry, 0}};
+    visited[program->entry] = true;
+
+    while (!stack.empty()) {
+        auto& [block, next] = stack.back();
+        const auto& succs = program->blocks[block].succs;
+        if (next < succs.size()) {
+            int succ = succs[next++];
+            if (!visited[succ]) {
+                visited[succ] = true;
+                stack.emplace_back(succ, 0);
+            }
+        } else {
+            order.push_back(block);
+            stack.pop_back();
+        }
+    }
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+void IROptimizer::computeDominators() {
+    // Cooper, Harvey & Kennedy, "A Simple, Fast Dominance Algorithm"
+    std::vector<int> order = reversePostorder();
+    std::vector<int> position(program->blocks.size(), -1);
+    for (size_t i = 0; i < order.size(); ++i) position[order[i]] = static_cast<int>(i);
+
+    idom.assign(program->blocks.size(), -1);
+    idom[program->entry] = program->entry;
+
+    auto intersect = [&](int a, int b) {
+        while (a != b) {
+            while (position[a] > position[b]) a = idom[a];
+            while (position[b] > position[a]) b = idom[b];
+        }
+        return a;
+    };
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 1; i < order.size(); ++i) {
+            int block = order[i];
+            int newIdom = -1;
+            for (int pred : program->blocks[block].preds) {
+                if (idom[pred] < 0) continue;
+                newIdom = newIdom < 0 ? pred : intersect(pred, newIdom);
+            }
+            if (newIdom != idom[block]) {
+                idom[block] = newIdom;
+                changed = true;
+            }
+        }
+    }
+
+    domChildren.assign(program->blocks.size(), {});
+    for (int block : order)
+        if (block != program->entry) domChildren[idom[block]].push_back(block);
+}
+
+// --- Passes ---
+bool IROptimizer::removeUnreachable() {
+    std::vector<int> order = reversePostorder();
+    std::vector<bool> reachable(program->blocks.size(), false);
+    for (int block : order) reachable[block] = true;
+
+    bool changed = false;
+    for (size_t b = 0; b < program->blocks.size(); ++b) {
+        IRBlock& block = program->blocks[b];
+        if (reachable[b] || block.removed) continue;
+
+        for (int succ : block.succs) removeEdge(static_cast<int>(b), succ);
+        for (int id : block.phis) program->values[id].removed = true;
+        for (int id : block.body) program->values[id].removed = true;
+        block.phis.clear();
+        block.body.clear();
+        block.preds.clear();
+        block.succs.clear();
+        block.removed = true;
+        changed = true;
+    }
+    if (changed) rewriteOperands();
+    return changed;
+}
+
+bool IROptimizer::simplifyCopies() {
+    types.compute(*program);
+
+    bool changed = false;
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        for (size_t id = 0; id < program->values.size(); ++id) {
+            IRInstr& instr = program->values[id];
+            if (instr.removed) continue;
+
+            if (instr.op == IROp::Phi) {
+                int same = -1;
+                bool trivial = true;
+                for (int operand : instr.operands) {
+                    operand = find(operand);
+                    if (operand == same || operand == static_cast<int>(id)) continue;
+                    if (same != -1) {
+                        trivial = false;
+                        break;
+                    }
+                    same = operand;
+                }
+                if (trivial && same != -1) {
+                    replace(static_cast<int>(id), same);
+                    progress = true;
+                }
+            } else if (instr.op == IROp::Check && !types.maybeUndefined(find(instr.operands[0]))) {
+                replace(static_cast<int>(id), instr.operands[0]);
+                progress = true;
+            }
+        }
+        changed |= progress;
+    }
+    if (changed) rewriteOperands();
+    return changed;
+}
+
+static std::string constantKey(const Value& value) {
+    return std::visit([](const auto& val) -> std::string {
+        using T = std::decay_t<decltype(val)>;
+        if constexpr (std::is_same_v<T, int>) return "i" + std::to_string(val);
+        if constexpr (std::is_same_v<T, float>) {
+            uint32_t bits;
+            std::memcpy(&bits, &val, sizeof bits);
+            return "f" + std::to_string(bits);
+        }
+        if constexpr (std::is_same_v<T, char>) return "c" + std::to_string(static_cast<int>(val));
+        if constexpr (std::is_same_v<T, SharedString>) return "s" + val.str();
+        return "";
+    }, value);
+}
+
+static bool isCommutative(TokenType type) {
+    return type == TokenType::Plus || type == TokenType::Star ||
+           type == TokenType::DoubleEqual || type == TokenType::NotEqual;
+}
+
+bool IROptimizer::numberValues() {
+    types.compute(*program);
+    computeDominators();
+
+    bool changed = false;
+    std::unordered_map<std::string, int> table;
+    std::vector<std::string> added;
+
+    // Numbers one block; the keys it adds stay in `table` for the blocks it dominates
+    auto numberBlock = [&](int b) {
+        IRBlock& block = program->blocks[b];
+
+        auto number = [&](int id, const std::string& key) {
+            auto found = table.find(key);
+            if (found != table.end()) {
+                replace(id, found->second);
+                changed = true;
+            } else {
+                table.emplace(key, id);
+                added.push_back(key);
+            }
+        };
+
+        for (int id : block.phis) {
+            IRInstr& instr = program->values[id];
+            if (instr.removed) continue;
+            std::string key = "phi:" + std::to_string(b);
+            for (int operand : instr.operands) key += ":" + std::to_string(find(operand));
+            number(id, key);
+        }
+
+        for (int id : block.body) {
+            IRInstr& instr = program->values[id];
+            if (instr.removed) continue;
+            for (int& operand : instr.operands) operand = find(operand);
+
+            // Fold operations whose operands are all constants
+            if (instr.op == IROp::Binary || instr.op == IROp::Unary) {
+                bool allConstant = true;
+                for (int operand : instr.operands)
+                    allConstant = allConstant && program->values[operand].op == IROp::Const;
+                if (allConstant) {
+                    try {
+                        const Value& left = program->values[instr.operands[0]].constant;
+                        Value folded = instr.op == IROp::Binary
+                            ? applyBinaryOperator(instr.opToken, left, program->values[instr.operands[1]].constant)
+                            : applyUnaryOperator(instr.opToken, left);
+                        instr.op = IROp::Const;
+                        instr.constant = std::move(folded);
+                        instr.operands.clear();
+                        changed = true;
+                    } catch (const std::runtime_error&) {
+                        // Leave it in place so the error is raised at run time
+                    }
+                }
+            }
+
+            switch (instr.op) {
+                case IROp::Const: number(id, "const:" + constantKey(instr.constant)); break;
+                case IROp::Undef: number(id, "undef:" + instr.name.str()); break;
+                case IROp::Check: number(id, "check:" + std::to_string(instr.operands[0])); break;
+                case IROp::Binary: {
+                    int left = instr.operands[0];
+                    int right = instr.operands[1];
+                    if (isCommutative(instr.opToken.type) && !(types.of(left) & ~IRTypes::Arith) &&
+                        !(types.of(right) & ~IRTypes::Arith) && left > right)
+                        std::swap(left, right);
+                    number(id, "binary:" + instr.opToken.text + ":" + std::to_string(left) + ":" + std::to_string(right));
+                    break;
+                }
+                case IROp::Unary:
+                    number(id, "unary:" + instr.opToken.text + ":" + std::to_string(instr.operands[0]));
+                    break;
+                default: break;
+            }
+        }
+
+        // Fold branches on constant conditions
+        if (block.term == IRTerm::Branch) {
+            block.cond = find(block.cond);
+            const IRInstr& cond = program->values[block.cond];
+            if (cond.op == IROp::Const) {
+                bool taken = isTruthy(cond.constant);
+                int keep = block.succs[taken ? 0 : 1];
+                int drop = block.succs[taken ? 1 : 0];
+                if (keep != drop) removeEdge(b, drop);
+                block.term = IRTerm::Jump;
+                block.succs = {keep};
+                block.cond = -1;
+                changed = true;
+            }
+        }
+    };
+
+    // Preorder walk of the dominator tree with an explicit stack, since a
+    // long run of branches makes it as deep as the program is long. A block's
+    // keys are dropped once all the blocks it dominates are done.
+    struct Visit {
+        int block;
+        size_t mark;        // size of `added` before the block was numbered
+        bool childrenDone;  // its dominator children have been pushed
+    };
+    std::vector<Visit> stack{Visit{program->entry, 0, false}};
+    while (!stack.empty()) {
+        Visit& visit = stack.back();
+        if (visit.childrenDone) {
+            while (added.size() > visit.mark) {
+                table.erase(added.back());
+                added.pop_back();
+            }
+            stack.pop_back();
+            continue;
+        }
+        int b = visit.block;
+        visit.mark = added.size();
+        visit.childrenDone = true;
+        numberBlock(b);
+
+        const std::vector<int>& children = domChildren[b];
+        for (auto child = children.rbegin(); child != children.rend(); ++child) stack.push_back(Visit{*child, 0, false});
+    }
+
+    if (changed) rewriteOperands();
+    return changed;
+}
+
+bool IROptimizer::eliminateDeadCode() {
+    types.compute(*program);
+
+    std::vector<bool> live(program->values.size(), false);
+    std::vector<int> worklist;
+    auto mark = [&](int id) {
+        if (!live[id]) {
+            live[id] = true;
+            worklist.push_back(id);
+        }
+    };
+
+    for (const auto& block : program->blocks) {
+        if (block.removed) continue;
+        if (block.cond >= 0) mark(block.cond);
+        for (int id : block.body) {
+            const IRInstr& instr = program->values[id];
+            if (instr.op == IROp::Print || types.mayThrow(id)) mark(id);
+        }
+    }
+
+    while (!worklist.empty()) {
+        int id = worklist.back();
+        worklist.pop_back();
+        for (int operand : program->values[id].operands) mark(operand);
+    }
+
+    bool changed = false;
+    for (const auto& block : program->blocks) {
+        for (int id : block.phis) {
+            if (!live[id]) program->values[id].removed = changed = true;
+        }
+        for (int id : block.body) {
+            if (!live[id]) program->values[id].removed = changed = true;
+        }
+    }
+    if (changed) rewriteOperands();
+    return changed;
+}
@@ -0,0 +1,48 @@
+#ifndef IR_OPTIMIZER_H
+#define IR_OPTIMIZER_H
+
+#include "IR.h"
+#include "IRTypes.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Scalar optimizations over an SSA program, iterated to a fixed point:
+//  - copy propagation: trivial phis and checks of defined values are
+//    replaced by their operand
+//  - global value numbering over the dominator tree, with constant folding
+//    of operations and branches
+//  - unreachable-block and dead-code elimination (dead stores disappear
+//    with the values they stored)
+//
+// Operations that may throw at run time (division by a possibly-zero value,
+// operand types that might not support the operator, reads of possibly
+// undefined variables) are never removed, so runtime errors still happen in
+// program order.
+class IROptimizer {
+public:
+    void run(IRProgram& program);
+
+private:
+    IRProgram* program = nullptr;
+    std::vector<int> forward;
+    IRTypes types;
+
+    std::vector<int> idom;
+    std::vector<std::vector<int>> domChildren;
+
+    int find(int value);
+    void replace(int value, int with);
+    void rewriteOperands();
+    void removeEdge(int from, int to);
+
+    std::vector<int> reversePostorder();
+    void computeDominators();
+
+    bool simplifyCopies();
+    bool numberValues();
+    bool removeUnreachable();
+    bool eliminateDeadCode();
+};
+
+#endif // IR_OPTIMIZER_H
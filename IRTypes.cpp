@@ -0,0 +1,120 @@
+#include "IRTypes.h"
+#include "Operators.h"
+#include <stdexcept>
+
+static Value sampleOf(int bit) {
+    switch (bit) {
+        case 1: return 1;
+        case 2: return 1.0f;
+        case 4: return 'a';
+        default: return SharedString("a");
+    }
+}
+
+int IRTypes::bitOf(const Value& value) {
+    switch (value.index()) {
+        case 0: return 1;
+        case 1: return 2;
+        case 2: return 4;
+        default: return 8;
+    }
+}
+
+int IRTypes::resultTypes(const IRInstr& instr, bool& mayFail) {
+    int leftTypes = types[instr.operands[0]];
+    int rightTypes = instr.op == IROp::Binary ? types[instr.operands[1]] : 1;
+    if (leftTypes == 0 || rightTypes == 0) {
+        mayFail = true;
+        return 0;
+    }
+
+    // Ask the real operator implementation what each type pair produces
+    int result = 0;
+    for (int l = 1; l <= String; l <<= 1) {
+        if (!(leftTypes & l)) continue;
+        for (int r = 1; r <= String; r <<= 1) {
+            if (!(rightTypes & r)) continue;
+
+            std::string key = std::to_string(static_cast<int>(instr.op)) + ":" + instr.opToken.text + ":" +
+                              std::to_string(l) + ":" + std::to_string(r);
+            auto cached = cache.find(key);
+            int type;
+            if (cached != cache.end()) {
+                type = cached->second;
+            } else {
+                try {
+                    Value v = instr.op == IROp::Binary ? applyBinaryOperator(instr.opToken, sampleOf(l), sampleOf(r))
+                                                       : applyUnaryOperator(instr.opToken, sampleOf(l));
+                    type = bitOf(v);
+                } catch (const std::runtime_error&) {
+                    type = -1;
+                }
+                cache.emplace(key, type);
+            }
+
+            if (type < 0) mayFail = true;
+            else result |= type;
+        }
+    }
+
+    if (instr.op == IROp::Binary && instr.opToken.type == TokenType::Slash && (rightTypes & Arith)) {
+        const IRInstr& divisor = program->values[instr.operands[1]];
+        bool nonZero = divisor.op == IROp::Const && isTruthy(divisor.constant) && divisor.constant.index() != 3;
+        if (!nonZero) mayFail = true;
+    }
+    return result;
+}
+
+void IRTypes::compute(const IRProgram& prog) {
+    program = &prog;
+    size_t count = program->values.size();
+    types.assign(count, 0);
+    undef.assign(count, false);
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t id = 0; id < count; ++id) {
+            const IRInstr& instr = program->values[id];
+            if (instr.removed) continue;
+
+            int type = 0;
+            bool maybeUndef = false;
+            bool mayFail = false;
+            switch (instr.op) {
+                case IROp::Const: type = bitOf(instr.constant); break;
+                case IROp::Undef: maybeUndef = true; break;
+                case IROp::Phi:
+                    for (int operand : instr.operands) {
+                        type |= types[operand];
+                        maybeUndef = maybeUndef || undef[operand];
+                    }
+                    break;
+                case IROp::Check: type = types[instr.operands[0]]; break;
+                case IROp::Binary:
+                case IROp::Unary: type = resultTypes(instr, mayFail); break;
+                case IROp::Print: break;
+            }
+
+            if ((types[id] | type) != types[id] || maybeUndef != undef[id]) {
+                types[id] |= type;
+                if (maybeUndef) undef[id] = true;
+                changed = true;
+            }
+        }
+    }
+}
+
+bool IRTypes::mayThrow(int value) {
+    const IRInstr& instr = program->values[value];
+    switch (instr.op) {
+        case IROp::Check: return undef[instr.operands[0]];
+        case IROp::Binary:
+        case IROp::Unary: {
+            bool mayFail = false;
+            resultTypes(instr, mayFail);
+            return mayFail;
+        }
+        default: return false;
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef IR_TYPES_H
+#define IR_TYPES_H
+
+#include "IR.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Type facts for SSA values: the set of runtime types each value may hold
+// and whether it may be undefined. Result types are learned by asking the
+// real operator implementation, so they cannot drift from the interpreter.
+class IRTypes {
+public:
+    enum Bits { Int = 1, Float = 2, Char = 4, String = 8, Arith = Int | Float | Char };
+
+    void compute(const IRProgram& program);
+
+    int of(int value) const { return types[value]; }
+    bool maybeUndefined(int value) const { return undef[value]; }
+
+    // Whether evaluating the instruction can raise a runtime error
+    bool mayThrow(int value);
+
+    // Result types of a Binary/Unary instruction given its operand types
+    int resultTypes(const IRInstr& instr, bool& mayFail);
+
+    static int bitOf(const Value& value);
+
+private:
+    const IRProgram* program = nullptr;
+    std::vector<int> types;
+    std::vector<bool> undef;
+    std::unordered_map<std::string, int> cache;
+};
+
+#endif // IR_TYPES_H
@@ -0,0 +1,274 @@
+// miniscript-idioms: counts the statement and expression shapes in a set of
+// scripts, to find idioms worth a fused node kind (see Fuser.h).
+#include "Parser.h"
+#include "RecursionGuard.h"
+#include "Tokenizer.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+static void usage() {
+    std::cerr << "Usage: miniscript-idioms [-n <rows>] <source-file>...\n"
+              << "  -n <rows>     patterns listed per table (default 15)" << std::endl;
+}
+
+namespace {
+
+// Uses are weighted by an estimate of how often they run: each loop around
+// a use (its body, condition or increment) counts as `loopWeight` runs of
+// the code outside it, up to `maxLoops` levels. Function bodies start again
+// at one, since nothing says how often they are called.
+constexpr uint64_t loopWeight = 10;
+constexpr int maxLoops = 6;
+
+struct Count {
+    size_t total = 0;
+    size_t inLoops = 0;   // inside at least one loop
+    uint64_t weight = 0;  // sum of loopWeight^loops over every use
+};
+
+using Counts = std::unordered_map<std::string, Count>;
+
+// A node's shape with its operands abstracted: literals become <int>,
+// <str> and so on, the assigned variable is `v` and any other variable is
+// `w`. Subexpressions past `depth` become <expr>.
+std::string shape(const Expr* expr, const SharedString& target, int depth) {
+    RecursionGuard guard;
+    switch (expr->kind) {
+        case ExprKind::Int: return "<int>";
+        case ExprKind::Float: return "<float>";
+        case ExprKind::Char: return "<char>";
+        case ExprKind::String: return "<str>";
+        case ExprKind::Variable: return static_cast<const VariableExpr*>(expr)->name == target ? "v" : "w";
+        default: break;
+    }
+    if (depth == 0) return "<expr>";
+    switch (expr->kind) {
+        case ExprKind::Binary: {
+            auto bin = static_cast<const BinaryExpr*>(expr);
+            std::string text = shape(bin->left.get(), target, depth - 1) + " " + bin->op.text + " " +
+                               shape(bin->right.get(), target, depth - 1);
+            return depth == 2 ? text : "(" + text + ")";
+        }
+        case ExprKind::Unary: {
+            auto unary = static_cast<const UnaryExpr*>(expr);
+            return unary->op.text + shape(unary->right.get(), target, depth - 1);
+        }
+        case ExprKind::Index: {
+            auto index = static_cast<const IndexExpr*>(expr);
+            return shape(index->object.get(), target, depth - 1) + "[" + shape(index->index.get(), target, depth - 1) + "]";
+        }
+        case ExprKind::Call: return static_cast<const CallExpr*>(expr)->name.str() + "(...)";
+        case ExprKind::Map: return "{...}";
+        default: return "<expr>";
+    }
+}
+
+class Miner {
+public:
+    Counts statements;
+    Counts expressions;
+
+    void stmt(const Stmt* s, int loops) {
+        RecursionGuard guard;
+        if (!s) return;
+        switch (s->kind) {
+            case StmtKind::Print: {
+                auto printStmt = static_cast<const PrintStmt*>(s);
+                add(statements, "print " + shape(printStmt->expression.get(), SharedString(), 2), loops);
+                expr(printStmt->expression.get(), loops);
+                break;
+            }
+            case StmtKind::Assign: {
+                auto assign = static_cast<const AssignStmt*>(s);
+                add(statements, "v = " + shape(assign->value.get(), assign->name, 2), loops);
+                expr(assign->value.get(), loops);
+                break;
+            }
+            case StmtKind::If: {
+                auto ifStmt = static_cast<const IfStmt*>(s);
+                expr(ifStmt->condition.get(), loops);
+                stmt(ifStmt->thenBranch.get(), loops);
+                stmt(ifStmt->elseBranch.get(), loops);
+                break;
+            }
+            case StmtKind::While: {
+                auto whileStmt = static_cast<const WhileStmt*>(s);
+                expr(whileStmt->condition.get(), loops + 1);
+                stmt(whileStmt->body.get(), loops + 1);
+                break;
+            }
+            case StmtKind::For: {
+                auto forStmt = static_cast<const ForStmt*>(s);
+                stmt(forStmt->initializer.get(), loops);
+                if (forStmt->condition) expr(forStmt->condition.get(), loops + 1);
+                stmt(forStmt->increment.get(), loops + 1);
+                stmt(forStmt->body.get(), loops + 1);
+                break;
+            }
+            case StmtKind::Block:
+                for (const auto& child : static_cast<const BlockStmt*>(s)->statements) stmt(child.get(), loops);
+                break;
+            case StmtKind::IndexAssign: {
+                auto assign = static_cast<const IndexAssignStmt*>(s);
+                add(statements, shape(assign->object.get(), SharedString(), 1) + "[" +
+                                    shape(assign->index.get(), SharedString(), 1) + "] = " +
+                                    shape(assign->value.get(), SharedString(), 2), loops);
+                expr(assign->object.get(), loops);
+                expr(assign->index.get(), loops);
+                expr(assign->value.get(), loops);
+                break;
+            }
+            case StmtKind::ForIn: {
+                auto forIn = static_cast<const ForInStmt*>(s);
+                expr(forIn->map.get(), loops);
+                stmt(forIn->body.get(), loops + 1);
+                break;
+            }
+            case StmtKind::Function: stmt(static_cast<const FunctionStmt*>(s)->body.get(), 0); break;
+            case StmtKind::Return: {
+                auto returnStmt = static_cast<const ReturnStmt*>(s);
+                if (returnStmt->value) {
+                    add(statements, "return " + shape(returnStmt->value.get(), SharedString(), 2), loops);
+                    expr(returnStmt->value.get(), loops);
+                }
+                break;
+            }
+            case StmtKind::LazyBlock: stmt(static_cast<const LazyBlockStmt*>(s)->body(), loops); break;
+            default: break;
+        }
+    }
+
+private:
+    static void add(Counts& counts, const std::string& pattern, int loops) {
+        Count& count = counts[pattern];
+        ++count.total;
+        if (loops > 0) ++count.inLoops;
+        uint64_t weight = 1;
+        for (int i = 0; i < std::min(loops, maxLoops); ++i) weight *= loopWeight;
+        count.weight += weight;
+    }
+
+    // Counts every operator node whose operands are leaves
+    void expr(const Expr* e, int loops) {
+        RecursionGuard guard;
+        switch (e->kind) {
+            case ExprKind::Binary: {
+                auto bin = static_cast<const BinaryExpr*>(e);
+                if (isLeaf(bin->left.get()) && isLeaf(bin->right.get())) add(expressions, shape(e, SharedString(), 2), loops);
+                expr(bin->left.get(), loops);
+                expr(bin->right.get(), loops);
+                break;
+            }
+            case ExprKind::Unary: expr(static_cast<const UnaryExpr*>(e)->right.get(), loops); break;
+            case ExprKind::Map: {
+                auto map = static_cast<const MapExpr*>(e);
+                for (size_t i = 0; i < map->keys.size(); ++i) {
+                    expr(map->keys[i].get(), loops);
+                    expr(map->values[i].get(), loops);
+                }
+                break;
+            }
+            case ExprKind::Index: {
+                auto index = static_cast<const IndexExpr*>(e);
+                expr(index->object.get(), loops);
+                expr(index->index.get(), loops);
+                break;
+            }
+            case ExprKind::Call:
+                for (const auto& arg : static_cast<const CallExpr*>(e)->args) expr(arg.get(), loops);
+                break;
+            default: break;
+        }
+    }
+
+    static bool isLeaf(const Expr* e) {
+        return e->kind == ExprKind::Int || e->kind == ExprKind::Float || e->kind == ExprKind::Char ||
+               e->kind == ExprKind::String || e->kind == ExprKind::Variable;
+    }
+};
+
+// Most frequent first, by loop-weighted uses and then overall
+void printTable(const char* title, const Counts& counts, size_t rows) {
+    std::vector<std::pair<std::string, Count>> sorted(counts.begin(), counts.end());
+    std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) {
+        if (a.second.weight != b.second.weight) return a.second.weight > b.second.weight;
+        if (a.second.total != b.second.total) return a.second.total > b.second.total;
+        return a.first < b.first;
+    });
+    size_t total = 0;
+    for (const auto& entry : sorted) total += entry.second.total;
+
+    std::cout << title << " (" << total << ")\n";
+    std::cout << std::setw(8) << "count" << std::setw(10) << "in loops" << std::setw(12) << "weighted"
+              << "  pattern\n";
+    for (size_t i = 0; i < sorted.size() && i < rows; ++i) {
+        std::cout << std::setw(8) << sorted[i].second.total << std::setw(10) << sorted[i].second.inLoops
+                  << std::setw(12) << sorted[i].second.weight << "  " << sorted[i].first << '\n';
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t rows = 15;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-n") {
+            const char* text = i + 1 < argc ? argv[++i] : "";
+            auto [end, error] = std::from_chars(text, text + std::strlen(text), rows);
+            if (error != std::errc() || *end != '\0' || rows == 0) {
+                std::cerr << "-n takes a positive number of rows, got '" << text << "'" << std::endl;
+                usage();
+                return 1;
+            }
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            usage();
+            return 1;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.empty()) {
+        usage();
+        return 1;
+    }
+
+    Miner miner;
+    size_t files = 0;
+    for (const std::string& path : paths) {
+        std::ifstream file(path);
+        if (!file) {
+            std::cerr << "Could not open file: " << path << std::endl;
+            continue;
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        std::string source = buffer.str();
+
+        std::vector<Token> tokens = Tokenizer::tokenize(source);
+        try {
+            auto statements = Parser(tokens, false).parse();
+            for (const auto& stmt : statements) miner.stmt(stmt.get(), 0);
+            ++files;
+        } catch (const std::runtime_error& e) {
+            std::cerr << path << ": skipped: " << e.what() << std::endl;
+        }
+    }
+
+    std::cout << files << " of " << paths.size() << " files\n\n";
+    printTable("Statements", miner.statements, rows);
+    std::cout << '\n';
+    printTable("Operators with leaf operands", miner.expressions, rows);
+    return 0;
+}
@@ -0,0 +1,310 @@
+#include "Inliner.h"
+#include "Native.h"
+
+namespace {
+
+using Declarations = std::unordered_map<SharedString, int, SharedStringHash>;
+
+bool isLiteral(const Expr* expr) {
+    return expr->kind == ExprKind::Int || expr->kind == ExprKind::Float || expr->kind == ExprKind::Char ||
+           expr->kind == ExprKind::String;
+}
+
+// Counts the nodes of `expr`, giving up past `limit` or at a call to a script function
+bool small(const Expr* expr, const Declarations& declarations, size_t& nodes, size_t limit) {
+    if (++nodes > limit) return false;
+    switch (expr->kind) {
+        case ExprKind::Binary: {
+            auto bin = static_cast<const BinaryExpr*>(expr);
+            return small(bin->left.get(), declarations, nodes, limit) &&
+                   small(bin->right.get(), declarations, nodes, limit);
+        }
+        case ExprKind::Unary: return small(static_cast<const UnaryExpr*>(expr)->right.get(), declarations, nodes, limit);
+        case ExprKind::Map: {
+            auto map = static_cast<const MapExpr*>(expr);
+            for (size_t i = 0; i < map->keys.size(); ++i) {
+                if (!small(map->keys[i].get(), declarations, nodes, limit) ||
+                    !small(map->values[i].get(), declarations, nodes, limit))
+                    return false;
+            }
+            return true;
+        }
+        case ExprKind::Index: {
+            auto index = static_cast<const IndexExpr*>(expr);
+            return small(index->object.get(), declarations, nodes, limit) &&
+                   small(index->index.get(), declarations, nodes, limit);
+        }
+        case ExprKind::Call: {
+            auto call = static_cast<const CallExpr*>(expr);
+            if (declarations.count(call->name)) return false;
+            for (const auto& arg : call->args) {
+                if (!small(arg.get(), declarations, nodes, limit)) return false;
+            }
+            return true;
+        }
+        default: return true;
+    }
+}
+
+// The returned expression of a qualifying function, or nullptr
+const Expr* inlinableBody(const FunctionStmt* function, const Declarations& declarations) {
+    const Stmt* body = function->body.get();
+    if (body->kind == StmtKind::Block) {
+        auto block = static_cast<const BlockStmt*>(body);
+        if (block->statements.size() != 1) return nullptr;
+        body = block->statements[0].get();
+    }
+    if (body->kind != StmtKind::Return) return nullptr;
+    const Expr* value = static_cast<const ReturnStmt*>(body)->value.get();
+    size_t nodes = 0;
+    return value && small(value, declarations, nodes, Inliner::maxNodes) ? value : nullptr;
+}
+
+// Walks the body in evaluation order. Variable arguments must be read in
+// parameter order, each before any operation that can fail: an operator,
+// index, call, map literal or read of a global.
+class ReadOrder {
+public:
+    explicit ReadOrder(const std::vector<std::unique_ptr<Expr>>& args) : args(args) {
+        for (size_t i = 0; i < args.size(); ++i) {
+            if (args[i]->kind == ExprKind::Variable) pending.push_back(i);
+        }
+    }
+
+    bool check(const Expr* body) { return visit(body) && next == pending.size(); }
+
+private:
+    const std::vector<std::unique_ptr<Expr>>& args;
+    std::vector<size_t> pending;  // parameters with variable arguments
+    size_t next = 0;              // pending[next] is the next one to read
+
+    bool mayFail() const { return next == pending.size(); }
+
+    bool visit(const Expr* expr) {
+        switch (expr->kind) {
+            case ExprKind::Variable: {
+                int local = static_cast<const VariableExpr*>(expr)->local;
+                if (local < 0) return mayFail();
+                size_t param = static_cast<size_t>(local);
+                if (args[param]->kind != ExprKind::Variable) return true;
+                for (size_t k = 0; k < next; ++k) {
+                    if (pending[k] == param) return true;
+                }
+                if (pending[next] != param) return false;
+                ++next;
+                return true;
+            }
+            case ExprKind::Binary: {
+                auto bin = static_cast<const BinaryExpr*>(expr);
+                return visit(bin->left.get()) && visit(bin->right.get()) && mayFail();
+            }
+            case ExprKind::Unary: return visit(static_cast<const UnaryExpr*>(expr)->right.get()) && mayFail();
+            case ExprKind::Map: {
+                auto map = static_cast<const MapExpr*>(expr);
+                for (size_t i = 0; i < map->keys.size(); ++i) {
+                    if (!visit(map->keys[i].get()) || !visit(map->values[i].get())) return false;
+                }
+                return mayFail();
+            }
+            case ExprKind::Index: {
+                auto index = static_cast<const IndexExpr*>(expr);
+                return visit(index->object.get()) && visit(index->index.get()) && mayFail();
+            }
+            case ExprKind::Call: {
+                for (const auto& arg : static_cast<const CallExpr*>(expr)->args) {
+                    if (!visit(arg.get())) return false;
+                }
+                return mayFail();
+            }
+            default: return true;
+        }
+    }
+};
+
+// A copy of `expr` with parameters replaced by copies of their arguments
+std::unique_ptr<Expr> substitute(const Expr* expr, const std::vector<std::unique_ptr<Expr>>& args) {
+    switch (expr->kind) {
+        case ExprKind::Int: return std::make_unique<IntExpr>(static_cast<const IntExpr*>(expr)->value);
+        case ExprKind::Float: return std::make_unique<FloatExpr>(static_cast<const FloatExpr*>(expr)->value);
+        case ExprKind::Char: return std::make_unique<CharExpr>(static_cast<const CharExpr*>(expr)->value);
+        case ExprKind::String: return std::make_unique<StringExpr>(static_cast<const StringExpr*>(expr)->value);
+        case ExprKind::Variable: {
+            auto var = static_cast<const VariableExpr*>(expr);
+            if (var->local < 0) return std::make_unique<VariableExpr>(var->name, scope::global);
+            const Expr* arg = args[static_cast<size_t>(var->local)].get();
+            if (arg->kind != ExprKind::Variable) return substitute(arg, args);
+            auto argVar = static_cast<const VariableExpr*>(arg);
+            return std::make_unique<VariableExpr>(argVar->name, argVar->local);
+        }
+        case ExprKind::CompareConst:  // copied unfused
+        case ExprKind::Binary: {
+            auto bin = static_cast<const BinaryExpr*>(expr);
+            return std::make_unique<BinaryExpr>(substitute(bin->left.get(), args), bin->op,
+                                                substitute(bin->right.get(), args));
+        }
+        case ExprKind::Unary: {
+            auto unary = static_cast<const UnaryExpr*>(expr);
+            return std::make_unique<UnaryExpr>(unary->op, substitute(unary->right.get(), args));
+        }
+        case ExprKind::Map: {
+            auto map = static_cast<const MapExpr*>(expr);
+            std::vector<std::unique_ptr<Expr>> keys, values;
+            for (size_t i = 0; i < map->keys.size(); ++i) {
+                keys.push_back(substitute(map->keys[i].get(), args));
+                values.push_back(substitute(map->values[i].get(), args));
+            }
+            return std::make_unique<MapExpr>(std::move(keys), std::move(values));
+        }
+        case ExprKind::Index: {
+            auto index = static_cast<const IndexExpr*>(expr);
+            return std::make_unique<IndexExpr>(substitute(index->object.get(), args),
+                                               substitute(index->index.get(), args));
+        }
+        case ExprKind::Call: {
+            auto call = static_cast<const CallExpr*>(expr);
+            std::vector<std::unique_ptr<Expr>> callArgs;
+            for (const auto& arg : call->args) callArgs.push_back(substitute(arg.get(), args));
+            return std::make_unique<CallExpr>(call->name, call->slot, std::move(callArgs));
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+size_t Inliner::run(std::vector<std::unique_ptr<Stmt>>& program) {
+    Declarations declarations;
+    for (const auto& stmt : program) {
+        if (stmt->kind == StmtKind::Function) ++declarations[static_cast<const FunctionStmt*>(stmt.get())->name];
+    }
+    if (declarations.empty()) return 0;
+
+    // A function's own calls are inlined before it becomes a candidate
+    candidates.clear();
+    inlined = 0;
+    for (const auto& stmt : program) {
+        if (!candidates.empty()) rewrite(stmt.get());
+        if (stmt->kind != StmtKind::Function) continue;
+        auto function = static_cast<const FunctionStmt*>(stmt.get());
+        if (declarations[function->name] != 1 || function->slot == NativeRegistry::noSlot) continue;
+        if (const Expr* body = inlinableBody(function, declarations))
+            candidates.emplace(function->slot, Candidate{function, body});
+    }
+    return inlined;
+}
+
+// Visits every expression below `root` with explicit stacks, since the
+// program may be nested far deeper than the machine stack allows
+void Inliner::rewrite(Stmt* root) {
+    std::vector<Stmt*> stmts{root};
+    std::vector<std::unique_ptr<Expr>*> exprs;
+    auto addStmt = [&](const std::unique_ptr<Stmt>& stmt) {
+        if (stmt) stmts.push_back(stmt.get());
+    };
+    auto addExpr = [&](std::unique_ptr<Expr>& expr) {
+        if (expr) exprs.push_back(&expr);
+    };
+
+    while (!stmts.empty()) {
+        Stmt* stmt = stmts.back();
+        stmts.pop_back();
+        switch (stmt->kind) {
+            case StmtKind::Print: addExpr(static_cast<PrintStmt*>(stmt)->expression); break;
+            case StmtKind::Assign: addExpr(static_cast<AssignStmt*>(stmt)->value); break;
+            case StmtKind::If: {
+                auto ifStmt = static_cast<IfStmt*>(stmt);
+                addExpr(ifStmt->condition);
+                addStmt(ifStmt->thenBranch);
+                addStmt(ifStmt->elseBranch);
+                break;
+            }
+            case StmtKind::While: {
+                auto whileStmt = static_cast<WhileStmt*>(stmt);
+                addExpr(whileStmt->condition);
+                addStmt(whileStmt->body);
+                break;
+            }
+            case StmtKind::For: {
+                auto forStmt = static_cast<ForStmt*>(stmt);
+                addStmt(forStmt->initializer);
+                addExpr(forStmt->condition);
+                addStmt(forStmt->increment);
+                addStmt(forStmt->body);
+                break;
+            }
+            case StmtKind::Block:
+                for (const auto& child : static_cast<BlockStmt*>(stmt)->statements) addStmt(child);
+                break;
+            case StmtKind::IndexAssign: {
+                auto assign = static_cast<IndexAssignStmt*>(stmt);
+                addExpr(assign->object);
+                addExpr(assign->index);
+                addExpr(assign->value);
+                break;
+            }
+            case StmtKind::Remove: {
+                auto removeStmt = static_cast<RemoveStmt*>(stmt);
+                addExpr(removeStmt->object);
+                addExpr(removeStmt->index);
+                break;
+            }
+            case StmtKind::ForIn: {
+                auto forIn = static_cast<ForInStmt*>(stmt);
+                addExpr(forIn->map);
+                addStmt(forIn->body);
+                break;
+            }
+            case StmtKind::Function: addStmt(static_cast<FunctionStmt*>(stmt)->body); break;
+            case StmtKind::Return: addExpr(static_cast<ReturnStmt*>(stmt)->value); break;
+            case StmtKind::LazyBlock: break;  // left unparsed; its calls stay calls
+            default: break;
+        }
+    }
+
+    while (!exprs.empty()) {
+        std::unique_ptr<Expr>& slot = *exprs.back();
+        exprs.pop_back();
+        switch (slot->kind) {
+            case ExprKind::Binary: {
+                auto bin = static_cast<BinaryExpr*>(slot.get());
+                addExpr(bin->left);
+                addExpr(bin->right);
+                break;
+            }
+            case ExprKind::Unary: addExpr(static_cast<UnaryExpr*>(slot.get())->right); break;
+            case ExprKind::Map: {
+                auto map = static_cast<MapExpr*>(slot.get());
+                for (auto& key : map->keys) addExpr(key);
+                for (auto& value : map->values) addExpr(value);
+                break;
+            }
+            case ExprKind::Index: {
+                auto index = static_cast<IndexExpr*>(slot.get());
+                addExpr(index->object);
+                addExpr(index->index);
+                break;
+            }
+            case ExprKind::Call: {
+                auto call = static_cast<CallExpr*>(slot.get());
+                if (auto replacement = expand(call)) {
+                    slot = std::move(replacement);
+                    ++inlined;
+                    break;
+                }
+                for (auto& arg : call->args) addExpr(arg);
+                break;
+            }
+            default: break;
+        }
+    }
+}
+
+std::unique_ptr<Expr> Inliner::expand(const CallExpr* call) const {
+    auto found = candidates.find(call->slot);
+    if (found == candidates.end() || call->args.size() != found->second.function->params.size()) return nullptr;
+    for (const auto& arg : call->args) {
+        if (!isLiteral(arg.get()) && arg->kind != ExprKind::Variable) return nullptr;
+    }
+    if (!ReadOrder(call->args).check(found->second.body)) return nullptr;
+    return substitute(found->second.body, call->args);
+}
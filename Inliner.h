@@ -0,0 +1,41 @@
+#ifndef INLINER_H
+#define INLINER_H
+
+#include "AST.h"
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Replaces calls to small script functions with the expression they return,
+// so that those calls cost no call frame. A function qualifies when it is
+// declared once in the program and its body is `return <expr>;` (braces
+// optional), where <expr> has at most `maxNodes` nodes and calls no script
+// function. Inlining therefore never recurses, but a function whose own calls
+// were all inlined qualifies in turn.
+//
+// A call is replaced when it comes after the declaration (in a later
+// top-level statement or function), passes one argument per parameter, and
+// every argument is a literal or a variable. Literals cannot fail; variable
+// arguments are accepted only if <expr> reads them in parameter order before
+// anything that can fail, so runtime errors happen exactly as before.
+class Inliner {
+public:
+    static constexpr size_t maxNodes = 32;
+
+    // Returns the number of calls replaced
+    size_t run(std::vector<std::unique_ptr<Stmt>>& program);
+
+private:
+    struct Candidate {
+        const FunctionStmt* function;
+        const Expr* body;
+    };
+    std::unordered_map<uint32_t, Candidate> candidates;  // by NativeRegistry slot
+    size_t inlined = 0;
+
+    void rewrite(Stmt* root);
+    std::unique_ptr<Expr> expand(const CallExpr* call) const;
+};
+
+#endif // INLINER_H
@@ -0,0 +1,174 @@
+#include "InputReader.h"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+InputReader::~InputReader() { close(); }
+
+// --- Sources ---
+void InputReader::open(const std::string& path) {
+    int descriptor = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (descriptor < 0) throw std::runtime_error("input() cannot open '" + path + "': " + std::strerror(errno));
+    close();
+    attach(descriptor);
+}
+
+void InputReader::attach(int descriptor) {
+    fd = descriptor;
+    opened = true;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+        // Start where the descriptor is, in case stdin was partly read already
+        off_t offset = lseek(fd, 0, SEEK_CUR);
+        size_t size = static_cast<size_t>(info.st_size);
+        void* map = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        if (map != MAP_FAILED) {
+            madvise(map, size, MADV_SEQUENTIAL);
+            mapped = static_cast<const char*>(map);
+            mappedSize = size;
+            data = mapped;
+            begin = offset > 0 ? std::min(static_cast<size_t>(offset), size) : 0;
+            end = size;
+            atEof = true;
+            return;
+        }
+    }
+    buffer.resize(blockSize);
+    data = buffer.data();
+    begin = end = 0;
+    atEof = false;
+}
+
+void InputReader::close() {
+    if (mapped) munmap(const_cast<char*>(mapped), mappedSize);
+    if (fd > STDIN_FILENO) ::close(fd);
+    mapped = nullptr;
+    mappedSize = 0;
+    fd = -1;
+    data = nullptr;
+    begin = end = 0;
+    atEof = false;
+    current = {};
+    split = false;
+}
+
+// Reads another block after the unread tail, growing the buffer if one line
+// fills it. False at the end of the input.
+bool InputReader::fill() {
+    std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+    end -= begin;
+    begin = 0;
+    if (end == buffer.size()) buffer.resize(buffer.size() * 2);
+    data = buffer.data();
+
+    ssize_t count;
+    do {
+        count = read(fd, buffer.data() + end, buffer.size() - end);
+    } while (count < 0 && errno == EINTR);
+    if (count < 0) throw std::runtime_error(std::string("readline() failed: ") + std::strerror(errno));
+    if (count == 0) atEof = true;
+    end += static_cast<size_t>(count);
+    return count > 0;
+}
+
+// --- Lines ---
+bool InputReader::next() {
+    if (!opened) attach(STDIN_FILENO);
+    split = false;
+    while (true) {
+        const char* start = data + begin;
+        size_t available = end - begin;
+        if (auto newline = available ? static_cast<const char*>(std::memchr(start, '\n', available)) : nullptr) {
+            current = std::string_view(start, static_cast<size_t>(newline - start));
+            begin += current.size() + 1;
+            return true;
+        }
+        if (atEof) {
+            // A last line without '\n'
+            current = std::string_view(available ? start : "", available);
+            begin = end;
+            return available > 0;
+        }
+        fill();
+    }
+}
+
+// --- Fields ---
+void InputReader::setSeparator(std::string_view text) {
+    separator = std::string(text);
+    split = false;
+}
+
+size_t InputReader::fieldCount() {
+    if (split) return fields.size();
+    fields.clear();
+    split = true;
+    if (current.empty()) return 0;
+
+    if (separator.empty()) {
+        size_t i = 0;
+        while (true) {
+            while (i < current.size() && (current[i] == ' ' || current[i] == '\t')) ++i;
+            if (i == current.size()) break;
+            size_t start = i;
+            while (i < current.size() && current[i] != ' ' && current[i] != '\t') ++i;
+            fields.push_back(current.substr(start, i - start));
+        }
+    } else {
+        size_t start = 0;
+        while (true) {
+            size_t at = current.find(separator, start);
+            if (at == std::string_view::npos) break;
+            fields.push_back(current.substr(start, at - start));
+            start = at + separator.size();
+        }
+        fields.push_back(current.substr(start));
+    }
+    return fields.size();
+}
+
+std::string_view InputReader::field(size_t index) {
+    if (index >= fieldCount()) throw std::runtime_error("field index " + std::to_string(index) + " is out of range");
+    return fields[index];
+}
+
+// --- Script Functions ---
+namespace {
+
+std::string_view fieldAt(InputReader& reader, int index, const char* function) {
+    if (index < 0 || static_cast<size_t>(index) >= reader.fieldCount())
+        throw std::runtime_error(std::string(function) + "() index " + std::to_string(index) + " is out of range");
+    return reader.field(static_cast<size_t>(index));
+}
+
+// Parses a whole field, ignoring surrounding blanks, without copying it
+template <typename T>
+T parseField(InputReader& reader, int index, const char* function) {
+    std::string_view text = fieldAt(reader, index, function);
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) text.remove_suffix(1);
+    T result = 0;
+    auto [last, error] = std::from_chars(text.data(), text.data() + text.size(), result);
+    if (error != std::errc() || last != text.data() + text.size() || text.empty())
+        throw std::runtime_error(std::string(function) + "() cannot convert \"" + std::string(text) + "\"");
+    return result;
+}
+
+} // namespace
+
+void InputReader::install(NativeRegistry& registry, std::shared_ptr<InputReader> reader) {
+    registry.define("input", [reader](const std::string& path) { reader->open(path); });
+    registry.define("readline", [reader]() { return reader->next(); });
+    registry.define("line", [reader]() { return reader->line(); });
+    registry.define("fields", [reader]() { return static_cast<int>(reader->fieldCount()); });
+    registry.define("field", [reader](int index) { return fieldAt(*reader, index, "field"); });
+    registry.define("fieldint", [reader](int index) { return parseField<int>(*reader, index, "fieldint"); });
+    registry.define("fieldfloat", [reader](int index) { return parseField<float>(*reader, index, "fieldfloat"); });
+    registry.define("separator", [reader](std::string_view text) { reader->setSeparator(text); });
+}
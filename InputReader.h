@@ -0,0 +1,75 @@
+#ifndef INPUT_READER_H
+#define INPUT_READER_H
+
+#include "Native.h"
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Reads a file or stdin one line at a time for the input builtins. A regular
+// file is mapped whole; a pipe or terminal is read in large blocks. The
+// current line and its fields are views into the mapping or the block
+// buffer, valid until the next call to next(), so reading a line, splitting
+// it and parsing numbers from it allocate nothing. Scripts only see that
+// through readline(), fields(), fieldint() and fieldfloat(): line() and
+// field() return a script string, which copies the text into a new
+// allocation on every call.
+class InputReader {
+public:
+    static constexpr size_t blockSize = 1 << 20;
+
+    InputReader() = default;
+    ~InputReader();
+    InputReader(const InputReader&) = delete;
+    InputReader& operator=(const InputReader&) = delete;
+
+    // Reads `path` from now on instead of stdin; throws std::runtime_error
+    void open(const std::string& path);
+
+    // Moves to the next line, without its '\n'; false at the end of the input
+    bool next();
+    std::string_view line() const { return current; }
+
+    // Fields are separated by runs of blanks by default, otherwise by every
+    // occurrence of `separator`
+    void setSeparator(std::string_view separator);
+    size_t fieldCount();
+    std::string_view field(size_t index);  // throws if out of range
+
+    // Adds the script functions reading from `reader` to `registry`:
+    //   input(path)   read `path` instead of stdin
+    //   readline()    1 after moving to the next line, 0 at the end
+    //   line()        the current line (a new string each call)
+    //   fields()      the number of fields in it
+    //   field(i)      field i, counting from 0 (a new string each call)
+    //   fieldint(i), fieldfloat(i)   field i parsed as a number, with no copy
+    //   separator(s)  split fields on `s`; "" means runs of blanks
+    static void install(NativeRegistry& registry, std::shared_ptr<InputReader> reader);
+
+private:
+    int fd = -1;
+    bool opened = false;  // stdin is opened on the first read
+
+    // A mapped file is one block holding the whole input
+    const char* mapped = nullptr;
+    size_t mappedSize = 0;
+
+    std::vector<char> buffer;
+    const char* data = nullptr;  // unread input is [data + begin, data + end)
+    size_t begin = 0;
+    size_t end = 0;
+    bool atEof = false;
+
+    std::string_view current;
+    std::string separator;
+    std::vector<std::string_view> fields;
+    bool split = false;  // `fields` holds the current line's fields
+
+    void attach(int descriptor);
+    void close();
+    bool fill();
+};
+
+#endif // INPUT_READER_H
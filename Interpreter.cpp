@@ -1,203 +1,696 @@
 #include "Interpreter.h"
+#include "AllocProfiler.h"
+#include "Map.h"
+#include "Operators.h"
+#include "Parser.h"
+#include <algorithm>
+#include <climits>
+#include <sstream>
 
-Interpreter::Interpreter() : env() {}
+Interpreter::Interpreter(std::ostream& out, std::ostream& err)
+    : env(), registry(NativeRegistry::standard()), output(&out), errors(&err) {}
 
-void Interpreter::interpret(const std::vector<std::unique_ptr<Stmt>>& statements) {
+bool Interpreter::interpret(const std::vector<std::unique_ptr<Stmt>>& statements) {
+    bool ok = true;
     try {
         for (const auto& stmt : statements) {
             executeStmt(stmt.get());
         }
+    } catch (const ParseError&) {
+        // A body deferred by lazy parsing was malformed: not a runtime error
+        if (pool) reportLoops();
+        throw;
     } catch (const std::runtime_error& e) {
-        std::cerr << "Runtime error: " << e.what() << std::endl;
+        *errors << "Runtime error: " << e.what() << std::endl;
+        ok = false;
     }
+    if (pool) reportLoops();
+    return ok;
 }
 
-Value Interpreter::evaluateExpr(const Expr* expr) {
-    if (auto intExpr = dynamic_cast<const IntExpr*>(expr)) {
-        return intExpr->value;
+void Interpreter::defineFunctions(const std::vector<std::unique_ptr<Stmt>>& statements) {
+    for (const auto& stmt : statements) {
+        if (stmt->kind == StmtKind::Function) define(static_cast<const FunctionStmt*>(stmt.get()));
     }
+}
 
-    if (auto floatExpr = dynamic_cast<const FloatExpr*>(expr)) {
-        return floatExpr->value;
-    }
+bool Interpreter::interpret(const std::vector<std::unique_ptr<Stmt>>& statements, ExecutionCache& cache) {
+    std::ostream* console = output;
+    bool ok = true;
+    try {
+        for (const auto& stmt : statements) {
+            // A top-level break or continue skips the rest of the program
+            if (breakLoop || continueLoop) break;
+
+            // Declarations have no effects to replay, only a function to define
+            if (stmt->kind == StmtKind::Function) {
+                executeStmt(stmt.get());
+                continue;
+            }
+
+            std::string description = ExecutionCache::describe(stmt.get());
+            uint64_t key = ExecutionCache::fingerprint(description);
+            if (const ExecutionCache::Entry* entry = cache.lookup(key, description, env)) {
+                for (const auto& [name, value] : entry->writes) env.set(name, value);
+                *console << entry->output << std::flush;
+                continue;
+            }
+
+            AccessLog log;
+            std::ostringstream captured;
+            calledImpure = false;
+            env.setAccessLog(&log);
+            output = &captured;
+            try {
+                executeStmt(stmt.get());
+            } catch (...) {
+                env.setAccessLog(nullptr);
+                output = console;
+                *console << captured.str() << std::flush;
+                throw;
+            }
+            env.setAccessLog(nullptr);
+            output = console;
+            *console << captured.str() << std::flush;
 
-    if (auto charExpr = dynamic_cast<const CharExpr*>(expr)) {
-        return charExpr->value;
+            if (!breakLoop && !continueLoop && !calledImpure) cache.record(key, std::move(description), log, captured.str());
+        }
+    } catch (const ParseError&) {
+        // A body deferred by lazy parsing was malformed: not a runtime error
+        if (pool) reportLoops();
+        throw;
+    } catch (const std::runtime_error& e) {
+        *errors << "Runtime error: " << e.what() << std::endl;
+        ok = false;
     }
+    if (pool) reportLoops();
+    return ok;
+}
 
-    if (auto stringExpr = dynamic_cast<const StringExpr*>(expr)) {
-        return stringExpr->value;
+void Interpreter::enableParallelLoops(unsigned threads) {
+    // The calling thread works too, so the pool only needs the extra threads
+    pool = std::make_unique<ThreadPool>(threads > 1 ? threads - 1 : 1);
+}
+
+// --- Expressions ---
+// Operands are evaluated left to right on an explicit stack, so expression
+// depth is not limited by the machine stack. Leaves skip the stack entirely.
+Value Interpreter::evaluateExpr(const Expr* expr) {
+    switch (expr->kind) {
+        case ExprKind::Int: return static_cast<const IntExpr*>(expr)->value;
+        case ExprKind::Float: return static_cast<const FloatExpr*>(expr)->value;
+        case ExprKind::Char: return static_cast<const CharExpr*>(expr)->value;
+        case ExprKind::String: return static_cast<const StringExpr*>(expr)->value;
+        case ExprKind::Variable: return lookup(static_cast<const VariableExpr*>(expr));
+        case ExprKind::CompareConst: return compare(static_cast<const CompareConstExpr*>(expr));
+        default: break;
     }
 
-    if (auto var = dynamic_cast<const VariableExpr*>(expr)) {
-        if (!env.exists(var->name))
-            throw std::runtime_error("Undefined variable: " + var->name);
-        return env.get(var->name);
+    size_t frameBase = evalFrames.size();
+    size_t valueBase = evalValues.size();
+    try {
+        evalFrames.push_back(EvalFrame{expr, false});
+        while (evalFrames.size() > frameBase) {
+            EvalFrame frame = evalFrames.back();
+            const Expr* e = frame.expr;
+            AllocProfiler::atExpr(e->kind);
+            switch (e->kind) {
+                case ExprKind::Binary: {
+                    auto bin = static_cast<const BinaryExpr*>(e);
+                    if (!frame.operandsDone) {
+                        evalFrames.back().operandsDone = true;
+                        evalFrames.push_back(EvalFrame{bin->right.get(), false});
+                        evalFrames.push_back(EvalFrame{bin->left.get(), false});
+                        continue;
+                    }
+                    Value right = std::move(evalValues.back());
+                    evalValues.pop_back();
+                    evalValues.back() = applyBinaryOperator(bin->op, evalValues.back(), right);
+                    break;
+                }
+                case ExprKind::Unary: {
+                    auto unary = static_cast<const UnaryExpr*>(e);
+                    if (!frame.operandsDone) {
+                        evalFrames.back().operandsDone = true;
+                        evalFrames.push_back(EvalFrame{unary->right.get(), false});
+                        continue;
+                    }
+                    evalValues.back() = applyUnaryOperator(unary->op, evalValues.back());
+                    break;
+                }
+                case ExprKind::Map: {
+                    auto mapExpr = static_cast<const MapExpr*>(e);
+                    size_t entries = mapExpr->keys.size();
+                    if (!frame.operandsDone) {
+                        evalFrames.back().operandsDone = true;
+                        for (size_t i = entries; i-- > 0;) {
+                            evalFrames.push_back(EvalFrame{mapExpr->values[i].get(), false});
+                            evalFrames.push_back(EvalFrame{mapExpr->keys[i].get(), false});
+                        }
+                        continue;
+                    }
+                    MapRef map = MapRef::create();
+                    size_t first = evalValues.size() - 2 * entries;
+                    for (size_t i = first; i < evalValues.size(); i += 2) map->set(evalValues[i], std::move(evalValues[i + 1]));
+                    evalValues.resize(first);
+                    evalValues.push_back(std::move(map));
+                    break;
+                }
+                case ExprKind::Index: {
+                    auto index = static_cast<const IndexExpr*>(e);
+                    if (!frame.operandsDone) {
+                        evalFrames.back().operandsDone = true;
+                        evalFrames.push_back(EvalFrame{index->index.get(), false});
+                        evalFrames.push_back(EvalFrame{index->object.get(), false});
+                        continue;
+                    }
+                    Value key = std::move(evalValues.back());
+                    evalValues.pop_back();
+                    Value element = *findElement(evalValues.back(), key);
+                    evalValues.back() = std::move(element);
+                    break;
+                }
+                case ExprKind::Call: {
+                    auto call = static_cast<const CallExpr*>(e);
+                    size_t count = call->args.size();
+                    if (!frame.operandsDone) {
+                        evalFrames.back().operandsDone = true;
+                        for (size_t i = count; i-- > 0;) evalFrames.push_back(EvalFrame{call->args[i].get(), false});
+                        continue;
+                    }
+                    size_t first = evalValues.size() - count;
+                    Value result;
+                    if (const FunctionStmt* fn = function(call)) {
+                        // The cache only fingerprints the calling statement, not the function
+                        result = callFunction(fn, count);
+                        calledImpure = true;
+                    } else {
+                        uint32_t slot = call->slot == NativeRegistry::noSlot ? NativeRegistry::find(call->name) : call->slot;
+                        if (slot == NativeRegistry::noSlot) throw std::runtime_error("Undefined function: " + call->name.str());
+                        result = registry.call(slot, evalValues.data() + first, count);
+                        if (!registry.isPure(slot)) calledImpure = true;
+                    }
+                    evalValues.resize(first);
+                    evalValues.push_back(std::move(result));
+                    break;
+                }
+                case ExprKind::Int: evalValues.push_back(static_cast<const IntExpr*>(e)->value); break;
+                case ExprKind::Float: evalValues.push_back(static_cast<const FloatExpr*>(e)->value); break;
+                case ExprKind::Char: evalValues.push_back(static_cast<const CharExpr*>(e)->value); break;
+                case ExprKind::String: evalValues.push_back(static_cast<const StringExpr*>(e)->value); break;
+                case ExprKind::Variable: evalValues.push_back(lookup(static_cast<const VariableExpr*>(e))); break;
+                case ExprKind::CompareConst: evalValues.push_back(compare(static_cast<const CompareConstExpr*>(e))); break;
+            }
+            evalFrames.pop_back();
+        }
+    } catch (...) {
+        evalFrames.resize(frameBase);
+        evalValues.resize(valueBase);
+        throw;
     }
+    AllocProfiler::leaveExpr();
+
+    Value result = std::move(evalValues.back());
+    evalValues.pop_back();
+    return result;
+}
 
-    if (auto bin = dynamic_cast<const BinaryExpr*>(expr)) {
-        Value left = evaluateExpr(bin->left.get());
-        Value right = evaluateExpr(bin->right.get());
-        return applyBinaryOperator(bin->op, left, right);
+const Value& Interpreter::lookup(const VariableExpr* var) {
+    const Value* value;
+    if (var->local >= 0) {
+        const LocalSlot& slot = frameSlots[callBase + static_cast<size_t>(var->local)];
+        value = slot.defined ? &slot.value : nullptr;
+    } else {
+        value = var->local == scope::global ? env.findGlobal(var->name) : env.find(var->name);
     }
+    if (!value) throw std::runtime_error("Undefined variable: " + var->name.str());
+    return *value;
+}
 
-    if (auto unary = dynamic_cast<const UnaryExpr*>(expr)) {
-        Value operand = evaluateExpr(unary->right.get());
-        return applyUnaryOperator(unary->op, operand);
+// Reads the variable in place; anything but an int takes the general path
+Value Interpreter::compare(const CompareConstExpr* cmp) {
+    const Value& left = lookup(cmp->variable());
+    if (auto value = std::get_if<int>(&left)) {
+        int constant = cmp->constant();
+        switch (cmp->op.type) {
+            case TokenType::Less: return static_cast<int>(*value < constant);
+            case TokenType::LessEqual: return static_cast<int>(*value <= constant);
+            case TokenType::Greater: return static_cast<int>(*value > constant);
+            case TokenType::GreaterEqual: return static_cast<int>(*value >= constant);
+            case TokenType::DoubleEqual: return static_cast<int>(*value == constant);
+            case TokenType::NotEqual: return static_cast<int>(*value != constant);
+            default: break;
+        }
     }
+    return applyBinaryOperator(cmp->op, left, Value(cmp->constant()));
+}
 
-    throw std::runtime_error("Unknown expression type");
+Map& Interpreter::asMap(const Value& object) {
+    if (object.index() != 4) throw std::runtime_error("Only maps can be indexed");
+    return *std::get<MapRef>(object);
 }
 
+const Value* Interpreter::findElement(const Value& object, const Value& key) {
+    const Value* element = asMap(object).find(key);
+    if (!element) {
+        std::ostringstream message;
+        message << "Key not found: ";
+        std::visit([&](const auto& val) { message << val; }, key);
+        throw std::runtime_error(message.str());
+    }
+    return element;
+}
+
+// --- Statements ---
+// Compound statements are frames on an explicit stack; `step` records where
+// each one resumes when its current child finishes. A child is only started
+// while no break, continue or return is pending.
 void Interpreter::executeStmt(const Stmt* stmt) {
-    if (breakLoop || continueLoop) return;
+    if (breakLoop || continueLoop || returning) return;
 
-    if (auto printStmt = dynamic_cast<const PrintStmt*>(stmt)) {
-        Value value = evaluateExpr(printStmt->expression.get());
-        printValue(value);
-        return;
+    switch (stmt->kind) {
+        case StmtKind::Print:
+        case StmtKind::Assign:
+        case StmtKind::Increment:
+        case StmtKind::Append:
+        case StmtKind::IndexAssign:
+        case StmtKind::Remove:
+        case StmtKind::Break:
+        case StmtKind::Continue:
+        case StmtKind::Function:
+        case StmtKind::Return:
+            executeSimple(stmt);
+            return;
+        default: break;
     }
 
-    if (auto assignStmt = dynamic_cast<const AssignStmt*>(stmt)) {
-        Value value = evaluateExpr(assignStmt->value.get());
-        env.set(assignStmt->name, value);
-        return;
-    }
+    size_t base = execFrames.size();
+    size_t snapshotBase = keySnapshots.size();
+    try {
+        execFrames.push_back(ExecFrame{stmt, 0});
+        while (execFrames.size() > base) {
+            ExecFrame& frame = execFrames.back();
+            const Stmt* s = frame.stmt;
+            AllocProfiler::atStmt(s);
 
-    if (auto ifStmt = dynamic_cast<const IfStmt*>(stmt)) {
-        if (isTruthy(evaluateExpr(ifStmt->condition.get()))) {
-            executeStmt(ifStmt->thenBranch.get());
-        } else if (ifStmt->elseBranch) {
-            executeStmt(ifStmt->elseBranch.get());
+            switch (s->kind) {
+                case StmtKind::If: {
+                    auto ifStmt = static_cast<const IfStmt*>(s);
+                    execFrames.pop_back();
+                    const Stmt* branch = isTruthy(evaluateExpr(ifStmt->condition.get())) ? ifStmt->thenBranch.get()
+                                                                                          : ifStmt->elseBranch.get();
+                    if (branch) execFrames.push_back(ExecFrame{branch, 0});
+                    break;
+                }
+
+                case StmtKind::Block: {
+                    auto blockStmt = static_cast<const BlockStmt*>(s);
+                    if (frame.step == 0 && callDepth == 0) env.pushScope();
+                    if (frame.step < blockStmt->statements.size() &&
+                        !(frame.step > 0 && (breakLoop || continueLoop || returning))) {
+                        const Stmt* next = blockStmt->statements[frame.step++].get();
+                        execFrames.push_back(ExecFrame{next, 0});
+                    } else {
+                        if (callDepth == 0) env.popScope();
+                        execFrames.pop_back();
+                    }
+                    break;
+                }
+
+                case StmtKind::While: {
+                    auto whileStmt = static_cast<const WhileStmt*>(s);
+                    if (frame.step > 0) {
+                        if (breakLoop || returning) {
+                            breakLoop = false;
+                            execFrames.pop_back();
+                            break;
+                        }
+                        continueLoop = false;
+                    }
+                    if (!isTruthy(evaluateExpr(whileStmt->condition.get()))) {
+                        execFrames.pop_back();
+                        break;
+                    }
+                    breakLoop = false;
+                    continueLoop = false;
+                    execFrames.back().step = 1;
+                    execFrames.push_back(ExecFrame{whileStmt->body.get(), 0});
+                    break;
+                }
+
+                case StmtKind::For: {
+                    // Steps: 0 enter, 1 initialized, 2 test, 3 body done
+                    auto forStmt = static_cast<const ForStmt*>(s);
+                    if (frame.step == 0) {
+                        if (callDepth == 0) env.pushScope();
+                        frame.step = 1;
+                        if (forStmt->initializer) execFrames.push_back(ExecFrame{forStmt->initializer.get(), 0});
+                        break;
+                    }
+                    if (frame.step == 1) {
+                        if (pool && callDepth == 0 && executeParallelFor(forStmt)) {
+                            env.popScope();
+                            execFrames.pop_back();
+                            break;
+                        }
+                        frame.step = 2;
+                    }
+                    if (frame.step == 3) {
+                        if (breakLoop || returning) {
+                            breakLoop = false;
+                            if (callDepth == 0) env.popScope();
+                            execFrames.pop_back();
+                            break;
+                        }
+                        continueLoop = false;
+                        frame.step = 2;
+                        if (forStmt->increment) {
+                            execFrames.push_back(ExecFrame{forStmt->increment.get(), 0});
+                            break;
+                        }
+                    }
+                    if (forStmt->condition && !isTruthy(evaluateExpr(forStmt->condition.get()))) {
+                        if (callDepth == 0) env.popScope();
+                        execFrames.pop_back();
+                        break;
+                    }
+                    breakLoop = false;
+                    continueLoop = false;
+                    execFrames.back().step = 3;
+                    execFrames.push_back(ExecFrame{forStmt->body.get(), 0});
+                    break;
+                }
+
+                case StmtKind::ForIn: {
+                    // Steps: 0 enter, then 1 + the number of keys visited
+                    auto forIn = static_cast<const ForInStmt*>(s);
+                    if (frame.step == 0) {
+                        // The map may call a function, which can move execFrames
+                        keySnapshots.push_back(asMap(evaluateExpr(forIn->map.get())).keys());
+                        if (callDepth == 0) env.pushScope();
+                        execFrames.back().step = 1;
+                    } else if (breakLoop || returning) {
+                        breakLoop = false;
+                        frame.step = keySnapshots.back().size() + 1;
+                    }
+                    ExecFrame& current = execFrames.back();
+                    continueLoop = false;
+                    const std::vector<Value>& keys = keySnapshots.back();
+                    if (current.step > keys.size()) {
+                        keySnapshots.pop_back();
+                        if (callDepth == 0) env.popScope();
+                        execFrames.pop_back();
+                        break;
+                    }
+                    const Value& key = keys[current.step - 1];
+                    if (forIn->local >= 0) frameSlots[callBase + static_cast<size_t>(forIn->local)] = LocalSlot{key, true};
+                    else env.set(forIn->name, key);
+                    ++current.step;
+                    execFrames.push_back(ExecFrame{forIn->body.get(), 0});
+                    break;
+                }
+
+                case StmtKind::LazyBlock:
+                    execFrames.back() = ExecFrame{static_cast<const LazyBlockStmt*>(s)->body(), 0};
+                    break;
+
+                default:
+                    execFrames.pop_back();
+                    executeSimple(s);
+                    break;
+            }
         }
-        return;
+    } catch (...) {
+        execFrames.resize(base);
+        keySnapshots.resize(snapshotBase);
+        throw;
     }
+}
 
-    if (auto whileStmt = dynamic_cast<const WhileStmt*>(stmt)) {
-        while (isTruthy(evaluateExpr(whileStmt->condition.get()))) {
-            breakLoop = false;
-            continueLoop = false;
-            executeStmt(whileStmt->body.get());
-            if (breakLoop) {
-                breakLoop = false;
-                break;
-            }
-            if (continueLoop) {
-                continueLoop = false;
-                continue;
+void Interpreter::executeSimple(const Stmt* stmt) {
+    AllocProfiler::atStmt(stmt);
+    switch (stmt->kind) {
+        case StmtKind::Print:
+            printValue(evaluateExpr(static_cast<const PrintStmt*>(stmt)->expression.get()));
+            break;
+        case StmtKind::Assign: assign(static_cast<const AssignStmt*>(stmt)); break;
+        case StmtKind::Increment: {
+            auto increment = static_cast<const IncrementStmt*>(stmt);
+            Value* target = inPlace(increment);
+            if (target && target->index() == 0) {
+                int& value = std::get<int>(*target);
+                value = increment->update()->op.type == TokenType::Plus ? value + increment->step() : value - increment->step();
+            } else {
+                assign(increment);
             }
+            break;
+        }
+        case StmtKind::Append: {
+            auto append = static_cast<const AppendStmt*>(stmt);
+            Value* target = inPlace(append);
+            if (target && target->index() == 3) std::get<SharedString>(*target).append(append->suffix());
+            else assign(append);
+            break;
+        }
+        case StmtKind::IndexAssign: {
+            auto assign = static_cast<const IndexAssignStmt*>(stmt);
+            Value object = evaluateExpr(assign->object.get());
+            Value key = evaluateExpr(assign->index.get());
+            Map& map = asMap(object);
+            map.set(key, evaluateExpr(assign->value.get()));
+            break;
         }
-        return;
+        case StmtKind::Remove: {
+            auto removeStmt = static_cast<const RemoveStmt*>(stmt);
+            Value object = evaluateExpr(removeStmt->object.get());
+            Value key = evaluateExpr(removeStmt->index.get());
+            asMap(object).remove(key);
+            break;
+        }
+        case StmtKind::Break: breakLoop = true; break;
+        case StmtKind::Continue: continueLoop = true; break;
+        case StmtKind::Function: define(static_cast<const FunctionStmt*>(stmt)); break;
+        case StmtKind::Return: {
+            auto returnStmt = static_cast<const ReturnStmt*>(stmt);
+            returnValue = returnStmt->value ? evaluateExpr(returnStmt->value.get()) : Value(0);
+            returning = true;
+            break;
+        }
+        default: throw std::runtime_error("Unknown statement type");
     }
+}
 
-    if (auto forStmt = dynamic_cast<const ForStmt*>(stmt)) {
-        env.pushScope();
-        if (forStmt->initializer) executeStmt(forStmt->initializer.get());
+void Interpreter::assign(const AssignStmt* stmt) {
+    Value value = evaluateExpr(stmt->value.get());
+    if (stmt->local >= 0) frameSlots[callBase + static_cast<size_t>(stmt->local)] = LocalSlot{std::move(value), true};
+    else env.set(stmt->name, std::move(value));
+}
 
-        while (!forStmt->condition || isTruthy(evaluateExpr(forStmt->condition.get()))) {
-            breakLoop = false;
-            continueLoop = false;
-            executeStmt(forStmt->body.get());
+// The variable a fused assignment reads and then overwrites, when both
+// happen in one place: a defined local, or a variable of the innermost scope
+Value* Interpreter::inPlace(const AssignStmt* stmt) {
+    if (stmt->local >= 0) {
+        LocalSlot& slot = frameSlots[callBase + static_cast<size_t>(stmt->local)];
+        return slot.defined ? &slot.value : nullptr;
+    }
+    return env.innermost(stmt->name);
+}
 
-            if (breakLoop) {
-                breakLoop = false;
-                break;
-            }
-            if (continueLoop) {
-                continueLoop = false;
-                // fall through
-            }
+// --- Script Functions ---
+void Interpreter::define(const FunctionStmt* fn) {
+    if (fn->slot == NativeRegistry::noSlot) {
+        unslotted[fn->name] = fn;
+    } else {
+        if (fn->slot >= functions.size()) functions.resize(fn->slot + 1);
+        functions[fn->slot] = fn;
+    }
+    if (frameSlots.capacity() == 0) frameSlots.reserve(initialFrameSlots);
+}
 
-            if (forStmt->increment) executeStmt(forStmt->increment.get());
-        }
+const FunctionStmt* Interpreter::function(const CallExpr* call) const {
+    if (call->slot < functions.size()) return functions[call->slot];
+    if (call->slot != NativeRegistry::noSlot) return nullptr;
+    auto found = unslotted.find(call->name);
+    return found == unslotted.end() ? nullptr : found->second;
+}
 
-        env.popScope();
-        return;
+Value Interpreter::callFunction(const FunctionStmt* fn, size_t count) {
+    size_t arity = fn->params.size();
+    if (count != arity) {
+        throw std::runtime_error(fn->name.str() + "() takes " + std::to_string(arity) +
+                                 (arity == 1 ? " argument" : " arguments") + ", got " + std::to_string(count));
     }
+    if (callDepth == maxCallDepth)
+        throw std::runtime_error("Stack overflow: more than " + std::to_string(maxCallDepth) + " nested calls");
 
-    if (auto blockStmt = dynamic_cast<const BlockStmt*>(stmt)) {
-        env.pushScope();
-        for (const auto& s : blockStmt->statements) {
-            executeStmt(s.get());
-            if (breakLoop || continueLoop) break;
+    AllocProfiler::Call profile(fn->name);
+
+    // Arguments move from the value stack into the new frame's first slots
+    size_t caller = callBase;
+    callBase = frameSlots.size();
+    frameSlots.resize(callBase + fn->locals);
+    Value* args = evalValues.data() + (evalValues.size() - count);
+    for (size_t i = 0; i < count; ++i) frameSlots[callBase + i] = LocalSlot{std::move(args[i]), true};
+
+    ++callDepth;
+    try {
+        executeStmt(fn->body.get());
+    } catch (...) {
+        --callDepth;
+        frameSlots.resize(callBase);
+        callBase = caller;
+        returning = false;
+        throw;
+    }
+    --callDepth;
+
+    // A break or continue outside any loop ends the function, like a return
+    Value result = returning ? std::move(returnValue) : Value(0);
+    returning = false;
+    breakLoop = false;
+    continueLoop = false;
+    frameSlots.resize(callBase);
+    callBase = caller;
+    return result;
+}
+
+// --- Parallel Loops ---
+bool Interpreter::executeParallelFor(const ForStmt* loop) {
+    auto found = loopPlans.find(loop);
+    if (found == loopPlans.end()) found = loopPlans.emplace(loop, analyzeLoop(loop, registry)).first;
+    LoopPlan& plan = found->second;
+    if (!plan.parallel) return false;
+
+    // Workers only have the natives; a script function may since have taken a name
+    for (uint32_t slot : plan.calls) {
+        if (slot < functions.size() && functions[slot]) {
+            plan.parallel = false;
+            plan.reason = "calls " + functions[slot]->name.str() + "(), a script function";
+            return false;
         }
-        env.popScope();
-        return;
     }
 
-    if (dynamic_cast<const BreakStmt*>(stmt)) {
-        breakLoop = true;
-        return;
+    // Iteration space; anything but int bounds runs serially
+    Value start = env.get(plan.induction);
+    Value bound = evaluateExpr(plan.bound);
+    if (start.index() != 0 || bound.index() != 0) return false;
+
+    long long first = std::get<int>(start);
+    long long limit = std::get<int>(bound);
+    long long step = plan.step;
+    long long count = 0;
+    switch (plan.comparison) {
+        case TokenType::Less: count = first < limit ? (limit - first + step - 1) / step : 0; break;
+        case TokenType::LessEqual: count = first <= limit ? (limit - first) / step + 1 : 0; break;
+        case TokenType::Greater: count = first > limit ? (first - limit - step - 1) / -step : 0; break;
+        case TokenType::GreaterEqual: count = first >= limit ? (first - limit) / -step + 1 : 0; break;
+        default: return false;
     }
+    long long last = first + count * step;
+    const long long minIterations = 64;
+    if (count < minIterations || last > INT_MAX || last < INT_MIN) return false;
 
-    if (dynamic_cast<const ContinueStmt*>(stmt)) {
-        continueLoop = true;
-        return;
+    // Every chunk starts its accumulators from the operator's identity
+    std::vector<Value> identities;
+    for (const auto& reduction : plan.reductions) {
+        if (!env.exists(reduction.name)) return false;
+        Value current = env.get(reduction.name);
+        if (current.index() == 0) identities.push_back(reduction.op.type == TokenType::Plus ? 0 : 1);
+        else if (current.index() == 3 && reduction.op.type == TokenType::Plus) identities.push_back(SharedString());
+        else return false;
     }
 
-    throw std::runtime_error("Unknown statement type");
-}
+    struct ChunkResult {
+        std::vector<Value> partials;
+        std::vector<std::pair<bool, Value>> lastWrites;
+        bool failed = false;
+        bool typeChanged = false;
+        std::string error;
+    };
 
-Value Interpreter::applyBinaryOperator(const Token& op, const Value& left, const Value& right) {
-    return std::visit([&](auto l, auto r) -> Value {
-        using L = decltype(l);
-        using R = decltype(r);
+    size_t chunks = static_cast<size_t>(std::min<long long>(count, (pool->size() + 1) * 4));
+    std::vector<ChunkResult> results(chunks);
 
-        if constexpr (std::is_arithmetic_v<L> && std::is_arithmetic_v<R>) {
-            switch (op.type) {
-                case TokenType::Plus: return l + r;
-                case TokenType::Minus: return l - r;
-                case TokenType::Star: return l * r;
-                case TokenType::Slash:
-                    if (r == 0) throw std::runtime_error("Division by zero");
-                    return l / r;
-                case TokenType::DoubleEqual: return l == r;
-                case TokenType::NotEqual: return l != r;
-                case TokenType::Less: return l < r;
-                case TokenType::LessEqual: return l <= r;
-                case TokenType::Greater: return l > r;
-                case TokenType::GreaterEqual: return l >= r;
-                default: break;
+    pool->run(chunks, [&](size_t c) {
+        long long begin = count * static_cast<long long>(c) / static_cast<long long>(chunks);
+        long long end = count * static_cast<long long>(c + 1) / static_cast<long long>(chunks);
+        ChunkResult& result = results[c];
+
+        Interpreter worker;
+        worker.env = env;
+        worker.registry = registry;
+        for (size_t r = 0; r < plan.reductions.size(); ++r) worker.env.set(plan.reductions[r].name, identities[r]);
+
+        try {
+            for (long long k = begin; k < end; ++k) {
+                worker.env.set(plan.induction, static_cast<int>(first + k * step));
+                worker.executeStmt(loop->body.get());
             }
-        } else if constexpr (std::is_same_v<L, std::string> && std::is_same_v<R, std::string>) {
-            if (op.type == TokenType::Plus) return l + r;
-            if (op.type == TokenType::DoubleEqual) return l == r;
-            if (op.type == TokenType::NotEqual) return l != r;
-        } else if constexpr (std::is_same_v<L, char> && std::is_same_v<R, char>) {
-            if (op.type == TokenType::DoubleEqual) return l == r;
-            if (op.type == TokenType::NotEqual) return l != r;
+        } catch (const std::runtime_error& e) {
+            result.failed = true;
+            result.error = e.what();
+            return;
         }
 
-        throw std::runtime_error("Unsupported binary operation: " + op.text);
-    }, left, right);
-}
+        for (size_t r = 0; r < plan.reductions.size(); ++r) {
+            result.partials.push_back(worker.env.get(plan.reductions[r].name));
+            if (result.partials.back().index() != identities[r].index()) result.typeChanged = true;
+        }
+        for (const auto& name : plan.lastWrites) {
+            bool written = worker.env.isLocal(name);
+            result.lastWrites.emplace_back(written, written ? worker.env.get(name) : Value());
+        }
+    });
 
-Value Interpreter::applyUnaryOperator(const Token& op, const Value& operand) {
-    return std::visit([&](auto val) -> Value {
-        using T = decltype(val);
-        if constexpr (std::is_arithmetic_v<T>) {
-            if (op.type == TokenType::Minus) return -val;
-            if (op.type == TokenType::Plus) return val;
-            if (op.text == "!") return !val;
+    // The earliest chunk decides: an accumulator that changed type means the
+    // reordering may not be valid, so the loop runs serially from now on;
+    // otherwise an error is the one the serial loop would have hit first
+    for (const auto& result : results) {
+        if (result.typeChanged) {
+            plan.parallel = false;
+            plan.reason = "an accumulator changed type mid-loop";
+            return false;
         }
+        if (result.failed) throw std::runtime_error(result.error);
+    }
 
-        throw std::runtime_error("Unsupported unary operation on type");
-    }, operand);
+    for (size_t r = 0; r < plan.reductions.size(); ++r) {
+        Value total = env.get(plan.reductions[r].name);
+        for (const auto& result : results) total = applyBinaryOperator(plan.reductions[r].op, total, result.partials[r]);
+        env.set(plan.reductions[r].name, total);
+    }
+    for (size_t w = 0; w < plan.lastWrites.size(); ++w) {
+        for (auto it = results.rbegin(); it != results.rend(); ++it) {
+            if (it->lastWrites[w].first) {
+                env.set(plan.lastWrites[w], it->lastWrites[w].second);
+                break;
+            }
+        }
+    }
+    env.set(plan.induction, static_cast<int>(last));
+    return true;
 }
 
-bool Interpreter::isTruthy(const Value& value) {
-    return std::visit([](auto val) -> bool {
-        using T = decltype(val);
-        if constexpr (std::is_same_v<T, int>) return val != 0;
-        if constexpr (std::is_same_v<T, float>) return val != 0.0f;
-        if constexpr (std::is_same_v<T, char>) return val != '\0';
-        if constexpr (std::is_same_v<T, std::string>) return !val.empty();
-        return true;
-    }, value);
+void Interpreter::reportLoops() const {
+    std::vector<std::pair<const ForStmt*, const LoopPlan*>> loops;
+    for (const auto& entry : loopPlans) loops.emplace_back(entry.first, &entry.second);
+    std::sort(loops.begin(), loops.end(), [](const auto& a, const auto& b) { return a.first->line < b.first->line; });
+
+    for (const auto& [loop, plan] : loops) {
+        *errors << "[parallel-loops] line " << loop->line << ": ";
+        if (!plan->parallel) {
+            *errors << "serial: " << plan->reason << std::endl;
+            continue;
+        }
+        *errors << "parallel";
+        for (const auto& reduction : plan->reductions) *errors << ", reduction " << reduction.name << " " << reduction.op.text;
+        for (const auto& name : plan->lastWrites) *errors << ", last write " << name;
+        *errors << std::endl;
+    }
 }
 
 void Interpreter::printValue(const Value& value) {
-    std::visit([](auto val) {
-        std::cout << val << std::endl;
+    std::visit([this](const auto& val) {
+        *output << val << '\n';
     }, value);
 }
@@ -3,39 +3,108 @@
 
 #include "AST.h"
 #include "Environment.h"
+#include "ExecutionCache.h"
+#include "LoopAnalysis.h"
+#include "Native.h"
+#include "ThreadPool.h"
 #include <vector>
 #include <memory>
 #include <stdexcept>
 #include <iostream>
 #include <variant>
 #include <string>
-
-using Value = std::variant<int, float, char, std::string>;
+#include <unordered_map>
 
 class Interpreter {
 public:
-    Interpreter();
+    // Program output goes to `out`; runtime errors and loop reports to `err`
+    explicit Interpreter(std::ostream& out = std::cout, std::ostream& err = std::cerr);
+
+    // Interpret a list of statements; false if a runtime error stopped it
+    bool interpret(const std::vector<std::unique_ptr<Stmt>>& statements);
+
+    // Interpret, reusing the cached effects of any top-level statement whose
+    // inputs are unchanged, and recording the rest into `cache`.
+    bool interpret(const std::vector<std::unique_ptr<Stmt>>& statements, ExecutionCache& cache);
+
+    // Run provably independent for-loop iterations on `threads` threads, and
+    // report on stderr which loops qualified and why the others did not.
+    void enableParallelLoops(unsigned threads);
 
-    // Interpret a list of statements
-    void interpret(const std::vector<std::unique_ptr<Stmt>>& statements);
+    Environment& environment() { return env; }
+
+    // Declares the program's functions without running anything else, for
+    // a program restored from an image
+    void defineFunctions(const std::vector<std::unique_ptr<Stmt>>& statements);
+
+    // Functions scripts can call; starts as NativeRegistry::standard()
+    NativeRegistry& natives() { return registry; }
 
 private:
     Environment env;
+    NativeRegistry registry;
+    bool calledImpure = false;  // a function without Purity::Pure has run
+    std::ostream* output;
+    std::ostream* errors;
     bool breakLoop = false;
     bool continueLoop = false;
+    bool returning = false;  // a return is unwinding to its call
+    Value returnValue;
+
+    // --- Script functions ---
+    // Every call's parameters and locals are one window of `frameSlots`, so
+    // a call only allocates while the slot stack grows to a new depth.
+    // Blocks and loops inside a function push no Environment scopes.
+    struct LocalSlot {
+        Value value;
+        bool defined = false;
+    };
+    static constexpr size_t initialFrameSlots = 1024;
+    static constexpr int maxCallDepth = 2000;
+    std::vector<const FunctionStmt*> functions;  // by NativeRegistry slot
+    std::unordered_map<SharedString, const FunctionStmt*, SharedStringHash> unslotted;  // names without a slot
+    std::vector<LocalSlot> frameSlots;
+    size_t callBase = 0;  // first slot of the running call
+    int callDepth = 0;
+
+    void define(const FunctionStmt* fn);
+    const FunctionStmt* function(const CallExpr* call) const;  // nullptr for a native
+    // Calls `fn` with the `count` values at the top of evalValues
+    Value callFunction(const FunctionStmt* fn, size_t count);
+
+    std::unique_ptr<ThreadPool> pool;
+    std::unordered_map<const ForStmt*, LoopPlan> loopPlans;
+
+    // Runs the loop on the pool after its initializer; false means run it serially
+    bool executeParallelFor(const ForStmt* loop);
+    void reportLoops() const;
+
+    // Explicit stacks for evaluateExpr and executeStmt, reused across calls
+    struct EvalFrame {
+        const Expr* expr;
+        bool operandsDone;
+    };
+    struct ExecFrame {
+        const Stmt* stmt;
+        size_t step;
+    };
+    std::vector<EvalFrame> evalFrames;
+    std::vector<Value> evalValues;
+    std::vector<ExecFrame> execFrames;
+    std::vector<std::vector<Value>> keySnapshots;  // keys each active for-in loop visits
 
     // Evaluate an expression
     Value evaluateExpr(const Expr* expr);
+    const Value& lookup(const VariableExpr* var);
+    Value compare(const CompareConstExpr* cmp);
+    Map& asMap(const Value& object);  // throws unless `object` is a map
+    const Value* findElement(const Value& object, const Value& key);  // throws if absent
 
     // Execute a statement
     void executeStmt(const Stmt* stmt);
-
-    // Helpers for binary and unary operations
-    Value applyBinaryOperator(const Token& op, const Value& left, const Value& right);
-    Value applyUnaryOperator(const Token& op, const Value& operand);
-
-    // Truthiness helper
-    bool isTruthy(const Value& value);
+    void executeSimple(const Stmt* stmt);  // statements without child statements
+    void assign(const AssignStmt* stmt);
+    Value* inPlace(const AssignStmt* stmt);  // the variable to update in place, or nullptr
 
     // Utility: print a value
     void printValue(const Value& value);
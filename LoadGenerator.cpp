@@ -0,0 +1,174 @@
+// miniscript-load: drives a `miniscript --serve` daemon and reports throughput.
+#include "Protocol.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+static void usage() {
+    std::cerr << "Usage: miniscript-load [options] <socket> [<source-file>]\n"
+              << "  -n <count>    total requests to send (default 1000)\n"
+              << "  -c <count>    concurrent connections (default 4)\n"
+              << "  --inline      send the script source instead of its path\n"
+              << "  -O            ask for the optimized SSA IR\n"
+              << "  --once        send one request, print its output and errors, and exit\n"
+              << "  --stats       print the server's counters afterwards (alone: only that)" << std::endl;
+}
+
+// Sends one request on an open connection
+static bool roundTrip(int fd, const std::string& request, protocol::Response& response) {
+    std::string payload;
+    return protocol::writeFrame(fd, request) && protocol::readFrame(fd, payload) && protocol::decode(payload, response);
+}
+
+static bool printStats(const std::string& socketPath) {
+    int fd = protocol::connectTo(socketPath);
+    protocol::Request request;
+    request.kind = protocol::RequestKind::Stats;
+    protocol::Response response;
+    bool ok = fd >= 0 && roundTrip(fd, protocol::encode(request), response);
+    if (fd >= 0) ::close(fd);
+    if (!ok) {
+        std::cerr << "Could not read counters from " << socketPath << std::endl;
+        return false;
+    }
+    std::cout << response.output;
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    size_t total = 1000;
+    unsigned connections = 4;
+    bool sendSource = false;
+    bool optimize = false;
+    bool once = false;
+    bool stats = false;
+    std::vector<std::string> positional;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-n" && i + 1 < argc) {
+            total = std::stoul(argv[++i]);
+        } else if (arg == "-c" && i + 1 < argc) {
+            connections = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--inline") {
+            sendSource = true;
+        } else if (arg == "-O") {
+            optimize = true;
+        } else if (arg == "--once") {
+            once = true;
+        } else if (arg == "--stats") {
+            stats = true;
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            usage();
+            return 1;
+        } else {
+            positional.push_back(arg);
+        }
+    }
+
+    if (positional.size() == 1 && stats) return printStats(positional[0]) ? 0 : 1;
+    if (positional.size() != 2) {
+        usage();
+        return 1;
+    }
+    const std::string& socketPath = positional[0];
+
+    // The server resolves paths from its own directory, so send an absolute one
+    protocol::Request request;
+    request.optimize = optimize;
+    if (sendSource) {
+        std::ifstream file(positional[1]);
+        if (!file) {
+            std::cerr << "Could not open file: " << positional[1] << std::endl;
+            return 1;
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        request.kind = protocol::RequestKind::Source;
+        request.body = buffer.str();
+    } else {
+        char* resolved = ::realpath(positional[1].c_str(), nullptr);
+        if (!resolved) {
+            std::cerr << "Could not open file: " << positional[1] << std::endl;
+            return 1;
+        }
+        request.kind = protocol::RequestKind::Path;
+        request.body = resolved;
+        std::free(resolved);
+    }
+    std::string encoded = protocol::encode(request);
+
+    if (once) {
+        int fd = protocol::connectTo(socketPath);
+        protocol::Response response;
+        if (fd < 0 || !roundTrip(fd, encoded, response)) {
+            std::cerr << "Could not reach server at " << socketPath << ": " << std::strerror(errno) << std::endl;
+            return 1;
+        }
+        ::close(fd);
+        std::cout << response.output << std::flush;
+        std::cerr << response.errors << std::flush;
+        return response.status == protocol::Status::Ok ? 0 : 1;
+    }
+
+    // --- Load ---
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> failed{0};
+    std::atomic<size_t> lost{0};
+    std::vector<std::vector<uint32_t>> latencies(connections);
+
+    auto client = [&](unsigned id) {
+        int fd = protocol::connectTo(socketPath);
+        if (fd < 0) {
+            for (size_t i = next++; i < total; i = next++) ++lost;
+            return;
+        }
+        for (size_t i = next++; i < total; i = next++) {
+            auto sent = std::chrono::steady_clock::now();
+            protocol::Response response;
+            if (!roundTrip(fd, encoded, response)) {
+                ++lost;
+                break;
+            }
+            if (response.status != protocol::Status::Ok) ++failed;
+            auto micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - sent);
+            latencies[id].push_back(static_cast<uint32_t>(std::min<long long>(micros.count(), UINT32_MAX)));
+        }
+        ::close(fd);
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> clients;
+    for (unsigned id = 0; id < connections; ++id) clients.emplace_back(client, id);
+    for (auto& thread : clients) thread.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<uint32_t> all;
+    for (const auto& part : latencies) all.insert(all.end(), part.begin(), part.end());
+    std::sort(all.begin(), all.end());
+    auto percentile = [&](double p) {
+        return all.empty() ? 0 : all[std::min(all.size() - 1, static_cast<size_t>(p * all.size()))];
+    };
+
+    std::cout << "requests     " << all.size() << " in " << seconds << " s over " << connections << " connections\n"
+              << "throughput   " << static_cast<long>(all.size() / seconds) << " requests/s\n"
+              << "latency us   p50 " << percentile(0.50) << "  p90 " << percentile(0.90) << "  p99 " << percentile(0.99)
+              << "  max " << (all.empty() ? 0 : all.back()) << "\n"
+              << "failed       " << failed << " (script errors)\n"
+              << "lost         " << lost << " (no answer)" << std::endl;
+
+    if (stats && !printStats(socketPath)) return 1;
+    return lost == 0 ? 0 : 1;
+}
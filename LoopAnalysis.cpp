@@ -0,0 +1,190 @@
+#include "LoopAnalysis.h"
+#include "RecursionGuard.h"
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+struct BodyFacts {
+    std::string forbidden;
+    std::vector<const CallExpr*> calls;
+    std::unordered_map<SharedString, std::vector<const AssignStmt*>, SharedStringHash> writes;
+    std::unordered_set<SharedString, SharedStringHash> writesInWhile;
+    std::unordered_map<SharedString, int, SharedStringHash> reads;
+};
+
+using ReadCounts = std::unordered_map<SharedString, int, SharedStringHash>;
+
+void collectReads(const Expr* expr, ReadCounts& reads, std::vector<const CallExpr*>& calls) {
+    RecursionGuard guard;
+    if (auto var = dynamic_cast<const VariableExpr*>(expr)) {
+        ++reads[var->name];
+    } else if (auto bin = dynamic_cast<const BinaryExpr*>(expr)) {
+        collectReads(bin->left.get(), reads, calls);
+        collectReads(bin->right.get(), reads, calls);
+    } else if (auto unary = dynamic_cast<const UnaryExpr*>(expr)) {
+        collectReads(unary->right.get(), reads, calls);
+    } else if (auto mapExpr = dynamic_cast<const MapExpr*>(expr)) {
+        for (const auto& key : mapExpr->keys) collectReads(key.get(), reads, calls);
+        for (const auto& value : mapExpr->values) collectReads(value.get(), reads, calls);
+    } else if (auto index = dynamic_cast<const IndexExpr*>(expr)) {
+        collectReads(index->object.get(), reads, calls);
+        collectReads(index->index.get(), reads, calls);
+    } else if (auto call = dynamic_cast<const CallExpr*>(expr)) {
+        calls.push_back(call);
+        for (const auto& arg : call->args) collectReads(arg.get(), reads, calls);
+    }
+}
+
+// `loopLevel` is true while assignments still land in the loop's own scope
+void scan(const Stmt* stmt, BodyFacts& facts, bool loopLevel, bool inWhile) {
+    RecursionGuard guard;
+    if (!stmt) return;
+
+    auto forbid = [&](const char* what) {
+        if (facts.forbidden.empty()) facts.forbidden = what;
+    };
+
+    if (auto printStmt = dynamic_cast<const PrintStmt*>(stmt)) {
+        forbid("body contains print");
+        collectReads(printStmt->expression.get(), facts.reads, facts.calls);
+    } else if (auto assignStmt = dynamic_cast<const AssignStmt*>(stmt)) {
+        collectReads(assignStmt->value.get(), facts.reads, facts.calls);
+        if (loopLevel) {
+            facts.writes[assignStmt->name].push_back(assignStmt);
+            if (inWhile) facts.writesInWhile.insert(assignStmt->name);
+        }
+    } else if (auto ifStmt = dynamic_cast<const IfStmt*>(stmt)) {
+        collectReads(ifStmt->condition.get(), facts.reads, facts.calls);
+        scan(ifStmt->thenBranch.get(), facts, loopLevel, inWhile);
+        scan(ifStmt->elseBranch.get(), facts, loopLevel, inWhile);
+    } else if (auto whileStmt = dynamic_cast<const WhileStmt*>(stmt)) {
+        collectReads(whileStmt->condition.get(), facts.reads, facts.calls);
+        scan(whileStmt->body.get(), facts, loopLevel, true);
+    } else if (auto forStmt = dynamic_cast<const ForStmt*>(stmt)) {
+        scan(forStmt->initializer.get(), facts, false, inWhile);
+        if (forStmt->condition) collectReads(forStmt->condition.get(), facts.reads, facts.calls);
+        scan(forStmt->increment.get(), facts, false, inWhile);
+        scan(forStmt->body.get(), facts, false, inWhile);
+    } else if (auto forIn = dynamic_cast<const ForInStmt*>(stmt)) {
+        collectReads(forIn->map.get(), facts.reads, facts.calls);
+        scan(forIn->body.get(), facts, false, inWhile);
+    } else if (auto blockStmt = dynamic_cast<const BlockStmt*>(stmt)) {
+        for (const auto& s : blockStmt->statements) scan(s.get(), facts, false, inWhile);
+    } else if (auto lazy = dynamic_cast<const LazyBlockStmt*>(stmt)) {
+        scan(lazy->body(), facts, loopLevel, inWhile);
+    } else if (stmt->kind == StmtKind::IndexAssign || stmt->kind == StmtKind::Remove) {
+        // Maps are shared between iterations, so updates to them would race
+        forbid("body modifies a map");
+    } else if (dynamic_cast<const BreakStmt*>(stmt)) {
+        forbid("body contains break");
+    } else if (dynamic_cast<const ContinueStmt*>(stmt)) {
+        forbid("body contains continue");
+    } else {
+        forbid("body contains an unknown statement");
+    }
+}
+
+// `v = v + e` or `v = v * e`
+const BinaryExpr* reductionUpdate(const AssignStmt* write) {
+    auto bin = dynamic_cast<const BinaryExpr*>(write->value.get());
+    if (!bin || (bin->op.type != TokenType::Plus && bin->op.type != TokenType::Star)) return nullptr;
+    auto self = dynamic_cast<const VariableExpr*>(bin->left.get());
+    if (!self || self->name != write->name) return nullptr;
+    return bin;
+}
+
+LoopPlan serial(const std::string& reason) {
+    LoopPlan plan;
+    plan.reason = reason;
+    return plan;
+}
+
+LoopPlan analyze(const ForStmt* loop, const NativeRegistry& natives) {
+    auto init = dynamic_cast<const AssignStmt*>(loop->initializer.get());
+    if (!init) return serial("no induction variable initializer");
+    SharedString induction = init->name;
+
+    auto cond = dynamic_cast<const BinaryExpr*>(loop->condition.get());
+    auto condVar = cond ? dynamic_cast<const VariableExpr*>(cond->left.get()) : nullptr;
+    if (!condVar || condVar->name != induction)
+        return serial("condition is not a comparison of " + induction.str() + " with a bound");
+    TokenType comparison = cond->op.type;
+    if (comparison != TokenType::Less && comparison != TokenType::LessEqual &&
+        comparison != TokenType::Greater && comparison != TokenType::GreaterEqual)
+        return serial("condition uses an unsupported comparison");
+
+    auto incr = dynamic_cast<const AssignStmt*>(loop->increment.get());
+    auto incrExpr = incr ? dynamic_cast<const BinaryExpr*>(incr->value.get()) : nullptr;
+    auto incrVar = incrExpr ? dynamic_cast<const VariableExpr*>(incrExpr->left.get()) : nullptr;
+    auto incrStep = incrExpr ? dynamic_cast<const IntExpr*>(incrExpr->right.get()) : nullptr;
+    if (!incr || incr->name != induction || !incrVar || incrVar->name != induction || !incrStep ||
+        (incrExpr->op.type != TokenType::Plus && incrExpr->op.type != TokenType::Minus))
+        return serial("increment is not " + induction.str() + " = " + induction.str() + " +/- constant");
+    int step = incrExpr->op.type == TokenType::Plus ? incrStep->value : -incrStep->value;
+    bool upward = comparison == TokenType::Less || comparison == TokenType::LessEqual;
+    if (step == 0 || (step > 0) != upward) return serial("step does not move toward the bound");
+
+    BodyFacts facts;
+    scan(loop->body.get(), facts, true, false);
+    if (!facts.forbidden.empty()) return serial(facts.forbidden);
+
+    ReadCounts boundReads;
+    collectReads(cond->right.get(), boundReads, facts.calls);
+    for (const CallExpr* call : facts.calls) {
+        if (!natives.isPure(call->slot)) return serial("calls " + call->name.str() + "(), which is not pure");
+    }
+    for (const auto& read : boundReads) {
+        if (read.first == induction || facts.writes.count(read.first))
+            return serial("bound is not loop-invariant (" + read.first.str() + ")");
+    }
+
+    LoopPlan plan;
+    plan.induction = induction;
+    plan.comparison = comparison;
+    plan.bound = cond->right.get();
+    plan.step = step;
+    for (const CallExpr* call : facts.calls) plan.calls.push_back(call->slot);
+
+    for (const auto& entry : facts.writes) {
+        const SharedString& name = entry.first;
+        const auto& writes = entry.second;
+        if (name == induction) return serial("body assigns the induction variable");
+        if (facts.writesInWhile.count(name)) return serial(name.str() + " is assigned inside a nested while");
+
+        int reads = facts.reads.count(name) ? facts.reads.at(name) : 0;
+        const BinaryExpr* first = reductionUpdate(writes.front());
+        bool reduction = first != nullptr;
+        for (const AssignStmt* write : writes) {
+            const BinaryExpr* update = reductionUpdate(write);
+            reduction = reduction && update && update->op.type == first->op.type;
+        }
+
+        if (reduction && reads == static_cast<int>(writes.size())) {
+            plan.reductions.push_back(LoopPlan::Reduction{name, first->op});
+        } else if (reads == 0) {
+            plan.lastWrites.push_back(name);
+        } else {
+            return serial("loop-carried dependence on " + name.str());
+        }
+    }
+
+    auto byName = [](const auto& a, const auto& b) { return a.view() < b.view(); };
+    std::sort(plan.lastWrites.begin(), plan.lastWrites.end(), byName);
+    std::sort(plan.reductions.begin(), plan.reductions.end(),
+              [&](const auto& a, const auto& b) { return byName(a.name, b.name); });
+
+    plan.parallel = true;
+    return plan;
+}
+
+} // namespace
+
+LoopPlan analyzeLoop(const ForStmt* loop, const NativeRegistry& natives) {
+    try {
+        return analyze(loop, natives);
+    } catch (const std::runtime_error& e) {
+        return serial(e.what());
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef LOOP_ANALYSIS_H
+#define LOOP_ANALYSIS_H
+
+#include "AST.h"
+#include "Native.h"
+#include <string>
+#include <vector>
+
+// Result of checking whether a ForStmt's iterations can run in parallel.
+//
+// A parallel loop has the canonical shape
+//     for (i = <init>; i <op> <bound>; i = i +/- <int constant>;) <body>
+// where the bound is loop-invariant and the body has no print, break,
+// continue or map update, and calls only functions registered as pure. Variables the body assigns in the loop's own scope must each be
+// either a reduction (every write is `v = v + e` or `v = v * e`, and v is
+// read nowhere else) or write-only, in which case the last write wins.
+// Assignments inside nested blocks are private to one iteration.
+struct LoopPlan {
+    bool parallel = false;
+    std::string reason;  // why not, when !parallel
+
+    SharedString induction;
+    TokenType comparison = TokenType::Less;
+    const Expr* bound = nullptr;
+    int step = 0;
+    std::vector<uint32_t> calls;  // NativeRegistry slots the loop calls
+
+    struct Reduction {
+        SharedString name;
+        Token op;
+    };
+    std::vector<Reduction> reductions;
+    std::vector<SharedString> lastWrites;
+};
+
+LoopPlan analyzeLoop(const ForStmt* loop, const NativeRegistry& natives);
+
+#endif // LOOP_ANALYSIS_H
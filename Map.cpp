@@ -0,0 +1,301 @@
+#include "Map.h"
+#include "RecursionGuard.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+constexpr int8_t emptyCtrl = -128;  // 0b10000000
+constexpr int8_t deletedCtrl = -2;  // 0b11111110; full slots are 0..127
+constexpr size_t groupWidth = 16;
+
+// --- Groups ---
+// Bit i of each mask stands for control byte i of the group
+struct Group {
+#if defined(__SSE2__)
+    __m128i bytes;
+
+    explicit Group(const int8_t* ctrl) : bytes(_mm_load_si128(reinterpret_cast<const __m128i*>(ctrl))) {}
+
+    uint32_t match(int8_t h2) const {
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), bytes)));
+    }
+    uint32_t matchEmpty() const { return match(emptyCtrl); }
+    // Empty and deleted are the only control bytes with the sign bit set
+    uint32_t matchFree() const { return static_cast<uint32_t>(_mm_movemask_epi8(bytes)); }
+#else
+    const int8_t* bytes;
+
+    explicit Group(const int8_t* ctrl) : bytes(ctrl) {}
+
+    uint32_t match(int8_t h2) const {
+        uint32_t mask = 0;
+        for (size_t i = 0; i < groupWidth; ++i) mask |= static_cast<uint32_t>(bytes[i] == h2) << i;
+        return mask;
+    }
+    uint32_t matchEmpty() const { return match(emptyCtrl); }
+    uint32_t matchFree() const {
+        uint32_t mask = 0;
+        for (size_t i = 0; i < groupWidth; ++i) mask |= static_cast<uint32_t>(bytes[i] < 0) << i;
+        return mask;
+    }
+#endif
+};
+
+size_t lowestBit(uint32_t mask) {
+    return static_cast<size_t>(__builtin_ctz(mask));
+}
+
+// --- Keys ---
+size_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    return static_cast<size_t>(x);
+}
+
+// The low 7 bits go into the control byte, the rest pick the first group
+size_t hashKey(const Value& key) {
+    switch (key.index()) {
+        case 0: return mix(static_cast<uint32_t>(std::get<int>(key)));
+        case 1: {
+            float f = std::get<float>(key);
+            if (f == 0.0f) f = 0.0f;  // -0.0 and 0.0 are the same key
+            uint32_t bits;
+            std::memcpy(&bits, &f, sizeof bits);
+            return mix(bits | 1ull << 32);
+        }
+        case 2: return mix(static_cast<unsigned char>(std::get<char>(key)) | 2ull << 32);
+        case 3: return mix(std::get<SharedString>(key).hash());
+        default: throw std::runtime_error("Map keys must be numbers, characters or strings");
+    }
+}
+
+bool sameKey(const Value& a, const Value& b) {
+    if (a.index() != b.index()) return false;
+    switch (a.index()) {
+        case 0: return std::get<int>(a) == std::get<int>(b);
+        case 1: return std::get<float>(a) == std::get<float>(b);
+        case 2: return std::get<char>(a) == std::get<char>(b);
+        default: return std::get<SharedString>(a) == std::get<SharedString>(b);
+    }
+}
+
+int8_t controlByte(size_t hash) {
+    return static_cast<int8_t>(hash & 0x7f);
+}
+
+} // namespace
+
+// --- Table ---
+Map::~Map() {
+    for (size_t i = 0; i < capacity; ++i)
+        if (ctrl[i] >= 0) slots[i].~Slot();
+    ::operator delete(ctrl, std::align_val_t(groupWidth));
+    ::operator delete(slots);
+}
+
+size_t Map::findSlot(const Value& key, size_t hash) const {
+    if (capacity == 0) return capacity;
+    size_t groupMask = capacity / groupWidth - 1;
+    size_t group = (hash >> 7) & groupMask;
+    int8_t h2 = controlByte(hash);
+
+    // Triangular steps visit every group once when the group count is a power of two
+    for (size_t probe = 1;; ++probe) {
+        Group g(ctrl + group * groupWidth);
+        for (uint32_t bits = g.match(h2); bits; bits &= bits - 1) {
+            size_t i = group * groupWidth + lowestBit(bits);
+            if (sameKey(slots[i].key, key)) return i;
+        }
+        if (g.matchEmpty()) return capacity;
+        group = (group + probe) & groupMask;
+    }
+}
+
+const Value* Map::find(const Value& key) const {
+    size_t i = findSlot(key, hashKey(key));
+    return i == capacity ? nullptr : &slots[i].value;
+}
+
+void Map::set(const Value& key, Value value) {
+    size_t hash = hashKey(key);
+    size_t i = findSlot(key, hash);
+    if (i != capacity) {
+        slots[i].value = std::move(value);
+        return;
+    }
+    insertNew(key, hash, std::move(value));
+}
+
+void Map::insertNew(const Value& key, size_t hash, Value value) {
+    auto firstFree = [&] {
+        size_t groupMask = capacity / groupWidth - 1;
+        size_t group = (hash >> 7) & groupMask;
+        for (size_t probe = 1;; ++probe) {
+            if (uint32_t free = Group(ctrl + group * groupWidth).matchFree()) return group * groupWidth + lowestBit(free);
+            group = (group + probe) & groupMask;
+        }
+    };
+
+    // A deleted slot can be reused at any time; an empty one only while the
+    // load factor stays under 7/8. Mostly-deleted tables are rebuilt in place.
+    size_t i = capacity == 0 ? 0 : firstFree();
+    if (capacity == 0 || (ctrl[i] == emptyCtrl && growthLeft == 0)) {
+        rehash(capacity == 0 ? groupWidth : count < capacity * 7 / 16 ? capacity : capacity * 2);
+        i = firstFree();
+    }
+
+    if (ctrl[i] == emptyCtrl) --growthLeft;
+    new (&slots[i]) Slot{key, std::move(value)};
+    ctrl[i] = controlByte(hash);
+    ++count;
+}
+
+void Map::rehash(size_t newCapacity) {
+    auto newCtrl = static_cast<int8_t*>(::operator new(newCapacity, std::align_val_t(groupWidth)));
+    Slot* newSlots;
+    try {
+        newSlots = static_cast<Slot*>(::operator new(newCapacity * sizeof(Slot)));
+    } catch (...) {
+        ::operator delete(newCtrl, std::align_val_t(groupWidth));
+        throw;
+    }
+    std::memset(newCtrl, emptyCtrl, newCapacity);
+
+    size_t groupMask = newCapacity / groupWidth - 1;
+    for (size_t i = 0; i < capacity; ++i) {
+        if (ctrl[i] < 0) continue;
+        size_t hash = hashKey(slots[i].key);
+        size_t group = (hash >> 7) & groupMask;
+        for (size_t probe = 1;; ++probe) {
+            if (uint32_t free = Group(newCtrl + group * groupWidth).matchFree()) {
+                size_t target = group * groupWidth + lowestBit(free);
+                newCtrl[target] = controlByte(hash);
+                new (&newSlots[target]) Slot{std::move(slots[i].key), std::move(slots[i].value)};
+                slots[i].~Slot();
+                break;
+            }
+            group = (group + probe) & groupMask;
+        }
+    }
+
+    ::operator delete(ctrl, std::align_val_t(groupWidth));
+    ::operator delete(slots);
+    ctrl = newCtrl;
+    slots = newSlots;
+    capacity = newCapacity;
+    growthLeft = newCapacity * 7 / 8 - count;
+}
+
+bool Map::remove(const Value& key) {
+    size_t i = findSlot(key, hashKey(key));
+    if (i == capacity) return false;
+    slots[i].~Slot();
+
+    // Lookups stop at the first group with an empty slot, so if this group
+    // already has one the slot can become empty again instead of a tombstone
+    if (Group(ctrl + (i & ~(groupWidth - 1))).matchEmpty()) {
+        ctrl[i] = emptyCtrl;
+        ++growthLeft;
+    } else {
+        ctrl[i] = deletedCtrl;
+    }
+    --count;
+    return true;
+}
+
+std::vector<Value> Map::keys() const {
+    std::vector<Value> result;
+    result.reserve(count);
+    forEach([&](const Value& key, const Value&) { result.push_back(key); });
+    return result;
+}
+
+// --- Handles ---
+MapRef MapRef::create() {
+    return MapRef(new Map());
+}
+
+MapRef& MapRef::operator=(const MapRef& other) noexcept {
+    if (map != other.map) {
+        retain(other.map);
+        if (map) release(map);
+        map = other.map;
+    }
+    return *this;
+}
+
+MapRef& MapRef::operator=(MapRef&& other) noexcept {
+    if (this != &other) {
+        if (map) release(map);
+        map = other.map;
+        other.map = nullptr;
+    }
+    return *this;
+}
+
+void MapRef::retain(Map* m) noexcept {
+    m->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Freeing a map releases the maps it holds; they are queued rather than freed
+// recursively, so a long chain of nested maps cannot overflow the stack
+void MapRef::release(Map* m) noexcept {
+    if (m->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+    thread_local std::vector<Map*> doomed;
+    thread_local bool freeing = false;
+    doomed.push_back(m);
+    if (freeing) return;
+    freeing = true;
+    while (!doomed.empty()) {
+        Map* next = doomed.back();
+        doomed.pop_back();
+        delete next;
+    }
+    freeing = false;
+}
+
+// --- Printing ---
+namespace {
+
+void printEntry(std::ostream& os, const Value& value) {
+    std::visit([&](const auto& val) {
+        using T = std::decay_t<decltype(val)>;
+        if constexpr (std::is_same_v<T, SharedString>) os << '"' << val << '"';
+        else if constexpr (std::is_same_v<T, char>) os << '\'' << val << '\'';
+        else os << val;
+    }, value);
+}
+
+} // namespace
+
+std::ostream& operator<<(std::ostream& os, const MapRef& map) {
+    // A map that contains itself prints the inner occurrence as {...}
+    thread_local std::vector<const Map*> printing;
+    if (std::find(printing.begin(), printing.end(), map.get()) != printing.end()) return os << "{...}";
+
+    RecursionGuard guard;
+    printing.push_back(map.get());
+    os << '{';
+    bool first = true;
+    try {
+        map->forEach([&](const Value& key, const Value& value) {
+            if (!first) os << ", ";
+            first = false;
+            printEntry(os, key);
+            os << ": ";
+            printEntry(os, value);
+        });
+    } catch (...) {
+        printing.pop_back();
+        throw;
+    }
+    printing.pop_back();
+    return os << '}';
+}
@@ -0,0 +1,70 @@
+#ifndef MAP_H
+#define MAP_H
+
+#include "Value.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Hash map from int, float, char or string keys to any value, stored as an
+// open-addressing "Swiss table". Each slot has a control byte: empty,
+// deleted, or the low 7 bits of the key's hash. Slots are probed in groups
+// of 16 control bytes, compared against the hash bits in one SSE2
+// instruction where available, so most lookups touch a single key.
+//
+// Keys are equal only when they have the same type and value, so 1, 1.0 and
+// '\1' are three different keys. String keys use the hash every string
+// already carries. Iteration follows the table, not insertion order.
+//
+// Maps are reference counted, not garbage collected, so a cycle of maps is
+// never freed. `m["self"] = m;`, or two maps holding each other, leaks the
+// whole cycle and everything reachable from it once the script drops its
+// last handle, for the rest of the process (every request, under --serve).
+// Scripts that build such links should cut them with `remove` when done.
+// Printing stops at a map already being printed and shows `{...}`.
+class Map {
+public:
+    Map() = default;
+    ~Map();
+
+    Map(const Map&) = delete;
+    Map& operator=(const Map&) = delete;
+
+    size_t size() const { return count; }
+
+    // nullptr if absent. Throws std::runtime_error for a key of the wrong type.
+    const Value* find(const Value& key) const;
+    void set(const Value& key, Value value);
+    bool remove(const Value& key);  // false if absent
+
+    // Every key, in table order
+    std::vector<Value> keys() const;
+
+    template <typename F>
+    void forEach(F&& visit) const {
+        for (size_t i = 0; i < capacity; ++i)
+            if (ctrl[i] >= 0) visit(slots[i].key, slots[i].value);
+    }
+
+private:
+    friend class MapRef;
+
+    struct Slot {
+        Value key;
+        Value value;
+    };
+
+    std::atomic<long> refs{1};
+    int8_t* ctrl = nullptr;  // `capacity` control bytes
+    Slot* slots = nullptr;   // constructed only where ctrl is full
+    size_t capacity = 0;     // 0 or a power of two >= 16
+    size_t count = 0;
+    size_t growthLeft = 0;   // empty slots that may still be filled before a rehash
+
+    size_t findSlot(const Value& key, size_t hash) const;  // capacity if absent
+    void rehash(size_t newCapacity);
+    void insertNew(const Value& key, size_t hash, Value value);
+};
+
+#endif // MAP_H
@@ -0,0 +1,69 @@
+#include "Native.h"
+#include <mutex>
+#include <unordered_map>
+
+void native::badArgument(std::string_view function, size_t index, const char* expected) {
+    throw std::runtime_error(std::string(function) + "() argument " + std::to_string(index + 1) + " must be " + expected);
+}
+
+// --- Slots ---
+namespace {
+
+struct SlotTable {
+    std::mutex mutex;
+    std::unordered_map<SharedString, uint32_t, SharedStringHash> slots;
+    std::vector<SharedString> names;
+};
+
+SlotTable& slotTable() {
+    static SlotTable table;
+    return table;
+}
+
+// Registered functions always get a slot; names met while parsing only
+// until the table holds maxSlots of them
+uint32_t assign(const SharedString& name, bool registering) {
+    SlotTable& table = slotTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    auto found = table.slots.find(name);
+    if (found != table.slots.end()) return found->second;
+    if (!registering && table.names.size() >= NativeRegistry::maxSlots) return NativeRegistry::noSlot;
+    SharedString interned = StringTable::global().intern(name.view());
+    uint32_t slot = static_cast<uint32_t>(table.names.size());
+    table.slots.emplace(interned, slot);
+    table.names.push_back(interned);
+    return slot;
+}
+
+} // namespace
+
+uint32_t NativeRegistry::slot(const SharedString& name) {
+    return assign(name, false);
+}
+
+uint32_t NativeRegistry::find(const SharedString& name) {
+    SlotTable& table = slotTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    auto found = table.slots.find(name);
+    return found == table.slots.end() ? noSlot : found->second;
+}
+
+SharedString NativeRegistry::name(uint32_t slot) {
+    SlotTable& table = slotTable();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    return slot < table.names.size() ? table.names[slot] : SharedString("?");
+}
+
+// --- Registration ---
+void NativeRegistry::add(std::string_view name, size_t arity, Purity purity, std::shared_ptr<void> state,
+                         Value (*thunk)(const NativeFunction&, const Value*)) {
+    SharedString interned = StringTable::global().intern(name);
+    uint32_t index = assign(interned, true);
+    if (index >= functions.size()) functions.resize(index + 1);
+    functions[index] = NativeFunction{thunk, std::move(state), interned, arity, purity};
+}
+
+void NativeRegistry::wrongArity(const NativeFunction& fn, size_t count) {
+    throw std::runtime_error(fn.name.str() + "() takes " + std::to_string(fn.arity) +
+                             (fn.arity == 1 ? " argument" : " arguments") + ", got " + std::to_string(count));
+}
@@ -0,0 +1,206 @@
+#ifndef NATIVE_H
+#define NATIVE_H
+
+#include "Value.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Whether a native function may be reordered, run in parallel or skipped
+// when its arguments are unchanged. Host functions are assumed to have
+// effects unless registered as Pure.
+enum class Purity { Effects, Pure };
+
+// --- Conversions ---
+// Convert<T>::from turns argument `index` of a call into T, or throws with a
+// message naming the function; Convert<T>::to turns a result into a Value.
+namespace native {
+
+[[noreturn]] void badArgument(std::string_view function, size_t index, const char* expected);
+
+template <typename T, typename = void>
+struct Convert;
+
+template <>
+struct Convert<Value> {
+    static const Value& from(const Value& v, std::string_view, size_t) { return v; }
+    static Value to(Value v) { return v; }
+};
+
+template <>
+struct Convert<int> {
+    static int from(const Value& v, std::string_view fn, size_t i) {
+        if (auto p = std::get_if<int>(&v)) return *p;
+        badArgument(fn, i, "an int");
+    }
+    static Value to(int v) { return v; }
+};
+
+template <>
+struct Convert<bool> {
+    static Value to(bool v) { return static_cast<int>(v); }
+};
+
+// Floating-point parameters also take ints; results are stored as float
+template <typename T>
+struct Convert<T, std::enable_if_t<std::is_floating_point_v<T>>> {
+    static T from(const Value& v, std::string_view fn, size_t i) {
+        if (auto p = std::get_if<float>(&v)) return static_cast<T>(*p);
+        if (auto p = std::get_if<int>(&v)) return static_cast<T>(*p);
+        badArgument(fn, i, "a number");
+    }
+    static Value to(T v) { return static_cast<float>(v); }
+};
+
+template <>
+struct Convert<char> {
+    static char from(const Value& v, std::string_view fn, size_t i) {
+        if (auto p = std::get_if<char>(&v)) return *p;
+        badArgument(fn, i, "a char");
+    }
+    static Value to(char v) { return v; }
+};
+
+template <>
+struct Convert<SharedString> {
+    static const SharedString& from(const Value& v, std::string_view fn, size_t i) {
+        if (auto p = std::get_if<SharedString>(&v)) return *p;
+        badArgument(fn, i, "a string");
+    }
+    static Value to(SharedString v) { return v; }
+};
+
+// Views stay valid for the call, since the argument holds the string
+template <>
+struct Convert<std::string_view> {
+    static std::string_view from(const Value& v, std::string_view fn, size_t i) {
+        return Convert<SharedString>::from(v, fn, i).view();
+    }
+    static Value to(std::string_view v) { return SharedString(v); }
+};
+
+template <>
+struct Convert<std::string> {
+    static std::string from(const Value& v, std::string_view fn, size_t i) {
+        return Convert<SharedString>::from(v, fn, i).str();
+    }
+    static Value to(const std::string& v) { return SharedString(v); }
+};
+
+template <>
+struct Convert<MapRef> {
+    static const MapRef& from(const Value& v, std::string_view fn, size_t i) {
+        if (auto p = std::get_if<MapRef>(&v)) return *p;
+        badArgument(fn, i, "a map");
+    }
+    static Value to(MapRef v) { return v; }
+};
+
+// Parameter and result types of a function pointer or a callable object
+template <typename F>
+struct Signature : Signature<decltype(&F::operator())> {};
+template <typename R, typename... A>
+struct Signature<R (*)(A...)> {
+    using Return = R;
+    using Args = std::tuple<std::decay_t<A>...>;
+};
+template <typename C, typename R, typename... A>
+struct Signature<R (C::*)(A...)> : Signature<R (*)(A...)> {};
+template <typename C, typename R, typename... A>
+struct Signature<R (C::*)(A...) const> : Signature<R (*)(A...)> {};
+
+template <typename Sig, typename F, size_t... I>
+Value apply(F&& fn, std::string_view name, const Value* args, std::index_sequence<I...>) {
+    using R = typename Sig::Return;
+    if constexpr (std::is_void_v<R>) {
+        fn(Convert<std::tuple_element_t<I, typename Sig::Args>>::from(args[I], name, I)...);
+        return 0;
+    } else {
+        return Convert<std::decay_t<R>>::to(fn(Convert<std::tuple_element_t<I, typename Sig::Args>>::from(args[I], name, I)...));
+    }
+}
+
+} // namespace native
+
+// --- Registry ---
+// C++ functions callable from scripts as name(args...). Each function name
+// gets a process-wide slot number when a call is parsed (slot()), and a
+// registry is an array indexed by slot, so a call is one array access and
+// one indirect call with no name lookup. The conversion code for each
+// function's parameters and result is generated at registration.
+//
+// Slots are never freed, so parsed names only get one while fewer than
+// `maxSlots` are taken; a --serve process that keeps meeting new names
+// stops growing the table there. Later names get `noSlot`, and calls to
+// them are resolved by name (find()) each time they run.
+class NativeRegistry {
+public:
+    // Registers a function known at compile time; its thunk calls it directly:
+    //     registry.define<&hypot2>("hypot", Purity::Pure);
+    template <auto Fn>
+    void define(std::string_view name, Purity purity = Purity::Effects) {
+        using Sig = native::Signature<decltype(Fn)>;
+        add(name, std::tuple_size_v<typename Sig::Args>, purity, nullptr,
+            [](const NativeFunction& self, const Value* args) {
+                return native::apply<Sig>(Fn, self.name.view(), args,
+                                          std::make_index_sequence<std::tuple_size_v<typename Sig::Args>>());
+            });
+    }
+
+    // Registers any callable object, such as a lambda with captures
+    template <typename F>
+    void define(std::string_view name, F callable, Purity purity = Purity::Effects) {
+        using Sig = native::Signature<std::decay_t<F>>;
+        auto state = std::make_shared<std::decay_t<F>>(std::move(callable));
+        add(name, std::tuple_size_v<typename Sig::Args>, purity, state,
+            [](const NativeFunction& self, const Value* args) {
+                return native::apply<Sig>(*static_cast<std::decay_t<F>*>(self.state.get()), self.name.view(), args,
+                                          std::make_index_sequence<std::tuple_size_v<typename Sig::Args>>());
+            });
+    }
+
+    // Calls the function in `slot`; throws std::runtime_error if there is
+    // none or the argument count is wrong
+    Value call(uint32_t slot, const Value* args, size_t count) const {
+        if (slot >= functions.size() || !functions[slot].thunk) throw std::runtime_error("Undefined function: " + name(slot).str());
+        const NativeFunction& fn = functions[slot];
+        if (count != fn.arity) wrongArity(fn, count);
+        return fn.thunk(fn, args);
+    }
+
+    bool isPure(uint32_t slot) const { return slot < functions.size() && functions[slot].purity == Purity::Pure; }
+
+    // Process-wide slot of a function name, assigned on first use while
+    // the table has room, else noSlot. find() never assigns one.
+    static constexpr uint32_t maxSlots = 1 << 16;
+    static constexpr uint32_t noSlot = UINT32_MAX;
+    static uint32_t slot(const SharedString& name);
+    static uint32_t find(const SharedString& name);
+    static SharedString name(uint32_t slot);
+
+    // A registry holding the standard math and string functions (Builtins.cpp)
+    static const NativeRegistry& standard();
+
+private:
+    struct NativeFunction {
+        Value (*thunk)(const NativeFunction& self, const Value* args) = nullptr;
+        std::shared_ptr<void> state;  // the callable, for define(name, callable)
+        SharedString name;
+        size_t arity = 0;
+        Purity purity = Purity::Effects;
+    };
+    std::vector<NativeFunction> functions;
+
+    void add(std::string_view name, size_t arity, Purity purity, std::shared_ptr<void> state,
+             Value (*thunk)(const NativeFunction&, const Value*));
+    [[noreturn]] static void wrongArity(const NativeFunction& fn, size_t count);
+};
+
+#endif // NATIVE_H
@@ -0,0 +1,70 @@
+#include "Operators.h"
+#include "Map.h"
+#include <type_traits>
+
+Value applyBinaryOperator(const Token& op, const Value& left, const Value& right) {
+    return std::visit([&](const auto& l, const auto& r) -> Value {
+        using L = std::decay_t<decltype(l)>;
+        using R = std::decay_t<decltype(r)>;
+
+        if constexpr (std::is_same_v<R, MapRef>) {
+            if (op.type == TokenType::In) return r->find(left) != nullptr;
+        }
+
+        if constexpr (std::is_arithmetic_v<L> && std::is_arithmetic_v<R>) {
+            switch (op.type) {
+                case TokenType::Plus: return l + r;
+                case TokenType::Minus: return l - r;
+                case TokenType::Star: return l * r;
+                case TokenType::Slash:
+                    if (r == 0) throw std::runtime_error("Division by zero");
+                    return l / r;
+                case TokenType::DoubleEqual: return l == r;
+                case TokenType::NotEqual: return l != r;
+                case TokenType::Less: return l < r;
+                case TokenType::LessEqual: return l <= r;
+                case TokenType::Greater: return l > r;
+                case TokenType::GreaterEqual: return l >= r;
+                default: break;
+            }
+        } else if constexpr (std::is_same_v<L, SharedString> && std::is_same_v<R, SharedString>) {
+            if (op.type == TokenType::Plus) return SharedString::concat(l, r);
+            if (op.type == TokenType::DoubleEqual) return l == r;
+            if (op.type == TokenType::NotEqual) return l != r;
+        } else if constexpr (std::is_same_v<L, char> && std::is_same_v<R, char>) {
+            if (op.type == TokenType::DoubleEqual) return l == r;
+            if (op.type == TokenType::NotEqual) return l != r;
+        } else if constexpr (std::is_same_v<L, MapRef> && std::is_same_v<R, MapRef>) {
+            // Maps compare by identity
+            if (op.type == TokenType::DoubleEqual) return l == r;
+            if (op.type == TokenType::NotEqual) return l != r;
+        }
+
+        throw std::runtime_error("Unsupported binary operation: " + op.text);
+    }, left, right);
+}
+
+Value applyUnaryOperator(const Token& op, const Value& operand) {
+    return std::visit([&](const auto& val) -> Value {
+        using T = std::decay_t<decltype(val)>;
+        if constexpr (std::is_arithmetic_v<T>) {
+            if (op.type == TokenType::Minus) return -val;
+            if (op.type == TokenType::Plus) return val;
+            if (op.text == "!") return !val;
+        }
+
+        throw std::runtime_error("Unsupported unary operation on type");
+    }, operand);
+}
+
+bool isTruthy(const Value& value) {
+    return std::visit([](const auto& val) -> bool {
+        using T = std::decay_t<decltype(val)>;
+        if constexpr (std::is_same_v<T, int>) return val != 0;
+        if constexpr (std::is_same_v<T, float>) return val != 0.0f;
+        if constexpr (std::is_same_v<T, char>) return val != '\0';
+        if constexpr (std::is_same_v<T, SharedString>) return !val.empty();
+        if constexpr (std::is_same_v<T, MapRef>) return val->size() > 0;
+        return true;
+    }, value);
+}
@@ -0,0 +1,13 @@
+#ifndef OPERATORS_H
+#define OPERATORS_H
+
+#include "Environment.h"
+#include "Token.h"
+
+// Operator semantics shared by every execution engine, so that the tree
+// walker, the IR engine and the optimizer's constant folder agree exactly.
+Value applyBinaryOperator(const Token& op, const Value& left, const Value& right);
+Value applyUnaryOperator(const Token& op, const Value& operand);
+bool isTruthy(const Value& value);
+
+#endif // OPERATORS_H
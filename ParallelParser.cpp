@@ -0,0 +1,126 @@
+#include "ParallelParser.h"
+#include "Parser.h"
+#include "Tokenizer.h"
+#include <atomic>
+#include <cctype>
+#include <exception>
+#include <iostream>
+#include <thread>
+
+ParallelParser::ParallelParser(const std::string& source, unsigned threads, size_t maxDepth)
+    : source(source), threads(threads == 0 ? 1 : threads), maxDepth(maxDepth) {}
+
+// --- Splitting ---
+// A ';' or '}' outside any braces or parentheses ends a top-level statement,
+// unless an 'else' follows. A '}' must also be followed by the start of a
+// statement, since it may close a map literal instead of a block. The scan mirrors the Tokenizer's rules for string
+// and character literals so that delimiters inside them are not counted, and
+// counts newlines so that every piece starts with the right line number.
+std::vector<ParallelParser::Chunk> ParallelParser::split(size_t targetSize) const {
+    std::vector<Chunk> chunks;
+    size_t n = source.size();
+    size_t begin = 0;
+    int beginLine = 1;
+    int line = 1;
+    int braces = 0;
+    int parens = 0;
+
+    auto followedByWord = [&](size_t pos, const char* word, size_t length) {
+        while (pos < n && isspace(static_cast<unsigned char>(source[pos]))) ++pos;
+        if (source.compare(pos, length, word) != 0) return false;
+        return pos + length >= n || !(isalnum(static_cast<unsigned char>(source[pos + length])) || source[pos + length] == '_');
+    };
+    auto followedByElse = [&](size_t pos) { return followedByWord(pos, "else", 4); };
+
+    // Statements start with a keyword, an identifier or '{'
+    auto followedByStatement = [&](size_t pos) {
+        while (pos < n && isspace(static_cast<unsigned char>(source[pos]))) ++pos;
+        if (pos == n || source[pos] == '{') return true;
+        if (!isalpha(static_cast<unsigned char>(source[pos])) && source[pos] != '_') return false;
+        return !followedByWord(pos, "in", 2);
+    };
+
+    size_t pos = 0;
+    while (pos < n) {
+        char c = source[pos];
+        if (c == '\n') {
+            ++line;
+        } else if (c == '"') {
+            ++pos;
+            while (pos < n && source[pos] != '"') {
+                if (source[pos] == '\n') ++line;
+                ++pos;
+            }
+        } else if (c == '\'') {
+            // Tokenizer::charLiteral
+            if (pos + 2 < n && source[pos + 1] == '\'') {
+                pos += 2;
+                if (pos < n && source[pos] == '\'') ++pos;
+                continue;
+            }
+        } else if (c == '(') {
+            ++parens;
+        } else if (c == ')') {
+            --parens;
+        } else if (c == '{') {
+            ++braces;
+        } else if (c == '}') {
+            --braces;
+        }
+
+        if (braces < 0 || parens < 0) break;  // malformed: keep the rest in one piece
+        ++pos;
+
+        if ((c == ';' || c == '}') && braces == 0 && parens == 0 && pos - begin >= targetSize &&
+            !followedByElse(pos) && (c == ';' || followedByStatement(pos))) {
+            chunks.push_back(Chunk{begin, pos, beginLine});
+            begin = pos;
+            beginLine = line;
+        }
+    }
+
+    if (begin < n || chunks.empty()) chunks.push_back(Chunk{begin, n, beginLine});
+    return chunks;
+}
+
+// --- Entry Point ---
+std::vector<std::unique_ptr<Stmt>> ParallelParser::parse() {
+    // A few pieces per thread keeps the threads busy when pieces differ in cost
+    size_t targetSize = source.size() / (threads * 4) + 1;
+    std::vector<Chunk> chunks = split(targetSize);
+
+    std::vector<std::vector<std::unique_ptr<Stmt>>> results(chunks.size());
+    std::vector<std::exception_ptr> errors(chunks.size());
+    std::atomic<size_t> next{0};
+
+    auto worker = [&] {
+        for (size_t i = next++; i < chunks.size(); i = next++) {
+            try {
+                std::vector<Token> tokens = Tokenizer::tokenize(
+                    source.substr(chunks[i].begin, chunks[i].end - chunks[i].begin), chunks[i].line);
+                results[i] = Parser(tokens, false, maxDepth).parse();
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads && t < chunks.size(); ++t) pool.emplace_back(worker);
+    worker();
+    for (auto& thread : pool) thread.join();
+
+    std::vector<std::unique_ptr<Stmt>> statements;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        if (errors[i]) {
+            try {
+                std::rethrow_exception(errors[i]);
+            } catch (const ParseError& e) {
+                std::cerr << e.diagnostic << std::endl;
+                throw;
+            }
+        }
+        for (auto& stmt : results[i]) statements.push_back(std::move(stmt));
+    }
+    return statements;
+}
@@ -0,0 +1,34 @@
+#ifndef PARALLEL_PARSER_H
+#define PARALLEL_PARSER_H
+
+#include "AST.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+// Tokenizes and parses a source file on several threads. The source is cut
+// at top-level statement boundaries, each piece is tokenized and parsed on
+// its own, and the statement lists are spliced back in order. Syntax errors
+// are reported exactly as the sequential Parser would: the first failing
+// piece wins, and its diagnostic is printed before rethrowing.
+class ParallelParser {
+public:
+    ParallelParser(const std::string& source, unsigned threads, size_t maxDepth);
+
+    std::vector<std::unique_ptr<Stmt>> parse();
+
+private:
+    struct Chunk {
+        size_t begin;
+        size_t end;
+        int line;
+    };
+
+    const std::string& source;
+    unsigned threads;
+    size_t maxDepth;
+
+    std::vector<Chunk> split(size_t targetSize) const;
+};
+
+#endif // PARALLEL_PARSER_H
@@ -1,15 +1,19 @@
 #include "Parser.h"
+#include "Fuser.h"
+#include "Native.h"
 #include <iostream>
 #include <stdexcept>
 
 // --- Error Reporting ---
-static void error(const Token& token, const std::string& message) {
-    std::cerr << "[Line " << token.line << "] Error at '" << token.text << "': " << message << std::endl;
-    throw std::runtime_error(message);
+void Parser::error(const Token& token, const std::string& message) {
+    std::string diagnostic = "[Line " + std::to_string(token.line) + "] Error at '" + token.text + "': " + message;
+    if (reportErrors) std::cerr << diagnostic << std::endl;
+    throw ParseError(message, diagnostic);
 }
 
 // --- Constructor ---
-Parser::Parser(const std::vector<Token>& tokens) : tokens(tokens) {}
+Parser::Parser(const std::vector<Token>& tokens, bool reportErrors, size_t maxDepth)
+    : tokens(tokens), reportErrors(reportErrors), maxDepth(maxDepth) {}
 
 // --- Entry Point ---
 std::vector<std::unique_ptr<Stmt>> Parser::parse() {
@@ -53,7 +57,6 @@ bool Parser::match(TokenType type) {
 const Token& Parser::consume(TokenType type, const std::string& message) {
     if (check(type)) return advance();
     error(peek(), message);
-    throw std::runtime_error("Unreachable");  // Prevent warning
 }
 
 // --- Declarations and Statements ---
@@ -61,20 +64,157 @@ std::unique_ptr<Stmt> Parser::declaration() {
     return statement();
 }
 
+void Parser::checkDepth(size_t depth) {
+    depth += depthBase;
+    if (depth > maxDepth) error(previous(), "Nesting exceeds the depth limit of " + std::to_string(maxDepth) + ".");
+}
+
 std::unique_ptr<Stmt> Parser::statement() {
-    if (match(TokenType::Print)) return printStatement();
-    if (match(TokenType::If)) return ifStatement();
-    if (match(TokenType::While)) return whileStatement();
-    if (match(TokenType::For)) return forStatement();
-    if (match(TokenType::Break)) return breakStatement();
-    if (match(TokenType::Continue)) return continueStatement();
-    if (match(TokenType::LeftBrace)) return block();
+    open.clear();
+    std::unique_ptr<Stmt> stmt;
+
+    while (true) {
+        // Open compound statements until a complete statement is parsed
+        int line = peek().line;
+        if (match(TokenType::If)) {
+            open.emplace_back(StmtKind::If, line);
+            checkDepth(open.size());
+            ifHeader(open.back());
+            continue;
+        }
+        if (match(TokenType::While)) {
+            open.emplace_back(StmtKind::While, line);
+            checkDepth(open.size());
+            whileHeader(open.back());
+            continue;
+        }
+        if (match(TokenType::For)) {
+            open.emplace_back(StmtKind::For, line);
+            checkDepth(open.size());
+            forHeader(open.back());
+            continue;
+        }
+        if (match(TokenType::Fun)) {
+            if (!open.empty()) error(previous(), "Functions can only be declared at the top level.");
+            open.emplace_back(StmtKind::Function, line);
+            functionHeader(open.back());
+            continue;
+        }
+        if (canDefer()) {
+            stmt = deferBlock();
+        } else if (match(TokenType::LeftBrace)) {
+            if (!isAtEnd() && !check(TokenType::RightBrace)) {
+                open.emplace_back(StmtKind::Block, line);
+                checkDepth(open.size());
+                continue;
+            }
+            consume(TokenType::RightBrace, "Expect '}' after block.");
+            stmt = std::make_unique<BlockStmt>(std::vector<std::unique_ptr<Stmt>>());
+        }
+        else if (match(TokenType::Print)) stmt = printStatement();
+        else if (match(TokenType::Break)) stmt = breakStatement();
+        else if (match(TokenType::Continue)) stmt = continueStatement();
+        else if (startsRemove(tokens, current)) {
+            advance();
+            stmt = removeStatement();
+        }
+        else if (match(TokenType::Return)) stmt = returnStatement();
+        else if (check(TokenType::Identifier) && current + 1 < tokens.size() && tokens[current + 1].type == TokenType::Equal)
+            stmt = assignmentStatement();
+        else if (check(TokenType::Identifier) && current + 1 < tokens.size() &&
+                 tokens[current + 1].type == TokenType::LeftBracket)
+            stmt = indexAssignmentStatement();
+        else error(peek(), "Expected a statement.");
+        stmt->line = line;
+
+        // Close every open statement that this one completes
+        while (!open.empty()) {
+            OpenStmt& outer = open.back();
+            if (outer.kind == StmtKind::Block) {
+                outer.statements.push_back(std::move(stmt));
+                if (!isAtEnd() && !check(TokenType::RightBrace)) break;
+                consume(TokenType::RightBrace, "Expect '}' after block.");
+                stmt = std::make_unique<BlockStmt>(std::move(outer.statements));
+            } else if (outer.kind == StmtKind::If && !outer.thenBranch) {
+                outer.thenBranch = std::move(stmt);
+                if (match(TokenType::Else)) break;
+                stmt = std::make_unique<IfStmt>(std::move(outer.condition), std::move(outer.thenBranch), nullptr);
+            } else if (outer.kind == StmtKind::If) {
+                stmt = std::make_unique<IfStmt>(std::move(outer.condition), std::move(outer.thenBranch), std::move(stmt));
+            } else if (outer.kind == StmtKind::While) {
+                stmt = std::make_unique<WhileStmt>(std::move(outer.condition), std::move(stmt));
+            } else if (outer.kind == StmtKind::ForIn) {
+                auto forIn = std::make_unique<ForInStmt>(outer.name, std::move(outer.condition), std::move(stmt));
+                if (function) forIn->local = declareLocal(outer.name);
+                stmt = std::move(forIn);
+            } else if (outer.kind == StmtKind::Function) {
+                stmt = finishFunction(outer, std::move(stmt));
+            } else {
+                stmt = std::make_unique<ForStmt>(std::move(outer.initializer), std::move(outer.condition),
+                                                 std::move(outer.increment), std::move(stmt));
+            }
+            stmt->line = outer.line;
+            open.pop_back();
+        }
+        if (open.empty()) return stmt;
+    }
+}
+
+// --- Lazy Parsing ---
+std::vector<std::unique_ptr<Stmt>> Parser::parseLazily(std::shared_ptr<const std::vector<Token>> tokens,
+                                                       bool reportErrors, size_t maxDepth, bool fuse) {
+    auto source = std::make_shared<LazySource>();
+    source->closing.assign(tokens->size(), std::string::npos);
+    std::vector<size_t> opening;
+    for (size_t i = 0; i < tokens->size(); ++i) {
+        TokenType type = (*tokens)[i].type;
+        if (type == TokenType::LeftBrace) {
+            opening.push_back(i);
+        } else if (type == TokenType::RightBrace && !opening.empty()) {
+            source->closing[opening.back()] = i;
+            opening.pop_back();
+        }
+    }
+    source->tokens = std::move(tokens);
+    source->reportErrors = reportErrors;
+    source->maxDepth = maxDepth;
+    source->fuse = fuse;
+
+    Parser parser(*source->tokens, reportErrors, maxDepth);
+    parser.lazy = std::move(source);
+    return parser.parse();
+}
 
-    if (check(TokenType::Identifier) && current + 1 < tokens.size() && tokens[current + 1].type == TokenType::Equal)
-        return assignmentStatement();
+std::unique_ptr<Stmt> Parser::parseDeferred(const std::shared_ptr<const LazySource>& source, size_t begin, size_t depth) {
+    Parser parser(*source->tokens, source->reportErrors, source->maxDepth);
+    parser.lazy = source;
+    parser.current = begin;
+    parser.depthBase = depth;
+    return parser.statement();
+}
+
+const Stmt* LazyBlockStmt::body() const {
+    std::call_once(once, [this] {
+        parsed = Parser::parseDeferred(source, begin, depth);
+        if (source->fuse) Fuser().rewrite(parsed);
+    });
+    return parsed.get();
+}
 
-    error(peek(), "Expected a statement.");
-    return nullptr;
+// At the start of a compound statement's body, outside functions. Bodies
+// whose braces do not match are parsed eagerly, so that the error shows now.
+bool Parser::canDefer() {
+    if (!lazy || function || open.empty() || !check(TokenType::LeftBrace)) return false;
+    StmtKind kind = open.back().kind;
+    if (kind != StmtKind::If && kind != StmtKind::While && kind != StmtKind::For && kind != StmtKind::ForIn) return false;
+    size_t end = lazy->closing[current];
+    return end != std::string::npos && end - current >= lazyMinTokens;
+}
+
+std::unique_ptr<Stmt> Parser::deferBlock() {
+    auto stmt = std::make_unique<LazyBlockStmt>(lazy, current, open.size());
+    current = lazy->closing[current] + 1;
+    return stmt;
 }
 
 std::unique_ptr<Stmt> Parser::printStatement() {
@@ -88,51 +228,117 @@ std::unique_ptr<Stmt> Parser::assignmentStatement() {
     consume(TokenType::Equal, "Expect '=' after variable name.");
     auto value = expression();
     consume(TokenType::Semicolon, "Expect ';' after expression.");
-    return std::make_unique<AssignStmt>(name.text, std::move(value));
+    auto stmt = std::make_unique<AssignStmt>(StringTable::global().intern(name.text), std::move(value));
+    stmt->line = name.line;
+    if (function) stmt->local = declareLocal(stmt->name);
+    return stmt;
 }
 
-std::unique_ptr<Stmt> Parser::ifStatement() {
-    consume(TokenType::LeftParen, "Expect '(' after 'if'.");
-    auto condition = expression();
-    consume(TokenType::RightParen, "Expect ')' after condition.");
-    auto thenBranch = statement();
+std::unique_ptr<Stmt> Parser::indexAssignmentStatement() {
+    auto target = expression();
+    if (target->kind != ExprKind::Index) error(previous(), "Invalid assignment target.");
+    consume(TokenType::Equal, "Expect '=' after map element.");
+    auto value = expression();
+    consume(TokenType::Semicolon, "Expect ';' after expression.");
+    auto element = static_cast<IndexExpr*>(target.get());
+    return std::make_unique<IndexAssignStmt>(std::move(element->object), std::move(element->index), std::move(value));
+}
 
-    std::unique_ptr<Stmt> elseBranch = nullptr;
-    if (match(TokenType::Else)) {
-        elseBranch = statement();
-    }
+std::unique_ptr<Stmt> Parser::removeStatement() {
+    auto target = expression();
+    if (target->kind != ExprKind::Index) error(previous(), "Expect a map element after 'remove'.");
+    consume(TokenType::Semicolon, "Expect ';' after map element.");
+    auto element = static_cast<IndexExpr*>(target.get());
+    return std::make_unique<RemoveStmt>(std::move(element->object), std::move(element->index));
+}
+
+std::unique_ptr<Stmt> Parser::returnStatement() {
+    if (!function) error(previous(), "Can't return from outside a function.");
+    std::unique_ptr<Expr> value;
+    if (!check(TokenType::Semicolon)) value = expression();
+    consume(TokenType::Semicolon, "Expect ';' after return value.");
+    return std::make_unique<ReturnStmt>(std::move(value));
+}
 
-    return std::make_unique<IfStmt>(std::move(condition), std::move(thenBranch), std::move(elseBranch));
+std::unique_ptr<Expr> Parser::makeCall(const Token& callee, std::vector<std::unique_ptr<Expr>> args) {
+    SharedString name = StringTable::global().intern(callee.text);
+    return std::make_unique<CallExpr>(name, NativeRegistry::slot(name), std::move(args));
 }
 
-std::unique_ptr<Stmt> Parser::whileStatement() {
+void Parser::ifHeader(OpenStmt& header) {
+    consume(TokenType::LeftParen, "Expect '(' after 'if'.");
+    header.condition = expression();
+    consume(TokenType::RightParen, "Expect ')' after condition.");
+}
+
+void Parser::whileHeader(OpenStmt& header) {
     consume(TokenType::LeftParen, "Expect '(' after 'while'.");
-    auto condition = expression();
+    header.condition = expression();
     consume(TokenType::RightParen, "Expect ')' after condition.");
-    auto body = statement();
-    return std::make_unique<WhileStmt>(std::move(condition), std::move(body));
 }
 
-std::unique_ptr<Stmt> Parser::forStatement() {
+void Parser::forHeader(OpenStmt& header) {
     consume(TokenType::LeftParen, "Expect '(' after 'for'.");
 
-    std::unique_ptr<Stmt> initializer;
+    if (check(TokenType::Identifier) && current + 1 < tokens.size() && isWord(tokens[current + 1], "in")) {
+        header.kind = StmtKind::ForIn;
+        header.name = StringTable::global().intern(advance().text);
+        advance();
+        header.condition = expression();
+        consume(TokenType::RightParen, "Expect ')' after map.");
+        return;
+    }
+
     if (match(TokenType::Semicolon)) {
-        initializer = nullptr;
+        header.initializer = nullptr;
     } else if (check(TokenType::Identifier) && current + 1 < tokens.size() && tokens[current + 1].type == TokenType::Equal) {
-        initializer = assignmentStatement();
+        header.initializer = assignmentStatement();
     } else {
         error(peek(), "Invalid initializer in 'for' loop.");
     }
 
-    auto condition = expression();
+    header.condition = expression();
     consume(TokenType::Semicolon, "Expect ';' after loop condition.");
 
-    auto increment = assignmentStatement();
+    header.increment = assignmentStatement();
     consume(TokenType::RightParen, "Expect ')' after for clauses.");
-    auto body = statement();
+}
 
-    return std::make_unique<ForStmt>(std::move(initializer), std::move(condition), std::move(increment), std::move(body));
+// --- Functions ---
+// Parameters take the first frame slots. Every other name the body assigns
+// gets the next free slot as it is met; reads can come before the first
+// assignment, so they are resolved when the function closes.
+void Parser::functionHeader(OpenStmt& header) {
+    header.name = StringTable::global().intern(consume(TokenType::Identifier, "Expect function name.").text);
+    consume(TokenType::LeftParen, "Expect '(' after function name.");
+    function = true;
+    functionLocals.clear();
+    functionReads.clear();
+    if (!check(TokenType::RightParen)) {
+        do {
+            const Token& param = consume(TokenType::Identifier, "Expect parameter name.");
+            SharedString name = StringTable::global().intern(param.text);
+            if (functionLocals.count(name)) error(param, "Duplicate parameter name.");
+            header.params.push_back(name);
+            declareLocal(name);
+        } while (match(TokenType::Comma));
+    }
+    consume(TokenType::RightParen, "Expect ')' after parameters.");
+}
+
+int Parser::declareLocal(const SharedString& name) {
+    return functionLocals.emplace(name, static_cast<int>(functionLocals.size())).first->second;
+}
+
+std::unique_ptr<Stmt> Parser::finishFunction(OpenStmt& header, std::unique_ptr<Stmt> body) {
+    for (VariableExpr* read : functionReads) {
+        auto found = functionLocals.find(read->name);
+        read->local = found != functionLocals.end() ? found->second : scope::global;
+    }
+    function = false;
+    functionReads.clear();
+    return std::make_unique<FunctionStmt>(header.name, NativeRegistry::slot(header.name), std::move(header.params),
+                                          std::move(body), static_cast<uint32_t>(functionLocals.size()));
 }
 
 std::unique_ptr<Stmt> Parser::breakStatement() {
@@ -145,68 +351,146 @@ std::unique_ptr<Stmt> Parser::continueStatement() {
     return std::make_unique<ContinueStmt>();
 }
 
-std::unique_ptr<Stmt> Parser::block() {
-    std::vector<std::unique_ptr<Stmt>> statements;
-    while (!isAtEnd() && !check(TokenType::RightBrace)) {
-        statements.push_back(declaration());
-    }
-    consume(TokenType::RightBrace, "Expect '}' after block.");
-    return std::make_unique<BlockStmt>(std::move(statements));
-}
-
 // --- Expression Parsing ---
-std::unique_ptr<Expr> Parser::expression() {
-    return equality();
-}
-
-std::unique_ptr<Expr> Parser::equality() {
-    auto expr = comparison();
-    while (match(TokenType::DoubleEqual) || match(TokenType::NotEqual)) {
-        Token op = previous();
-        auto right = comparison();
-        expr = std::make_unique<BinaryExpr>(std::move(expr), op, std::move(right));
+// Operator precedence parsing with an explicit operator stack. Binary
+// operators are left-associative, from loosest to tightest:
+// == !=, < <= > >= in, + -, * /. Unary minus binds tighter than all of them,
+// and indexing tighter still. Parentheses, brackets, map literals and call
+// argument lists are markers on the same stack, so none of them recurse.
+int Parser::binaryPrecedence(const Token& token) {
+    if (isWord(token, "in")) return 2;
+    switch (token.type) {
+        case TokenType::DoubleEqual: case TokenType::NotEqual: return 1;
+        case TokenType::Less: case TokenType::LessEqual:
+        case TokenType::Greater: case TokenType::GreaterEqual: return 2;
+        case TokenType::Plus: case TokenType::Minus: return 3;
+        case TokenType::Star: case TokenType::Slash: return 4;
+        default: return 0;
     }
-    return expr;
 }
 
-std::unique_ptr<Expr> Parser::comparison() {
-    auto expr = term();
-    while (match(TokenType::Less) || match(TokenType::LessEqual) ||
-           match(TokenType::Greater) || match(TokenType::GreaterEqual)) {
-        Token op = previous();
-        auto right = term();
-        expr = std::make_unique<BinaryExpr>(std::move(expr), op, std::move(right));
-    }
-    return expr;
-}
-
-std::unique_ptr<Expr> Parser::term() {
-    auto expr = factor();
-    while (match(TokenType::Plus) || match(TokenType::Minus)) {
-        Token op = previous();
-        auto right = factor();
-        expr = std::make_unique<BinaryExpr>(std::move(expr), op, std::move(right));
-    }
-    return expr;
+bool Parser::startsRemove(const std::vector<Token>& tokens, size_t at) {
+    if (!isWord(tokens[at], "remove") || at + 1 >= tokens.size()) return false;
+    TokenType next = tokens[at + 1].type;
+    return next != TokenType::Equal && next != TokenType::LeftBracket;
 }
 
-std::unique_ptr<Expr> Parser::factor() {
-    auto expr = unary();
-    while (match(TokenType::Star) || match(TokenType::Slash)) {
-        Token op = previous();
-        auto right = unary();
-        expr = std::make_unique<BinaryExpr>(std::move(expr), op, std::move(right));
-    }
-    return expr;
-}
-
-std::unique_ptr<Expr> Parser::unary() {
-    if (match(TokenType::Minus)) {
-        Token op = previous();
-        auto right = unary();
-        return std::make_unique<UnaryExpr>(op, std::move(right));
+std::unique_ptr<Expr> Parser::expression() {
+    const int call = -3;       // an open 'name('; `base` is where its arguments start
+    const int mapOpen = -2;    // an open '{'; `base` is where its entries start
+    const int subscript = -1;  // an open '['; the indexed object is below it
+    const int group = 0;       // an open '('
+    const int negate = 5;      // a pending unary minus
+
+    ops.clear();
+    operands.clear();
+
+    auto reduce = [&] {
+        auto right = std::move(operands.back());
+        operands.pop_back();
+        operands.back() = std::make_unique<BinaryExpr>(std::move(operands.back()), ops.back().op, std::move(right));
+        ops.pop_back();
+    };
+
+    while (true) {
+        // Prefixes, then an operand
+        std::unique_ptr<Expr> operand;
+        while (!operand) {
+            if (match(TokenType::Minus) || match(TokenType::LeftParen)) {
+                ops.push_back(PendingOp{previous(), previous().type == TokenType::Minus ? negate : group, 0});
+                checkDepth(ops.size());
+            } else if (check(TokenType::Identifier) && current + 1 < tokens.size() &&
+                       tokens[current + 1].type == TokenType::LeftParen) {
+                Token callee = advance();
+                advance();
+                if (match(TokenType::RightParen)) {
+                    operand = makeCall(callee, {});
+                } else {
+                    ops.push_back(PendingOp{callee, call, operands.size()});
+                    checkDepth(ops.size());
+                }
+            } else if (match(TokenType::LeftBrace)) {
+                if (match(TokenType::RightBrace)) {
+                    operand = std::make_unique<MapExpr>(std::vector<std::unique_ptr<Expr>>(),
+                                                        std::vector<std::unique_ptr<Expr>>());
+                } else {
+                    ops.push_back(PendingOp{previous(), mapOpen, operands.size()});
+                    checkDepth(ops.size());
+                }
+            } else {
+                operand = primary();
+            }
+        }
+        operands.push_back(std::move(operand));
+
+        while (true) {
+            if (match(TokenType::LeftBracket)) {
+                ops.push_back(PendingOp{previous(), subscript, 0});
+                checkDepth(ops.size());
+                break;
+            }
+
+            while (!ops.empty() && ops.back().precedence == negate) {
+                operands.back() = std::make_unique<UnaryExpr>(ops.back().op, std::move(operands.back()));
+                ops.pop_back();
+            }
+
+            int precedence = isAtEnd() ? 0 : binaryPrecedence(peek());
+            if (precedence > 0) {
+                while (!ops.empty() && ops.back().precedence >= precedence) reduce();
+                ops.push_back(PendingOp{advance(), precedence, 0});
+                if (ops.back().op.type == TokenType::Identifier) ops.back().op.type = TokenType::In;
+                break;
+            }
+
+            // No operator follows: the innermost bracket, or the expression, ends
+            while (!ops.empty() && ops.back().precedence > group) reduce();
+            if (ops.empty()) {
+                auto expr = std::move(operands.back());
+                operands.pop_back();
+                return expr;
+            }
+
+            if (ops.back().precedence == group) {
+                consume(TokenType::RightParen, "Expect ')' after expression.");
+                ops.pop_back();
+            } else if (ops.back().precedence == call) {
+                if (match(TokenType::Comma)) break;
+                consume(TokenType::RightParen, "Expect ')' after arguments.");
+
+                size_t base = ops.back().base;
+                std::vector<std::unique_ptr<Expr>> args;
+                for (size_t k = base; k < operands.size(); ++k) args.push_back(std::move(operands[k]));
+                operands.resize(base);
+                operands.push_back(makeCall(ops.back().op, std::move(args)));
+                ops.pop_back();
+            } else if (ops.back().precedence == subscript) {
+                consume(TokenType::RightBracket, "Expect ']' after index.");
+                auto index = std::move(operands.back());
+                operands.pop_back();
+                operands.back() = std::make_unique<IndexExpr>(std::move(operands.back()), std::move(index));
+                ops.pop_back();
+            } else {
+                // Map entries alternate key, value above `base`
+                size_t base = ops.back().base;
+                if ((operands.size() - base) % 2 == 1) {
+                    consume(TokenType::Colon, "Expect ':' after map key.");
+                    break;
+                }
+                if (match(TokenType::Comma)) break;
+                consume(TokenType::RightBrace, "Expect '}' after map entries.");
+
+                std::vector<std::unique_ptr<Expr>> keys, values;
+                for (size_t k = base; k < operands.size(); k += 2) {
+                    keys.push_back(std::move(operands[k]));
+                    values.push_back(std::move(operands[k + 1]));
+                }
+                operands.resize(base);
+                operands.push_back(std::make_unique<MapExpr>(std::move(keys), std::move(values)));
+                ops.pop_back();
+            }
+        }
     }
-    return primary();
 }
 
 std::unique_ptr<Expr> Parser::primary() {
@@ -220,18 +504,13 @@ std::unique_ptr<Expr> Parser::primary() {
         return std::make_unique<CharExpr>(previous().text[0]);
     }
     if (match(TokenType::String)) {
-        return std::make_unique<StringExpr>(previous().text);
+        return std::make_unique<StringExpr>(StringTable::global().intern(previous().text));
     }
     if (match(TokenType::Identifier)) {
-        return std::make_unique<VariableExpr>(previous().text);
-    }
-    if (match(TokenType::LeftParen)) {
-        auto expr = expression();
-        consume(TokenType::RightParen, "Expect ')' after expression.");
-        return expr;
+        auto var = std::make_unique<VariableExpr>(StringTable::global().intern(previous().text));
+        if (function) functionReads.push_back(var.get());
+        return var;
     }
 
     error(peek(), "Expected expression.");
-    return nullptr;
 }
-
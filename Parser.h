@@ -5,17 +5,75 @@
 #include "AST.h"
 #include <vector>
 #include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
 
+// Thrown on the first syntax error. `diagnostic` is the full
+// "[Line N] Error at '...': message" report.
+struct ParseError : std::runtime_error {
+    std::string diagnostic;
+
+    ParseError(const std::string& message, const std::string& diag)
+        : std::runtime_error(message), diagnostic(diag) {}
+};
+
+// Tokens of a program parsed in lazy mode, shared by its deferred blocks
+struct LazySource {
+    std::shared_ptr<const std::vector<Token>> tokens;
+    std::vector<size_t> closing;  // index of the '}' matching a '{', or npos
+    bool reportErrors;
+    size_t maxDepth;
+    bool fuse;  // run the Fuser on each body once it is parsed
+};
+
+// Statements and expressions are parsed with explicit stacks rather than
+// recursion, so input nesting is bounded by `maxDepth` (nested statements,
+// or open parentheses and unary minuses in one expression) and not by the
+// machine stack. Going past the limit is an ordinary syntax error.
 class Parser {
 public:
-    Parser(const std::vector<Token>& tokens);
+    static constexpr size_t defaultMaxDepth = 1000000;
+
+    // With reportErrors off, diagnostics are only carried by the ParseError
+    // so that a caller parsing several pieces can decide which one to print.
+    Parser(const std::vector<Token>& tokens, bool reportErrors = true, size_t maxDepth = defaultMaxDepth);
 
     // Entry point for parsing
     std::vector<std::unique_ptr<Stmt>> parse();
 
+    // Lazy mode: braced bodies of if, else, while and for statements outside
+    // functions, if at least `lazyMinTokens` long, are only brace-matched and
+    // become LazyBlockStmts that parse themselves on first use. Unbalanced
+    // braces are reported at once; other syntax errors inside a deferred
+    // body only when it first runs.
+    static constexpr size_t lazyMinTokens = 32;
+    static std::vector<std::unique_ptr<Stmt>> parseLazily(std::shared_ptr<const std::vector<Token>> tokens,
+                                                         bool reportErrors = true, size_t maxDepth = defaultMaxDepth,
+                                                         bool fuse = true);
+    static std::unique_ptr<Stmt> parseDeferred(const std::shared_ptr<const LazySource>& source, size_t begin, size_t depth);
+
+    // Precedence of a binary operator token, or 0 if it is not one
+    static int binaryPrecedence(const Token& token);
+
+    // `in` and `remove` are contextual keywords. They are tokenized as
+    // identifiers, so scripts may still use them as names, and read as
+    // keywords only where no name can stand: `in` after an operand, and
+    // `remove` at the start of a statement unless '=' or '[' follows it.
+    static bool isWord(const Token& token, const char* word) {
+        return token.type == TokenType::Identifier && token.text == word;
+    }
+    static bool startsRemove(const std::vector<Token>& tokens, size_t at);
+
 private:
     const std::vector<Token>& tokens;
     size_t current = 0;
+    bool reportErrors;
+    size_t maxDepth;
+    std::shared_ptr<const LazySource> lazy;  // set in lazy mode
+    size_t depthBase = 0;                    // statements open around a deferred body
+
+    [[noreturn]] void error(const Token& token, const std::string& message);
 
     // --- Utility ---
     bool isAtEnd();
@@ -26,26 +84,65 @@ private:
     bool match(TokenType type);
     const Token& consume(TokenType type, const std::string& errorMessage);
 
+    void checkDepth(size_t depth);
+
     // --- Statements ---
+    // A compound statement whose body is still being parsed
+    struct OpenStmt {
+        StmtKind kind;
+        int line;
+        std::unique_ptr<Expr> condition;    // the map, for for-in
+        SharedString name;                  // for-in, function
+        std::vector<SharedString> params;   // function
+        std::unique_ptr<Stmt> initializer;  // for
+        std::unique_ptr<Stmt> increment;    // for
+        std::unique_ptr<Stmt> thenBranch;   // if, once parsed
+        std::vector<std::unique_ptr<Stmt>> statements;  // block
+
+        OpenStmt(StmtKind k, int l) : kind(k), line(l) {}
+    };
+
+    // Reused across statements so that parsing does not allocate a stack each time
+    std::vector<OpenStmt> open;
+
+    bool canDefer();
+    std::unique_ptr<Stmt> deferBlock();
+
     std::unique_ptr<Stmt> declaration();
     std::unique_ptr<Stmt> statement();
 
     std::unique_ptr<Stmt> printStatement();
     std::unique_ptr<Stmt> assignmentStatement();
-    std::unique_ptr<Stmt> ifStatement();
-    std::unique_ptr<Stmt> whileStatement();
-    std::unique_ptr<Stmt> forStatement();
+    std::unique_ptr<Stmt> indexAssignmentStatement();
+    std::unique_ptr<Stmt> removeStatement();
+    std::unique_ptr<Stmt> returnStatement();
+    std::unique_ptr<Expr> makeCall(const Token& callee, std::vector<std::unique_ptr<Expr>> args);
+    void ifHeader(OpenStmt& header);
+    void whileHeader(OpenStmt& header);
+    void forHeader(OpenStmt& header);
     std::unique_ptr<Stmt> breakStatement();
     std::unique_ptr<Stmt> continueStatement();
-    std::unique_ptr<Stmt> block();
+
+    // --- Functions ---
+    // State of the function being parsed; functions do not nest
+    bool function = false;
+    std::unordered_map<SharedString, int, SharedStringHash> functionLocals;
+    std::vector<VariableExpr*> functionReads;  // resolved by finishFunction
+
+    void functionHeader(OpenStmt& header);
+    int declareLocal(const SharedString& name);
+    std::unique_ptr<Stmt> finishFunction(OpenStmt& header, std::unique_ptr<Stmt> body);
 
     // --- Expressions ---
+    struct PendingOp {
+        Token op;
+        int precedence;
+        size_t base;  // map literals: operands below this are not entries
+    };
+    std::vector<PendingOp> ops;
+    std::vector<std::unique_ptr<Expr>> operands;
+
     std::unique_ptr<Expr> expression();
-    std::unique_ptr<Expr> equality();
-    std::unique_ptr<Expr> comparison();
-    std::unique_ptr<Expr> term();
-    std::unique_ptr<Expr> factor();
-    std::unique_ptr<Expr> unary();
     std::unique_ptr<Expr> primary();
 };
 
@@ -0,0 +1,48 @@
+#include "ProgramCache.h"
+#include "SharedString.h"
+
+uint64_t ProgramCache::key(std::string_view source, bool optimized) {
+    uint64_t hash = SharedString::hashBytes(source.data(), source.size());
+    return optimized ? ~hash : hash;
+}
+
+std::shared_ptr<const CompiledProgram> ProgramCache::find(uint64_t key, std::string_view source, bool optimized) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = index.find(key);
+    if (found == index.end() || found->second->second->source != source ||
+        found->second->second->optimized != optimized) {
+        ++stats.misses;
+        return nullptr;
+    }
+    order.splice(order.begin(), order, found->second);
+    ++stats.hits;
+    return found->second->second;
+}
+
+void ProgramCache::insert(uint64_t key, std::shared_ptr<const CompiledProgram> program) {
+    if (capacity == 0) return;
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Another thread may have compiled the same source meanwhile; keep the newest
+    auto found = index.find(key);
+    if (found != index.end()) {
+        found->second->second = std::move(program);
+        order.splice(order.begin(), order, found->second);
+        return;
+    }
+
+    if (order.size() == capacity) {
+        index.erase(order.back().first);
+        order.pop_back();
+        ++stats.evictions;
+    }
+    order.emplace_front(key, std::move(program));
+    index[key] = order.begin();
+}
+
+ProgramCache::Counters ProgramCache::counters() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    Counters result = stats;
+    result.entries = order.size();
+    return result;
+}
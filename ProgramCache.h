@@ -0,0 +1,58 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include "AST.h"
+#include "IR.h"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// A script parsed, and for -O lowered and optimized, ready to run any number
+// of times. Running only reads it, so one copy can serve several threads.
+struct CompiledProgram {
+    std::string source;
+    bool optimized = false;
+    std::vector<std::unique_ptr<Stmt>> statements;
+    IRProgram ir;  // filled in when optimized
+};
+
+// Least-recently-used set of compiled programs keyed by a hash of their
+// source. A key match is confirmed against the stored source, so a hash
+// collision is only a miss. Safe to use from several threads.
+class ProgramCache {
+public:
+    explicit ProgramCache(size_t capacity) : capacity(capacity) {}
+
+    static uint64_t key(std::string_view source, bool optimized);
+
+    std::shared_ptr<const CompiledProgram> find(uint64_t key, std::string_view source, bool optimized);
+
+    // Adds a program, evicting the least recently used one when full
+    void insert(uint64_t key, std::shared_ptr<const CompiledProgram> program);
+
+    struct Counters {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        size_t entries = 0;
+    };
+    Counters counters() const;
+
+private:
+    using Entry = std::pair<uint64_t, std::shared_ptr<const CompiledProgram>>;
+
+    size_t capacity;
+    std::list<Entry> order;  // most recently used first
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+    Counters stats;
+    mutable std::mutex mutex;
+};
+
+#endif // PROGRAM_CACHE_H
@@ -0,0 +1,123 @@
+#include "Protocol.h"
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace protocol {
+
+namespace {
+
+void putLength(std::string& out, uint32_t length) {
+    for (int i = 0; i < 4; ++i) out += static_cast<char>(length >> (8 * i) & 0xff);
+}
+
+uint32_t getLength(const char* bytes) {
+    uint32_t length = 0;
+    for (int i = 0; i < 4; ++i) length |= static_cast<uint32_t>(static_cast<unsigned char>(bytes[i])) << (8 * i);
+    return length;
+}
+
+bool readAll(int fd, char* out, size_t length) {
+    while (length > 0) {
+        ssize_t got = ::read(fd, out, length);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        out += got;
+        length -= static_cast<size_t>(got);
+    }
+    return true;
+}
+
+bool writeAll(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t sent = ::send(fd, data, length, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return false;
+        data += sent;
+        length -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+} // namespace
+
+// --- Encoding ---
+std::string encode(const Request& request) {
+    std::string out;
+    out += static_cast<char>(request.kind);
+    out += static_cast<char>(request.optimize ? optimizeFlag : 0);
+    out += request.body;
+    return out;
+}
+
+std::string encode(const Response& response) {
+    std::string out;
+    out += static_cast<char>(response.status);
+    putLength(out, static_cast<uint32_t>(response.output.size()));
+    out += response.output;
+    out += response.errors;
+    return out;
+}
+
+bool decode(std::string_view payload, Request& request) {
+    if (payload.size() < 2) return false;
+    char kind = payload[0];
+    if (kind != 'P' && kind != 'S' && kind != 'T') return false;
+    request.kind = static_cast<RequestKind>(kind);
+    request.optimize = (static_cast<uint8_t>(payload[1]) & optimizeFlag) != 0;
+    request.body = std::string(payload.substr(2));
+    return true;
+}
+
+bool decode(std::string_view payload, Response& response) {
+    if (payload.size() < 5 || static_cast<uint8_t>(payload[0]) > static_cast<uint8_t>(Status::BadRequest)) return false;
+    uint32_t outputLength = getLength(payload.data() + 1);
+    if (payload.size() - 5 < outputLength) return false;
+    response.status = static_cast<Status>(payload[0]);
+    response.output = std::string(payload.substr(5, outputLength));
+    response.errors = std::string(payload.substr(5 + outputLength));
+    return true;
+}
+
+// --- Framing ---
+bool readFrame(int fd, std::string& payload) {
+    char header[4];
+    if (!readAll(fd, header, sizeof header)) return false;
+    uint32_t length = getLength(header);
+    if (length > maxFrame) return false;
+    payload.resize(length);
+    return readAll(fd, &payload[0], length);
+}
+
+bool writeFrame(int fd, std::string_view payload) {
+    if (payload.size() > maxFrame) return false;
+    std::string frame;
+    frame.reserve(4 + payload.size());
+    putLength(frame, static_cast<uint32_t>(payload.size()));
+    frame += payload;
+    return writeAll(fd, frame.data(), frame.size());
+}
+
+int connectTo(const std::string& socketPath) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof address.sun_path) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof address) < 0) {
+        int saved = errno;
+        ::close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+} // namespace protocol
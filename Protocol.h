@@ -0,0 +1,63 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Messages exchanged with `miniscript --serve` over a Unix stream socket.
+// Every message is one frame: a 4-byte little-endian payload length, then
+// the payload. A connection carries any number of requests; each is
+// answered by one response, in order.
+//
+// Request payload:  kind (1 byte), flags (1 byte), body
+//   kind 'P': body is the path of a script file, read by the server
+//   kind 'S': body is the script source itself
+//   kind 'T': no body; the response output is the server's counters
+//   flags bit 0: run through the optimized SSA IR, as with -O
+//
+// Response payload: status (1 byte), output length (4 bytes), output,
+// then the error text (diagnostics as the command line prints them).
+namespace protocol {
+
+constexpr size_t maxFrame = 64u << 20;
+
+enum class RequestKind : char { Path = 'P', Source = 'S', Stats = 'T' };
+constexpr uint8_t optimizeFlag = 1;
+
+enum class Status : uint8_t {
+    Ok = 0,
+    CompileError = 1,  // the script did not parse or lower
+    RuntimeError = 2,  // the script stopped with a runtime error
+    BadRequest = 3,    // malformed request, or unreadable file
+};
+
+struct Request {
+    RequestKind kind = RequestKind::Source;
+    bool optimize = false;
+    std::string body;
+};
+
+struct Response {
+    Status status = Status::Ok;
+    std::string output;
+    std::string errors;
+};
+
+std::string encode(const Request& request);
+std::string encode(const Response& response);
+bool decode(std::string_view payload, Request& request);
+bool decode(std::string_view payload, Response& response);
+
+// Blocking frame I/O on a socket. Both return false once the peer has gone
+// or sent something that is not a frame.
+bool readFrame(int fd, std::string& payload);
+bool writeFrame(int fd, std::string_view payload);
+
+// Connects to a server socket; returns -1 and sets errno on failure.
+int connectTo(const std::string& socketPath);
+
+} // namespace protocol
+
+#endif // PROTOCOL_H
@@ -0,0 +1,50 @@
+#ifndef RECURSION_GUARD_H
+#define RECURSION_GUARD_H
+
+#include <pthread.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+// Bounds the passes that still recurse once per level of program nesting
+// (IR lowering, loop analysis, cache fingerprints, snapshots, map
+// printing). The parser caps that nesting at --max-depth; this catches the
+// programs within the cap that the stack still cannot hold. Declare one at
+// the top of the recursive function: once less than `reserve` bytes of the
+// thread's stack remain, it throws a std::runtime_error instead of letting
+// the stack overflow.
+class RecursionGuard {
+public:
+    static constexpr size_t reserve = 256 * 1024;
+
+    RecursionGuard() {
+        char here;
+        if (reinterpret_cast<uintptr_t>(&here) < limit())
+            throw std::runtime_error("Program is nested too deeply for this mode");
+    }
+
+    RecursionGuard(const RecursionGuard&) = delete;
+    RecursionGuard& operator=(const RecursionGuard&) = delete;
+
+private:
+    // The lowest stack address a guarded frame may start at on this thread,
+    // or 0 if the stack's extent is unknown
+    static uintptr_t limit() {
+        static thread_local uintptr_t lowest = findLimit();
+        return lowest;
+    }
+
+    static uintptr_t findLimit() {
+        pthread_attr_t attr;
+        if (pthread_getattr_np(pthread_self(), &attr) != 0) return 0;
+        void* base = nullptr;
+        size_t size = 0;
+        int status = pthread_attr_getstack(&attr, &base, &size);
+        pthread_attr_destroy(&attr);
+        if (status != 0) return 0;
+        return reinterpret_cast<uintptr_t>(base) + std::min(reserve, size / 2);
+    }
+};
+
+#endif // RECURSION_GUARD_H
@@ -0,0 +1,278 @@
+#include "Server.h"
+#include "Interpreter.h"
+#include "Inliner.h"
+#include "Fuser.h"
+#include "IRBuilder.h"
+#include "IRInterpreter.h"
+#include "IROptimizer.h"
+#include "Tokenizer.h"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+volatile std::sig_atomic_t stopRequested = 0;
+
+void requestStop(int) {
+    stopRequested = 1;
+}
+
+std::runtime_error socketError(const std::string& what, const std::string& path) {
+    return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+} // namespace
+
+Server::Server(const Options& options)
+    : options(options), cache(options.cacheCapacity), pool(options.workers), latencies(latencyWindow, 0) {}
+
+// --- Listening ---
+int Server::listen() {
+    const std::string& path = options.socketPath;
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof address.sun_path) throw std::runtime_error("Socket path is too long: " + path);
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    // A socket left behind by a server that is gone can be replaced; a live
+    // server or any other kind of file is left alone
+    struct stat existing;
+    if (::lstat(path.c_str(), &existing) == 0) {
+        if (!S_ISSOCK(existing.st_mode)) throw std::runtime_error("Not a socket: " + path);
+        int probe = protocol::connectTo(path);
+        if (probe >= 0) {
+            ::close(probe);
+            throw std::runtime_error("A server is already listening on " + path);
+        }
+        ::unlink(path.c_str());
+    }
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) throw socketError("Could not create socket", path);
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof address) < 0 || ::listen(fd, SOMAXCONN) < 0) {
+        auto error = socketError("Could not listen on", path);
+        ::close(fd);
+        throw error;
+    }
+    return fd;
+}
+
+void Server::run() {
+    int listener = listen();
+    started = std::chrono::steady_clock::now();
+
+    struct sigaction action{};
+    action.sa_handler = requestStop;
+    sigemptyset(&action.sa_mask);
+    ::sigaction(SIGINT, &action, nullptr);
+    ::sigaction(SIGTERM, &action, nullptr);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    std::cerr << "miniscript: serving on " << options.socketPath << " with " << pool.size() << " workers" << std::endl;
+
+    // Poll with a timeout so that a signal delivered to another thread is still noticed
+    while (!stopRequested) {
+        {
+            std::unique_lock<std::mutex> lock(connectionsMutex);
+            if (connections.size() >= options.maxConnections) {
+                connectionsClosed.wait_for(lock, std::chrono::milliseconds(200));
+                continue;
+            }
+        }
+        pollfd waiting{listener, POLLIN, 0};
+        if (::poll(&waiting, 1, 200) <= 0) continue;
+        int fd = ::accept(listener, nullptr, nullptr);
+        if (fd < 0) continue;
+
+        std::lock_guard<std::mutex> lock(connectionsMutex);
+        connections.insert(fd);
+        std::thread([this, fd] { serveConnection(fd); }).detach();
+    }
+
+    ::close(listener);
+    ::unlink(options.socketPath.c_str());
+
+    // Stop reading new requests; answers already being computed are still sent
+    std::unique_lock<std::mutex> lock(connectionsMutex);
+    for (int fd : connections) ::shutdown(fd, SHUT_RD);
+    connectionsClosed.wait(lock, [this] { return connections.empty(); });
+}
+
+// --- Connections ---
+void Server::serveConnection(int fd) {
+    std::string payload;
+    while (protocol::readFrame(fd, payload)) {
+        auto received = std::chrono::steady_clock::now();
+        protocol::Request request;
+        protocol::Response response;
+
+        if (!protocol::decode(payload, request)) {
+            response.status = protocol::Status::BadRequest;
+            response.errors = "Malformed request\n";
+        } else if (request.kind == protocol::RequestKind::Stats) {
+            // Answered here rather than queued, so it works while the workers are busy
+            response.output = report();
+        } else {
+            std::promise<protocol::Response> answer;
+            pool.submit([&] { answer.set_value(handle(request)); });
+            response = answer.get_future().get();
+        }
+
+        if (request.kind != protocol::RequestKind::Stats) record(response, std::chrono::steady_clock::now() - received);
+        if (!protocol::writeFrame(fd, protocol::encode(response))) break;
+    }
+
+    ::close(fd);
+    std::lock_guard<std::mutex> lock(connectionsMutex);
+    connections.erase(fd);
+    connectionsClosed.notify_all();
+}
+
+// --- Requests ---
+protocol::Response Server::handle(const protocol::Request& request) {
+    running++;
+    protocol::Response response;
+    try {
+        response = execute(request);
+    } catch (const std::exception& e) {
+        response.status = protocol::Status::RuntimeError;
+        response.errors += std::string("Runtime error: ") + e.what() + "\n";
+    }
+    running--;
+
+    // Keep the answer inside one frame
+    size_t limit = protocol::maxFrame - 4096;
+    if (response.output.size() > limit) {
+        response.output.resize(limit);
+        response.errors += "Output truncated\n";
+    }
+    return response;
+}
+
+protocol::Response Server::execute(const protocol::Request& request) {
+    protocol::Response response;
+    std::string source;
+    if (request.kind == protocol::RequestKind::Path) {
+        std::ifstream file(request.body);
+        if (!file) {
+            response.status = protocol::Status::BadRequest;
+            response.errors = "Could not open file: " + request.body + "\n";
+            return response;
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        source = buffer.str();
+    } else {
+        source = request.body;
+    }
+
+    uint64_t key = ProgramCache::key(source, request.optimize);
+    std::shared_ptr<const CompiledProgram> program = cache.find(key, source, request.optimize);
+    if (!program) {
+        program = compile(std::move(source), request.optimize, response.errors);
+        if (!program) {
+            response.status = protocol::Status::CompileError;
+            return response;
+        }
+        cache.insert(key, program);
+    }
+
+    std::ostringstream out, err;
+    bool ok = program->optimized ? IRInterpreter(out, err).run(program->ir)
+                                 : Interpreter(out, err).interpret(program->statements);
+    response.status = ok ? protocol::Status::Ok : protocol::Status::RuntimeError;
+    response.output = out.str();
+    response.errors = err.str();
+    return response;
+}
+
+std::shared_ptr<const CompiledProgram> Server::compile(std::string source, bool optimize, std::string& errors) const {
+    auto program = std::make_shared<CompiledProgram>();
+    try {
+        std::vector<Token> tokens = Tokenizer::tokenize(source);
+        program->statements = Parser(tokens, false, options.maxDepth).parse();
+        Inliner().run(program->statements);
+        Fuser().run(program->statements);
+    } catch (const ParseError& e) {
+        errors = e.diagnostic + "\nParse error: " + e.what() + "\n";
+        return nullptr;
+    } catch (const std::exception& e) {
+        errors = std::string("Parse error: ") + e.what() + "\n";
+        return nullptr;
+    }
+
+    if (optimize) {
+        try {
+            program->ir = IRBuilder().build(program->statements);
+            IROptimizer().run(program->ir);
+        } catch (const std::runtime_error& e) {
+            errors = std::string(e.what()) + "\n";
+            return nullptr;
+        }
+    }
+    program->source = std::move(source);
+    program->optimized = optimize;
+    return program;
+}
+
+// --- Counters ---
+void Server::record(const protocol::Response& response, std::chrono::steady_clock::duration latency) {
+    auto micros = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+    std::lock_guard<std::mutex> lock(statsMutex);
+    ++requests;
+    switch (response.status) {
+        case protocol::Status::Ok: break;
+        case protocol::Status::CompileError: ++compileErrors; break;
+        case protocol::Status::RuntimeError: ++runtimeErrors; break;
+        case protocol::Status::BadRequest: ++badRequests; break;
+    }
+    latencies[nextLatency++ % latencyWindow] = static_cast<uint32_t>(std::min<long long>(micros, UINT32_MAX));
+}
+
+// One "name value" pair per line
+std::string Server::report() const {
+    ProgramCache::Counters cached = cache.counters();
+    std::ostringstream out;
+    std::vector<uint32_t> recent;
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        recent.assign(latencies.begin(), latencies.begin() + std::min(nextLatency, latencyWindow));
+        out << "requests " << requests << "\n"
+            << "compile_errors " << compileErrors << "\n"
+            << "runtime_errors " << runtimeErrors << "\n"
+            << "bad_requests " << badRequests << "\n";
+    }
+    out << "cache_hits " << cached.hits << "\n"
+        << "cache_misses " << cached.misses << "\n"
+        << "cache_evictions " << cached.evictions << "\n"
+        << "cache_entries " << cached.entries << "\n"
+        << "queue_depth " << pool.pending() << "\n"
+        << "running " << running.load() << "\n";
+
+    // Percentiles over the most recent requests
+    std::sort(recent.begin(), recent.end());
+    auto percentile = [&](double p) {
+        return recent.empty() ? 0 : recent[std::min(recent.size() - 1, static_cast<size_t>(p * recent.size()))];
+    };
+    out << "latency_us_p50 " << percentile(0.50) << "\n"
+        << "latency_us_p90 " << percentile(0.90) << "\n"
+        << "latency_us_p99 " << percentile(0.99) << "\n"
+        << "latency_us_max " << (recent.empty() ? 0 : recent.back()) << "\n"
+        << "uptime_s "
+        << std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - started).count() << "\n";
+    return out.str();
+}
@@ -0,0 +1,74 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "Parser.h"
+#include "ProgramCache.h"
+#include "Protocol.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+// Long-running daemon behind `miniscript --serve`. Accepts requests on a Unix
+// socket (see Protocol.h), keeps compiled programs in an LRU cache keyed by
+// their source, and runs every submission in a fresh interpreter on a fixed
+// pool of worker threads. Each connection has its own reader thread; requests
+// on one connection are answered in order. At most maxConnections are open
+// at once; later clients wait in the listen backlog until one closes.
+class Server {
+public:
+    struct Options {
+        std::string socketPath;
+        unsigned workers = 1;
+        size_t cacheCapacity = 128;
+        size_t maxConnections = 256;
+        size_t maxDepth = Parser::defaultMaxDepth;
+    };
+
+    explicit Server(const Options& options);
+
+    // Serves until SIGINT or SIGTERM, then finishes the requests in progress
+    // and removes the socket. Throws std::runtime_error if the socket cannot
+    // be set up.
+    void run();
+
+private:
+    Options options;
+    ProgramCache cache;
+    ThreadPool pool;
+
+    // --- Counters ---
+    static constexpr size_t latencyWindow = 4096;  // recent requests kept for percentiles
+    mutable std::mutex statsMutex;
+    uint64_t requests = 0;
+    uint64_t compileErrors = 0;
+    uint64_t runtimeErrors = 0;
+    uint64_t badRequests = 0;
+    std::vector<uint32_t> latencies;  // microseconds, a ring of latencyWindow
+    size_t nextLatency = 0;
+    std::atomic<size_t> running{0};
+    std::chrono::steady_clock::time_point started;
+
+    // --- Connections ---
+    std::mutex connectionsMutex;
+    std::condition_variable connectionsClosed;
+    std::set<int> connections;
+
+    int listen();
+    void serveConnection(int fd);
+
+    // handle() wraps execute() with the running count and the frame size limit
+    protocol::Response handle(const protocol::Request& request);
+    protocol::Response execute(const protocol::Request& request);
+    std::shared_ptr<const CompiledProgram> compile(std::string source, bool optimize, std::string& errors) const;
+    void record(const protocol::Response& response, std::chrono::steady_clock::duration latency);
+    std::string report() const;
+};
+
+#endif // SERVER_H
@@ -0,0 +1,185 @@
+#include "SharedString.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <new>
+
+// --- Buffers ---
+size_t SharedString::hashBytes(const char* bytes, size_t length) {
+    // 64-bit FNV-1a
+    return extendHash(static_cast<size_t>(14695981039346656037ull), bytes, length);
+}
+
+// FNV-1a runs byte by byte, so the hash of a concatenation continues the
+// hash of its first part
+size_t SharedString::extendHash(size_t hash, const char* bytes, size_t length) {
+    uint64_t h = hash;
+    for (size_t i = 0; i < length; ++i) {
+        h ^= static_cast<unsigned char>(bytes[i]);
+        h *= 1099511628211ull;
+    }
+    return static_cast<size_t>(h);
+}
+
+SharedString::Rep* SharedString::allocate(size_t length, size_t slack) {
+    void* memory = ::operator new(sizeof(Rep) + length + 1 + slack);
+    Rep* r = new (memory) Rep;
+    r->refs.store(1, std::memory_order_relaxed);
+    r->length = length;
+    r->hash = 0;
+    r->interned = false;
+    r->immortal = false;
+    r->slack = static_cast<uint32_t>(slack);
+    r->chars()[length] = '\0';
+    return r;
+}
+
+SharedString::Rep* SharedString::emptyRep() {
+    static Rep* empty = [] {
+        Rep* r = allocate(0);
+        r->hash = hashBytes("", 0);
+        r->interned = true;
+        r->immortal = true;
+        return r;
+    }();
+    return empty;
+}
+
+// --- Construction ---
+SharedString::SharedString() : rep(emptyRep()) {}
+
+SharedString::SharedString(std::string_view text) : rep(nullptr) {
+    if (text.empty()) {
+        rep = emptyRep();
+        return;
+    }
+    rep = allocate(text.size());
+    std::memcpy(rep->chars(), text.data(), text.size());
+    rep->hash = hashBytes(text.data(), text.size());
+}
+
+SharedString& SharedString::operator=(const SharedString& other) noexcept {
+    if (rep != other.rep) {
+        other.retain();
+        release();
+        rep = other.rep;
+    }
+    return *this;
+}
+
+SharedString& SharedString::operator=(SharedString&& other) noexcept {
+    if (this != &other) {
+        release();
+        rep = other.rep;
+        other.rep = emptyRep();
+    }
+    return *this;
+}
+
+SharedString SharedString::concat(const SharedString& left, const SharedString& right) {
+    if (left.empty()) return right;
+    if (right.empty()) return left;
+
+    Rep* r = allocate(left.size() + right.size());
+    std::memcpy(r->chars(), left.data(), left.size());
+    std::memcpy(r->chars() + left.size(), right.data(), right.size());
+    r->hash = hashBytes(r->chars(), r->length);
+    return SharedString(r);
+}
+
+void SharedString::append(const SharedString& tail) {
+    if (tail.empty()) return;
+    if (empty()) {
+        *this = tail;
+        return;
+    }
+
+    size_t length = rep->length + tail.size();
+    if (!rep->immortal && tail.size() <= rep->slack && rep->refs.load(std::memory_order_acquire) == 1) {
+        std::memcpy(rep->chars() + rep->length, tail.data(), tail.size());
+        rep->chars()[length] = '\0';
+        rep->hash = extendHash(rep->hash, tail.data(), tail.size());
+        rep->slack -= static_cast<uint32_t>(tail.size());
+        rep->length = length;
+        return;
+    }
+
+    Rep* r = allocate(length, std::min<size_t>(length, UINT32_MAX));
+    std::memcpy(r->chars(), data(), size());
+    std::memcpy(r->chars() + size(), tail.data(), tail.size());
+    r->hash = extendHash(rep->hash, tail.data(), tail.size());
+    release();
+    rep = r;
+}
+
+// --- Image Records ---
+size_t SharedString::recordSize(size_t length) {
+    return (sizeof(Rep) + length + 1 + 7) & ~static_cast<size_t>(7);
+}
+
+void SharedString::writeRecord(void* out, std::string_view text) {
+    std::memset(out, 0, recordSize(text.size()));
+    Rep* r = new (out) Rep;
+    r->refs.store(1, std::memory_order_relaxed);
+    r->length = text.size();
+    r->hash = hashBytes(text.data(), text.size());
+    r->interned = false;
+    r->immortal = true;
+    std::memcpy(r->chars(), text.data(), text.size());
+    r->chars()[text.size()] = '\0';
+}
+
+bool SharedString::readRecord(const void* record, size_t available, std::string_view& text) {
+    // Room for the header and the terminator comes first, so the bound below cannot wrap
+    if (available < sizeof(Rep) + 1 || reinterpret_cast<uintptr_t>(record) % alignof(Rep) != 0) return false;
+    const Rep* r = static_cast<const Rep*>(record);
+    if (r->length > available - sizeof(Rep) - 1 || r->interned || !r->immortal) return false;
+    text = std::string_view(r->chars(), r->length);
+    return r->hash == hashBytes(text.data(), text.size());
+}
+
+SharedString SharedString::fromRecord(const void* record) {
+    return SharedString(const_cast<Rep*>(static_cast<const Rep*>(record)));
+}
+
+uint32_t SharedString::recordLayout() {
+    return static_cast<uint32_t>(sizeof(Rep) << 16 | offsetof(Rep, hash) << 8 | offsetof(Rep, interned));
+}
+
+// --- Interning ---
+StringTable& StringTable::global() {
+    static StringTable table;
+    return table;
+}
+
+SharedString StringTable::intern(std::string_view text) {
+    if (text.empty()) return SharedString();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = entries.find(text);
+    if (found != entries.end()) return SharedString(found->second);
+
+    SharedString::Rep* r = SharedString::allocate(text.size());
+    std::memcpy(r->chars(), text.data(), text.size());
+    r->hash = SharedString::hashBytes(text.data(), text.size());
+    r->interned = true;
+    r->immortal = true;
+    entries.emplace(std::string_view(r->chars(), r->length), r);
+    totalBytes += sizeof(SharedString::Rep) + text.size() + 1;
+    return SharedString(r);
+}
+
+size_t StringTable::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+size_t StringTable::bytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return totalBytes;
+}
+
+StringTable::~StringTable() {
+    for (auto& entry : entries) ::operator delete(entry.second);
+}
@@ -0,0 +1,131 @@
+#ifndef SHARED_STRING_H
+#define SHARED_STRING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Immutable, reference-counted string buffer used for all runtime string
+// values. Length and hash are computed once when the buffer is created, so
+// copying a SharedString never copies bytes and hashing is free.
+//
+// Interned strings (literals and identifiers, see StringTable) are unique per
+// content and live for the whole process: two interned strings are equal
+// exactly when they share a buffer, and copying them skips the refcount.
+class SharedString {
+public:
+    SharedString();
+    explicit SharedString(std::string_view text);
+
+    SharedString(const SharedString& other) noexcept : rep(other.rep) { retain(); }
+    SharedString(SharedString&& other) noexcept : rep(other.rep) { other.rep = emptyRep(); }
+    SharedString& operator=(const SharedString& other) noexcept;
+    SharedString& operator=(SharedString&& other) noexcept;
+    ~SharedString() { release(); }
+
+    static SharedString concat(const SharedString& left, const SharedString& right);
+
+    // *this = concat(*this, tail), but writes into this buffer when it is
+    // the only reference and has room. Buffers it allocates keep spare room
+    // in proportion to their length, so repeated appends copy in amortized
+    // linear time.
+    void append(const SharedString& tail);
+
+    const char* data() const { return rep->chars(); }
+    size_t size() const { return rep->length; }
+    bool empty() const { return rep->length == 0; }
+    size_t hash() const { return rep->hash; }
+    bool isInterned() const { return rep->interned; }
+
+    std::string_view view() const { return std::string_view(rep->chars(), rep->length); }
+    std::string str() const { return std::string(rep->chars(), rep->length); }
+
+    friend bool operator==(const SharedString& a, const SharedString& b);
+    friend bool operator!=(const SharedString& a, const SharedString& b) { return !(a == b); }
+
+    static size_t hashBytes(const char* bytes, size_t length);
+
+    // Snapshot images store strings as ready-made buffers ("records"), so a
+    // restored string points into the mapped image instead of being copied.
+    // Such strings are never freed; the image must stay mapped.
+    static size_t recordSize(size_t length);  // multiple of 8
+    static void writeRecord(void* out, std::string_view text);  // `out` 8-aligned
+    static bool readRecord(const void* record, size_t available, std::string_view& text);
+    static SharedString fromRecord(const void* record);
+    static uint32_t recordLayout();  // changes whenever the record format does
+
+private:
+    friend class StringTable;
+
+    struct Rep {
+        std::atomic<long> refs;
+        size_t length;
+        size_t hash;
+        bool interned;
+        bool immortal;  // interned or image-backed: never refcounted
+        uint32_t slack;  // bytes allocated past the terminator, for append()
+
+        char* chars() { return reinterpret_cast<char*>(this + 1); }
+        const char* chars() const { return reinterpret_cast<const char*>(this + 1); }
+    };
+
+    Rep* rep;
+
+    explicit SharedString(Rep* r) : rep(r) {}
+
+    static Rep* allocate(size_t length, size_t slack = 0);
+    static size_t extendHash(size_t hash, const char* bytes, size_t length);
+    static Rep* emptyRep();
+
+    void retain() const {
+        if (!rep->immortal) rep->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+    void release() {
+        if (!rep->immortal && rep->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            ::operator delete(rep);
+    }
+};
+
+inline bool operator==(const SharedString& a, const SharedString& b) {
+    if (a.rep == b.rep) return true;
+    if (a.rep->interned && b.rep->interned) return false;
+    if (a.rep->length != b.rep->length || a.rep->hash != b.rep->hash) return false;
+    return std::char_traits<char>::compare(a.data(), b.data(), a.size()) == 0;
+}
+
+inline std::ostream& operator<<(std::ostream& os, const SharedString& s) {
+    return os.write(s.data(), static_cast<std::streamsize>(s.size()));
+}
+
+struct SharedStringHash {
+    size_t operator()(const SharedString& s) const { return s.hash(); }
+};
+
+// Process-wide interning table for string literals and identifiers. Entries
+// are created by the parser and are never freed while the process runs.
+class StringTable {
+public:
+    static StringTable& global();
+
+    SharedString intern(std::string_view text);
+    size_t size() const;
+    size_t bytes() const;
+
+    ~StringTable();
+
+private:
+    struct ViewHash {
+        size_t operator()(std::string_view v) const { return SharedString::hashBytes(v.data(), v.size()); }
+    };
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string_view, SharedString::Rep*, ViewHash> entries;
+    size_t totalBytes = 0;
+};
+
+#endif // SHARED_STRING_H
@@ -0,0 +1,544 @@
+#include "Snapshot.h"
+#include "Native.h"
+#include "RecursionGuard.h"
+#include "Utils.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+
+struct ImageHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t layout;    // SharedString::recordLayout() of the writer
+    uint64_t checksum;  // of everything after the header
+    uint64_t fileSize;
+    uint64_t strings, stringsSize;
+    uint64_t globals;
+    uint32_t globalCount, rootCount;
+    uint64_t nodes;
+    uint32_t nodeCount, rootList;
+    uint64_t lists;
+    uint32_t listCount, reserved;
+};
+
+// One AST node. Children are node indices, names and literals are string
+// record offsets; `none` marks an absent child. Frame slots are stored as
+// the int cast to uint32_t, so scope::nearest is `none`.
+//   Int/Float/Char: a = value bits      String: a = string
+//   Variable: a = name, b = frame slot
+//   Binary: a, b = operands, c = op text   Unary: a = operand, c = op text
+//   Print: a   Assign: a = name, b = value, c = frame slot
+//   If: a = cond, b = then, c = else
+//   While: a = cond, b = body   For: a = init, b = cond, c = incr, d = body
+//   Block: a = first list entry, b = count
+//   MapLiteral: a = first list entry, b = count (keys and values alternate)
+//   Index: a = object, b = index   IndexAssign: a = object, b = index, c = value
+//   Remove: a = object, b = index   ForIn: a = name, b = map, c = body, d = frame slot
+//   Call: a = name, b = first list entry, c = argument count
+//   Function: a = name, b = first list entry (local count, then parameter
+//             names), c = parameter count, d = body
+//   Return: a = value
+struct ImageNode {
+    uint8_t kind;
+    uint8_t token;  // operator TokenType of Binary and Unary
+    uint16_t reserved;
+    int32_t line;   // statement line, or operator line for Binary and Unary
+    uint32_t a, b, c, d;
+};
+
+namespace {
+
+const char imageMagic[8] = {'M', 'S', 'I', 'M', 'A', 'G', 'E', '\0'};
+const uint32_t imageVersion = 4;
+const uint32_t none = 0xffffffff;
+
+enum Kind : uint8_t {
+    Int, Float, Char, String, Variable, Binary, Unary, MapLiteral, Index, Call,
+    Print, Assign, If, While, For, Block, Break, Continue, IndexAssign, Remove, ForIn, Function, Return
+};
+
+struct ImageGlobal {
+    uint32_t name;
+    uint32_t tag;   // Value alternative index
+    uint64_t bits;  // the value, or a string record offset
+};
+
+uint64_t checksum(const char* data, size_t size) {
+    uint64_t h = 14695981039346656037ull;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof word);
+        h = (h ^ word) * 1099511628211ull;
+        h ^= h >> 32;
+    }
+    for (; i < size; ++i) h = (h ^ static_cast<unsigned char>(data[i])) * 1099511628211ull;
+    return h;
+}
+
+// --- Writing ---
+class ImageWriter {
+public:
+    std::vector<uint64_t> strings;  // keeps records 8-aligned
+    std::vector<ImageGlobal> globals;
+    std::vector<ImageNode> nodes;
+    std::vector<uint32_t> lists;
+
+    uint32_t string(std::string_view text) {
+        auto found = offsets.find(text);
+        if (found != offsets.end()) return found->second;
+
+        size_t offset = strings.size() * sizeof(uint64_t);
+        strings.resize(strings.size() + SharedString::recordSize(text.size()) / sizeof(uint64_t));
+        SharedString::writeRecord(reinterpret_cast<char*>(strings.data()) + offset, text);
+        texts.emplace_back(text);
+        offsets.emplace(texts.back(), static_cast<uint32_t>(offset));
+        return static_cast<uint32_t>(offset);
+    }
+
+    uint32_t node(uint8_t kind, int line, uint32_t a = none, uint32_t b = none, uint32_t c = none,
+                  uint32_t d = none, uint8_t token = 0) {
+        nodes.push_back(ImageNode{kind, token, 0, line, a, b, c, d});
+        return static_cast<uint32_t>(nodes.size() - 1);
+    }
+
+    uint32_t expr(const Expr* e) {
+        RecursionGuard guard;
+        if (auto intExpr = dynamic_cast<const IntExpr*>(e)) {
+            return node(Int, 0, static_cast<uint32_t>(intExpr->value));
+        } else if (auto floatExpr = dynamic_cast<const FloatExpr*>(e)) {
+            uint32_t bits;
+            std::memcpy(&bits, &floatExpr->value, sizeof bits);
+            return node(Float, 0, bits);
+        } else if (auto charExpr = dynamic_cast<const CharExpr*>(e)) {
+            return node(Char, 0, static_cast<unsigned char>(charExpr->value));
+        } else if (auto stringExpr = dynamic_cast<const StringExpr*>(e)) {
+            return node(String, 0, string(stringExpr->value.view()));
+        } else if (auto var = dynamic_cast<const VariableExpr*>(e)) {
+            return node(Variable, 0, string(var->name.view()), static_cast<uint32_t>(var->local));
+        } else if (auto bin = dynamic_cast<const BinaryExpr*>(e)) {
+            uint32_t left = expr(bin->left.get());
+            uint32_t right = expr(bin->right.get());
+            return node(Binary, bin->op.line, left, right, string(bin->op.text), none,
+                        static_cast<uint8_t>(bin->op.type));
+        } else if (auto unary = dynamic_cast<const UnaryExpr*>(e)) {
+            uint32_t right = expr(unary->right.get());
+            return node(Unary, unary->op.line, right, none, string(unary->op.text), none,
+                        static_cast<uint8_t>(unary->op.type));
+        } else if (auto mapExpr = dynamic_cast<const MapExpr*>(e)) {
+            std::vector<uint32_t> children;
+            for (size_t i = 0; i < mapExpr->keys.size(); ++i) {
+                children.push_back(expr(mapExpr->keys[i].get()));
+                children.push_back(expr(mapExpr->values[i].get()));
+            }
+            return node(MapLiteral, 0, entries(children), static_cast<uint32_t>(children.size()));
+        } else if (auto index = dynamic_cast<const IndexExpr*>(e)) {
+            uint32_t object = expr(index->object.get());
+            return node(Index, 0, object, expr(index->index.get()));
+        } else if (auto call = dynamic_cast<const CallExpr*>(e)) {
+            std::vector<uint32_t> children;
+            for (const auto& arg : call->args) children.push_back(expr(arg.get()));
+            return node(Call, 0, string(call->name.view()), entries(children), static_cast<uint32_t>(children.size()));
+        }
+        throw std::runtime_error("Unknown expression type");
+    }
+
+    uint32_t stmt(const Stmt* s) {
+        RecursionGuard guard;
+        if (!s) return none;
+        if (auto printStmt = dynamic_cast<const PrintStmt*>(s)) {
+            return node(Print, s->line, expr(printStmt->expression.get()));
+        } else if (auto assignStmt = dynamic_cast<const AssignStmt*>(s)) {
+            uint32_t value = expr(assignStmt->value.get());
+            return node(Assign, s->line, string(assignStmt->name.view()), value, static_cast<uint32_t>(assignStmt->local));
+        } else if (auto ifStmt = dynamic_cast<const IfStmt*>(s)) {
+            uint32_t cond = expr(ifStmt->condition.get());
+            uint32_t thenBranch = stmt(ifStmt->thenBranch.get());
+            uint32_t elseBranch = stmt(ifStmt->elseBranch.get());
+            return node(If, s->line, cond, thenBranch, elseBranch);
+        } else if (auto whileStmt = dynamic_cast<const WhileStmt*>(s)) {
+            uint32_t cond = expr(whileStmt->condition.get());
+            return node(While, s->line, cond, stmt(whileStmt->body.get()));
+        } else if (auto forStmt = dynamic_cast<const ForStmt*>(s)) {
+            uint32_t init = stmt(forStmt->initializer.get());
+            uint32_t cond = forStmt->condition ? expr(forStmt->condition.get()) : none;
+            uint32_t incr = stmt(forStmt->increment.get());
+            return node(For, s->line, init, cond, incr, stmt(forStmt->body.get()));
+        } else if (auto lazy = dynamic_cast<const LazyBlockStmt*>(s)) {
+            return stmt(lazy->body());
+        } else if (auto blockStmt = dynamic_cast<const BlockStmt*>(s)) {
+            std::vector<uint32_t> children;
+            for (const auto& child : blockStmt->statements) children.push_back(stmt(child.get()));
+            return node(Block, s->line, entries(children), static_cast<uint32_t>(children.size()));
+        } else if (dynamic_cast<const BreakStmt*>(s)) {
+            return node(Break, s->line);
+        } else if (dynamic_cast<const ContinueStmt*>(s)) {
+            return node(Continue, s->line);
+        } else if (auto assign = dynamic_cast<const IndexAssignStmt*>(s)) {
+            uint32_t object = expr(assign->object.get());
+            uint32_t index = expr(assign->index.get());
+            return node(IndexAssign, s->line, object, index, expr(assign->value.get()));
+        } else if (auto removeStmt = dynamic_cast<const RemoveStmt*>(s)) {
+            uint32_t object = expr(removeStmt->object.get());
+            return node(Remove, s->line, object, expr(removeStmt->index.get()));
+        } else if (auto forIn = dynamic_cast<const ForInStmt*>(s)) {
+            uint32_t map = expr(forIn->map.get());
+            uint32_t body = stmt(forIn->body.get());
+            return node(ForIn, s->line, string(forIn->name.view()), map, body, static_cast<uint32_t>(forIn->local));
+        } else if (auto function = dynamic_cast<const FunctionStmt*>(s)) {
+            std::vector<uint32_t> header{function->locals};
+            for (const auto& param : function->params) header.push_back(string(param.view()));
+            uint32_t body = stmt(function->body.get());
+            return node(Function, s->line, string(function->name.view()), entries(header),
+                        static_cast<uint32_t>(function->params.size()), body);
+        } else if (auto returnStmt = dynamic_cast<const ReturnStmt*>(s)) {
+            return node(Return, s->line, returnStmt->value ? expr(returnStmt->value.get()) : none);
+        }
+        throw std::runtime_error("Unknown statement type");
+    }
+
+private:
+    std::deque<std::string> texts;
+
+    uint32_t entries(const std::vector<uint32_t>& children) {
+        uint32_t first = static_cast<uint32_t>(lists.size());
+        lists.insert(lists.end(), children.begin(), children.end());
+        return first;
+    }
+
+    std::unordered_map<std::string_view, uint32_t> offsets;
+};
+
+size_t align8(size_t n) {
+    return (n + 7) & ~static_cast<size_t>(7);
+}
+
+void append(std::string& out, const void* data, size_t size) {
+    out.append(static_cast<const char*>(data), size);
+    out.resize(align8(out.size()), '\0');
+}
+
+} // namespace
+
+void Snapshot::write(const std::string& path, const Environment& env, const std::vector<const Stmt*>& program) {
+    ImageWriter writer;
+    for (const auto& [name, value] : env.globals()) {
+        ImageGlobal global{writer.string(name.view()), static_cast<uint32_t>(value.index()), 0};
+        std::visit([&](const auto& val) {
+            using T = std::decay_t<decltype(val)>;
+            if constexpr (std::is_same_v<T, SharedString>) global.bits = writer.string(val.view());
+            else if constexpr (std::is_same_v<T, MapRef>) throw std::runtime_error("images cannot hold maps (global " + name.str() + ")");
+            else std::memcpy(&global.bits, &val, sizeof val);
+        }, value);
+        writer.globals.push_back(global);
+    }
+
+    std::vector<uint32_t> roots;
+    for (const Stmt* s : program) roots.push_back(writer.stmt(s));
+    uint32_t rootList = static_cast<uint32_t>(writer.lists.size());
+    writer.lists.insert(writer.lists.end(), roots.begin(), roots.end());
+
+    ImageHeader header{};
+    std::memcpy(header.magic, imageMagic, sizeof imageMagic);
+    header.version = imageVersion;
+    header.layout = SharedString::recordLayout();
+
+    std::string image(align8(sizeof header), '\0');
+    header.strings = image.size();
+    header.stringsSize = writer.strings.size() * sizeof(uint64_t);
+    append(image, writer.strings.data(), header.stringsSize);
+    header.globals = image.size();
+    header.globalCount = static_cast<uint32_t>(writer.globals.size());
+    append(image, writer.globals.data(), writer.globals.size() * sizeof(ImageGlobal));
+    header.nodes = image.size();
+    header.nodeCount = static_cast<uint32_t>(writer.nodes.size());
+    append(image, writer.nodes.data(), writer.nodes.size() * sizeof(ImageNode));
+    header.lists = image.size();
+    header.listCount = static_cast<uint32_t>(writer.lists.size());
+    append(image, writer.lists.data(), writer.lists.size() * sizeof(uint32_t));
+    header.rootList = rootList;
+    header.rootCount = static_cast<uint32_t>(roots.size());
+
+    header.fileSize = image.size();
+    header.checksum = checksum(image.data() + align8(sizeof header), image.size() - align8(sizeof header));
+    std::memcpy(&image[0], &header, sizeof header);
+
+    write_atomically(path, image);
+}
+
+// --- Loading ---
+Snapshot::Snapshot(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Could not open file: " + path);
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(ImageHeader)) {
+        ::close(fd);
+        throw std::runtime_error("not a snapshot image (too small)");
+    }
+    size = static_cast<size_t>(info.st_size);
+    void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) throw std::runtime_error("Could not map file: " + path);
+    base = static_cast<const char*>(mapped);
+
+    try {
+        validate();
+    } catch (...) {
+        ::munmap(mapped, size);
+        throw;
+    }
+}
+
+void Snapshot::validate() const {
+    const ImageHeader& h = header();
+    if (std::memcmp(h.magic, imageMagic, sizeof imageMagic) != 0) throw std::runtime_error("not a snapshot image");
+    if (h.version != imageVersion)
+        throw std::runtime_error("unsupported image version " + std::to_string(h.version));
+    if (h.layout != SharedString::recordLayout()) throw std::runtime_error("image was written by an incompatible build");
+    if (h.fileSize != size) throw std::runtime_error("image is truncated");
+
+    size_t payload = align8(sizeof(ImageHeader));
+    if (checksum(base + payload, size - payload) != h.checksum) throw std::runtime_error("checksum mismatch");
+
+    auto section = [&](uint64_t offset, uint64_t count, size_t element) {
+        if (offset % 8 != 0 || offset < payload || offset > size || count > (size - offset) / element)
+            throw std::runtime_error("section out of bounds");
+    };
+    section(h.strings, h.stringsSize, 1);
+    section(h.globals, h.globalCount, sizeof(ImageGlobal));
+    section(h.nodes, h.nodeCount, sizeof(ImageNode));
+    section(h.lists, h.listCount, sizeof(uint32_t));
+    if (h.rootList > h.listCount || h.rootCount > h.listCount - h.rootList)
+        throw std::runtime_error("program out of bounds");
+
+    const ImageGlobal* globals = reinterpret_cast<const ImageGlobal*>(base + h.globals);
+    for (uint32_t i = 0; i < h.globalCount; ++i) {
+        text(globals[i].name);
+        if (globals[i].tag > 3) throw std::runtime_error("bad value tag");
+        if (globals[i].tag == 3 && globals[i].bits > none) throw std::runtime_error("bad string reference");
+        if (globals[i].tag == 3) text(static_cast<uint32_t>(globals[i].bits));
+    }
+
+    // Children always precede their parent, so the tree is acyclic, and a
+    // node's frame slots and returns are known before its parent is checked.
+    // Only top-level functions may have either.
+    struct FrameUse {
+        uint32_t slots = 0;
+        bool returns = false;
+    };
+    std::vector<FrameUse> use(h.nodeCount);
+    auto isExpr = [](uint8_t kind) { return kind <= Call; };
+    auto child = [&](uint32_t parent, uint32_t index, bool expr, bool optional) {
+        if (index == none && optional) return;
+        if (index >= parent || isExpr(node(index).kind) != expr || node(index).kind == Function)
+            throw std::runtime_error("malformed program");
+        use[parent].slots = std::max(use[parent].slots, use[index].slots);
+        use[parent].returns = use[parent].returns || use[index].returns;
+    };
+    auto slot = [&](uint32_t parent, uint32_t local) {
+        if (local != none && local != none - 1) use[parent].slots = std::max(use[parent].slots, local + 1);
+    };
+    auto children = [&](uint32_t parent, uint32_t first, uint32_t count, bool expr) {
+        if (first > h.listCount || count > h.listCount - first) throw std::runtime_error("malformed program");
+        const uint32_t* entries = list(first);
+        for (uint32_t k = 0; k < count; ++k) child(parent, entries[k], expr, false);
+    };
+    for (uint32_t i = 0; i < h.nodeCount; ++i) {
+        const ImageNode& n = node(i);
+        switch (n.kind) {
+            case Int: case Float: case Char: break;
+            case String: text(n.a); break;
+            case Variable: text(n.a); slot(i, n.b); break;
+            case Binary: child(i, n.a, true, false); child(i, n.b, true, false); text(n.c); break;
+            case Unary: child(i, n.a, true, false); text(n.c); break;
+            case MapLiteral:
+                if (n.b % 2 != 0) throw std::runtime_error("malformed program");
+                children(i, n.a, n.b, true);
+                break;
+            case Index: child(i, n.a, true, false); child(i, n.b, true, false); break;
+            case Call: text(n.a); children(i, n.b, n.c, true); break;
+            case Print: child(i, n.a, true, false); break;
+            case Assign: text(n.a); child(i, n.b, true, false); slot(i, n.c); break;
+            case If: child(i, n.a, true, false); child(i, n.b, false, false); child(i, n.c, false, true); break;
+            case While: child(i, n.a, true, false); child(i, n.b, false, false); break;
+            case For:
+                child(i, n.a, false, true);
+                child(i, n.b, true, true);
+                child(i, n.c, false, true);
+                child(i, n.d, false, false);
+                break;
+            case Block: children(i, n.a, n.b, false); break;
+            case Break: case Continue: break;
+            case IndexAssign: child(i, n.a, true, false); child(i, n.b, true, false); child(i, n.c, true, false); break;
+            case Remove: child(i, n.a, true, false); child(i, n.b, true, false); break;
+            case ForIn: text(n.a); child(i, n.b, true, false); child(i, n.c, false, false); slot(i, n.d); break;
+            case Function: {
+                text(n.a);
+                if (n.b >= h.listCount || n.c > h.listCount - n.b - 1) throw std::runtime_error("malformed program");
+                const uint32_t* header = list(n.b);
+                for (uint32_t k = 1; k <= n.c; ++k) text(header[k]);
+                child(i, n.d, false, false);
+                if (header[0] < n.c || use[i].slots > header[0]) throw std::runtime_error("malformed program");
+                use[i] = FrameUse{};
+                break;
+            }
+            case Return: child(i, n.a, true, true); use[i].returns = true; break;
+            default: throw std::runtime_error("malformed program");
+        }
+        if ((n.kind == Binary || n.kind == Unary) && n.token > static_cast<uint8_t>(TokenType::Return))
+            throw std::runtime_error("malformed program");
+    }
+    const uint32_t* roots = list(h.rootList);
+    for (uint32_t k = 0; k < h.rootCount; ++k) {
+        if (roots[k] >= h.nodeCount || isExpr(node(roots[k]).kind) || use[roots[k]].slots > 0 || use[roots[k]].returns)
+            throw std::runtime_error("malformed program");
+    }
+}
+
+const ImageNode& Snapshot::node(uint32_t index) const {
+    return reinterpret_cast<const ImageNode*>(base + header().nodes)[index];
+}
+
+const uint32_t* Snapshot::list(uint32_t index) const {
+    return reinterpret_cast<const uint32_t*>(base + header().lists) + index;
+}
+
+std::string_view Snapshot::text(uint32_t offset) const {
+    const ImageHeader& h = header();
+    std::string_view view;
+    if (offset % 8 != 0 || offset >= h.stringsSize ||
+        !SharedString::readRecord(base + h.strings + offset, h.stringsSize - offset, view))
+        throw std::runtime_error("bad string record");
+    return view;
+}
+
+SharedString Snapshot::name(uint32_t offset) const {
+    return StringTable::global().intern(text(offset));
+}
+
+// --- Restoring ---
+size_t Snapshot::globalCount() const {
+    return header().globalCount;
+}
+
+void Snapshot::restore(Environment& env) const {
+    const ImageHeader& h = header();
+    const ImageGlobal* globals = reinterpret_cast<const ImageGlobal*>(base + h.globals);
+    for (uint32_t i = 0; i < h.globalCount; ++i) {
+        const ImageGlobal& global = globals[i];
+        Value value;
+        switch (global.tag) {
+            case 0: { int v; std::memcpy(&v, &global.bits, sizeof v); value = v; break; }
+            case 1: { float v; std::memcpy(&v, &global.bits, sizeof v); value = v; break; }
+            case 2: { char v; std::memcpy(&v, &global.bits, sizeof v); value = v; break; }
+            default: value = SharedString::fromRecord(base + h.strings + global.bits); break;
+        }
+        env.set(name(global.name), std::move(value));
+    }
+}
+
+std::unique_ptr<Expr> Snapshot::expr(uint32_t index) const {
+    RecursionGuard guard;
+    const ImageNode& n = node(index);
+    switch (n.kind) {
+        case Int: return std::make_unique<IntExpr>(static_cast<int>(n.a));
+        case Float: {
+            float v;
+            std::memcpy(&v, &n.a, sizeof v);
+            return std::make_unique<FloatExpr>(v);
+        }
+        case Char: return std::make_unique<CharExpr>(static_cast<char>(n.a));
+        case String: return std::make_unique<StringExpr>(name(n.a));
+        case Variable: return std::make_unique<VariableExpr>(name(n.a), static_cast<int>(n.b));
+        case Binary: {
+            Token op(static_cast<TokenType>(n.token), std::string(text(n.c)), n.line);
+            return std::make_unique<BinaryExpr>(expr(n.a), op, expr(n.b));
+        }
+        case Unary: {
+            Token op(static_cast<TokenType>(n.token), std::string(text(n.c)), n.line);
+            return std::make_unique<UnaryExpr>(op, expr(n.a));
+        }
+        case MapLiteral: {
+            std::vector<std::unique_ptr<Expr>> keys, values;
+            const uint32_t* entries = list(n.a);
+            for (uint32_t k = 0; k < n.b; k += 2) {
+                keys.push_back(expr(entries[k]));
+                values.push_back(expr(entries[k + 1]));
+            }
+            return std::make_unique<MapExpr>(std::move(keys), std::move(values));
+        }
+        case Index: return std::make_unique<IndexExpr>(expr(n.a), expr(n.b));
+        default: {
+            std::vector<std::unique_ptr<Expr>> args;
+            const uint32_t* entries = list(n.b);
+            for (uint32_t k = 0; k < n.c; ++k) args.push_back(expr(entries[k]));
+            SharedString callee = name(n.a);
+            return std::make_unique<CallExpr>(callee, NativeRegistry::slot(callee), std::move(args));
+        }
+    }
+}
+
+std::unique_ptr<Stmt> Snapshot::stmt(uint32_t index) const {
+    RecursionGuard guard;
+    if (index == none) return nullptr;
+    const ImageNode& n = node(index);
+    std::unique_ptr<Stmt> result;
+    switch (n.kind) {
+        case Print: result = std::make_unique<PrintStmt>(expr(n.a)); break;
+        case Assign: {
+            auto assign = std::make_unique<AssignStmt>(name(n.a), expr(n.b));
+            assign->local = static_cast<int>(n.c);
+            result = std::move(assign);
+            break;
+        }
+        case If: result = std::make_unique<IfStmt>(expr(n.a), stmt(n.b), stmt(n.c)); break;
+        case While: result = std::make_unique<WhileStmt>(expr(n.a), stmt(n.b)); break;
+        case For:
+            result = std::make_unique<ForStmt>(stmt(n.a), n.b == none ? nullptr : expr(n.b), stmt(n.c), stmt(n.d));
+            break;
+        case Block: {
+            std::vector<std::unique_ptr<Stmt>> statements;
+            const uint32_t* entries = list(n.a);
+            for (uint32_t k = 0; k < n.b; ++k) statements.push_back(stmt(entries[k]));
+            result = std::make_unique<BlockStmt>(std::move(statements));
+            break;
+        }
+        case Break: result = std::make_unique<BreakStmt>(); break;
+        case Continue: result = std::make_unique<ContinueStmt>(); break;
+        case IndexAssign: result = std::make_unique<IndexAssignStmt>(expr(n.a), expr(n.b), expr(n.c)); break;
+        case Remove: result = std::make_unique<RemoveStmt>(expr(n.a), expr(n.b)); break;
+        case ForIn: {
+            auto forIn = std::make_unique<ForInStmt>(name(n.a), expr(n.b), stmt(n.c));
+            forIn->local = static_cast<int>(n.d);
+            result = std::move(forIn);
+            break;
+        }
+        case Function: {
+            const uint32_t* header = list(n.b);
+            std::vector<SharedString> params;
+            for (uint32_t k = 1; k <= n.c; ++k) params.push_back(name(header[k]));
+            SharedString function = name(n.a);
+            result = std::make_unique<FunctionStmt>(function, NativeRegistry::slot(function), std::move(params),
+                                                    stmt(n.d), header[0]);
+            break;
+        }
+        default: result = std::make_unique<ReturnStmt>(n.a == none ? nullptr : expr(n.a)); break;
+    }
+    result->line = n.line;
+    return result;
+}
+
+std::vector<std::unique_ptr<Stmt>> Snapshot::program() const {
+    std::vector<std::unique_ptr<Stmt>> statements;
+    const uint32_t* roots = list(header().rootList);
+    for (uint32_t k = 0; k < header().rootCount; ++k) statements.push_back(stmt(roots[k]));
+    return statements;
+}
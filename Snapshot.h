@@ -0,0 +1,55 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "AST.h"
+#include "Environment.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct ImageHeader;
+struct ImageNode;
+
+// Image of an interpreter after a script has run: its global variables and
+// the parsed program. Everything inside the image refers to other parts by
+// offset, so it can be mapped at any address and used in place; string
+// values are restored as pointers into the mapping rather than copies.
+//
+// Layout: header, string records, globals, AST nodes (children before
+// parents), child lists. The header carries a format version, the string
+// record layout of this build and a checksum of everything after it.
+class Snapshot {
+public:
+    // Writes an image. Throws std::runtime_error if the file cannot be written.
+    static void write(const std::string& path, const Environment& env, const std::vector<const Stmt*>& program);
+
+    // Maps and validates an image. Throws std::runtime_error saying why an
+    // image is rejected. The mapping is kept for the life of the process,
+    // since restored strings point into it.
+    explicit Snapshot(const std::string& path);
+
+    // Defines the saved globals in `env`.
+    void restore(Environment& env) const;
+
+    // Rebuilds the saved program.
+    std::vector<std::unique_ptr<Stmt>> program() const;
+
+    size_t globalCount() const;
+
+private:
+    const char* base = nullptr;
+    size_t size = 0;
+
+    const ImageHeader& header() const { return *reinterpret_cast<const ImageHeader*>(base); }
+    const ImageNode& node(uint32_t index) const;
+    const uint32_t* list(uint32_t index) const;
+    std::string_view text(uint32_t offset) const;
+    SharedString name(uint32_t offset) const;
+    std::unique_ptr<Expr> expr(uint32_t index) const;
+    std::unique_ptr<Stmt> stmt(uint32_t index) const;
+    void validate() const;
+};
+
+#endif // SNAPSHOT_H
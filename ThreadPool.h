@@ -0,0 +1,43 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads fed from a FIFO queue.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+    // Queue a task; it runs on some worker thread.
+    void submit(std::function<void()> task);
+
+    // Run task(0) .. task(count - 1) and wait for all of them. The calling
+    // thread takes part, so this is safe to call from a worker.
+    void run(size_t count, const std::function<void(size_t)>& task);
+
+    // Number of tasks queued but not yet started.
+    size_t pending() const;
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> queue;
+    mutable std::mutex mutex;
+    std::condition_variable available;
+    bool stopping = false;
+
+    void workerLoop();
+};
+
+#endif // THREAD_POOL_H
@@ -35,6 +35,9 @@ enum class TokenType {
     RightBrace,
     Semicolon,
     Comma,
+    LeftBracket,
+    RightBracket,
+    Colon,
 
     // Keywords
     Print,
@@ -43,7 +46,10 @@ enum class TokenType {
     While,
     For,         // <--- NEW
     Break,       // <--- NEW (optional)
-    Continue     // <--- NEW (optional)
+    Continue,    // <--- NEW (optional)
+    In,          // the map operator; `in` is tokenized as an identifier
+    Fun,
+    Return
 };
 
 struct Token {
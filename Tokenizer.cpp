@@ -10,10 +10,21 @@ static std::unordered_map<std::string, TokenType> keywords = {
     {"while",    TokenType::While},
     {"for",      TokenType::For},
     {"break",    TokenType::Break},
-    {"continue", TokenType::Continue}
+    {"continue", TokenType::Continue},
+    {"fun",      TokenType::Fun},
+    {"return",   TokenType::Return}
 };
 
-Tokenizer::Tokenizer(const std::string& src) : source(src) {}
+Tokenizer::Tokenizer(const std::string& src, int firstLine) : source(src), line(firstLine) {}
+
+std::vector<Token> Tokenizer::tokenize(const std::string& source, int firstLine) {
+    Tokenizer tokenizer(source, firstLine);
+    std::vector<Token> tokens;
+    while (true) {
+        tokens.push_back(tokenizer.getNextToken());
+        if (tokens.back().type == TokenType::EndOfFile) return tokens;
+    }
+}
 
 char Tokenizer::peek() const {
     if (pos >= source.size()) return '\0';
@@ -135,6 +146,9 @@ Token Tokenizer::getNextToken() {
         case '}': return makeToken(TokenType::RightBrace, "}");
         case ';': return makeToken(TokenType::Semicolon, ";");
         case ',': return makeToken(TokenType::Comma, ",");
+        case '[': return makeToken(TokenType::LeftBracket, "[");
+        case ']': return makeToken(TokenType::RightBracket, "]");
+        case ':': return makeToken(TokenType::Colon, ":");
         case '=':
             if (match('=')) return makeToken(TokenType::DoubleEqual, "==");
             else return makeToken(TokenType::Equal, "=");
@@ -8,9 +8,14 @@
 
 class Tokenizer {
 public:
-    Tokenizer(const std::string& source);
+    // `firstLine` is the line number of the first character of `source`,
+    // for tokenizing a piece of a larger file.
+    Tokenizer(const std::string& source, int firstLine = 1);
     Token getNextToken();
 
+    // Every token of `source`, ending with EndOfFile
+    static std::vector<Token> tokenize(const std::string& source, int firstLine = 1);
+
 private:
     std::string source;
     size_t pos = 0;
@@ -24,7 +29,9 @@ private:
         {"for", TokenType::For},
         {"print", TokenType::Print},
         {"break", TokenType::Break},
-        {"continue", TokenType::Continue}
+        {"continue", TokenType::Continue},
+        {"fun", TokenType::Fun},
+        {"return", TokenType::Return}
     };
 
     // Helpers
@@ -1,7 +1,9 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <cstdio>
 #include <string>
+#include <string_view>
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
@@ -18,4 +20,22 @@ inline std::string read_input(const std::string& filename) {
     return buffer.str();
 }
 
+// Writes the file beside its final name and renames it into place, so that
+// readers and later runs never see a partial file. Throws
+// std::runtime_error if either step fails.
+inline void write_atomically(const std::string& filename, std::string_view data) {
+    std::string temp = filename + ".tmp";
+    std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+    file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    file.close();
+    if (!file) {
+        std::remove(temp.c_str());
+        throw std::runtime_error("Could not write file: " + temp);
+    }
+    if (std::rename(temp.c_str(), filename.c_str()) != 0) {
+        std::remove(temp.c_str());
+        throw std::runtime_error("Could not write file: " + filename);
+    }
+}
+
 #endif // UTILS_H
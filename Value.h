@@ -0,0 +1,44 @@
+#ifndef VALUE_H
+#define VALUE_H
+
+#include "SharedString.h"
+#include <ostream>
+#include <variant>
+
+class Map;
+
+// Shared handle to a map (see Map.h). Maps are mutable and passed by
+// reference: copying a handle shares the map. The count is intrusive so the
+// handle, and therefore a Value, stays one pointer wide. A map that holds
+// itself, directly or through other maps, is never freed.
+class MapRef {
+public:
+    static MapRef create();
+
+    MapRef(const MapRef& other) noexcept : map(other.map) { retain(map); }
+    MapRef(MapRef&& other) noexcept : map(other.map) { other.map = nullptr; }
+    MapRef& operator=(const MapRef& other) noexcept;
+    MapRef& operator=(MapRef&& other) noexcept;
+    ~MapRef() { if (map) release(map); }
+
+    Map& operator*() const { return *map; }
+    Map* operator->() const { return map; }
+    Map* get() const { return map; }
+
+    friend bool operator==(const MapRef& a, const MapRef& b) { return a.map == b.map; }
+    friend bool operator!=(const MapRef& a, const MapRef& b) { return a.map != b.map; }
+
+private:
+    Map* map;
+
+    explicit MapRef(Map* m) : map(m) {}
+    static void retain(Map* m) noexcept;
+    static void release(Map* m) noexcept;
+};
+
+// Prints {key: value, ...} in table order, strings quoted
+std::ostream& operator<<(std::ostream& os, const MapRef& map);
+
+using Value = std::variant<int, float, char, SharedString, MapRef>;
+
+#endif // VALUE_H
@@ -0,0 +1,87 @@
+// Map against std::unordered_map on the same keys: inserts, 4M lookups with
+// about a quarter misses, and removing every other key. Built and run by
+// `bench/run.sh <miniscript> maps`.
+#include "Map.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static void intKeys(size_t n) {
+    std::vector<int> keys(n);
+    for (size_t i = 0; i < n; ++i) keys[i] = static_cast<int>(i * 2654435761u);
+    std::mt19937 rng(1);
+    std::vector<int> probes(1 << 22);
+    for (int& probe : probes) probe = keys[rng() % n] + (rng() % 4 == 0);
+
+    MapRef map = MapRef::create();
+    std::unordered_map<int, Value> table;
+
+    auto start = Clock::now();
+    for (int key : keys) map->set(key, key);
+    double mapInsert = since(start);
+    start = Clock::now();
+    for (int key : keys) table[key] = key;
+    double tableInsert = since(start);
+
+    long mapHits = 0, tableHits = 0;
+    start = Clock::now();
+    for (int probe : probes) mapHits += map->find(probe) != nullptr;
+    double mapFind = since(start);
+    start = Clock::now();
+    for (int probe : probes) tableHits += table.count(probe);
+    double tableFind = since(start);
+
+    start = Clock::now();
+    for (size_t i = 0; i < n; i += 2) map->remove(keys[i]);
+    double mapRemove = since(start);
+    start = Clock::now();
+    for (size_t i = 0; i < n; i += 2) table.erase(keys[i]);
+    double tableRemove = since(start);
+
+    std::printf("  int    n=%-8zu insert %8.2f vs %8.2f   find %8.2f vs %8.2f   remove %7.2f vs %7.2f  (%ld/%ld hits)\n",
+                n, mapInsert, tableInsert, mapFind, tableFind, mapRemove, tableRemove, mapHits, tableHits);
+}
+
+static void stringKeys(size_t n) {
+    std::vector<std::string> names;
+    std::vector<SharedString> keys;
+    for (size_t i = 0; i < n; ++i) {
+        names.push_back("key" + std::to_string(i * 7919));
+        keys.push_back(SharedString(names.back()));
+    }
+    std::mt19937 rng(2);
+    std::vector<size_t> probes(1 << 22);
+    for (size_t& probe : probes) probe = rng() % n;
+
+    MapRef map = MapRef::create();
+    std::unordered_map<std::string, Value> table;
+    for (size_t i = 0; i < n; ++i) {
+        map->set(keys[i], 1);
+        table[names[i]] = 1;
+    }
+
+    long mapHits = 0, tableHits = 0;
+    auto start = Clock::now();
+    for (size_t probe : probes) mapHits += map->find(keys[probe]) != nullptr;
+    double mapFind = since(start);
+    start = Clock::now();
+    for (size_t probe : probes) tableHits += table.count(names[probe]);
+    double tableFind = since(start);
+
+    std::printf("  string n=%-8zu find %8.2f vs %8.2f  (%ld/%ld hits)\n", n, mapFind, tableFind, mapHits, tableHits);
+}
+
+int main() {
+    std::printf("Map vs std::unordered_map, ms\n");
+    for (size_t n : {64u, 4096u, 1u << 20}) intKeys(n);
+    for (size_t n : {64u, 65536u}) stringKeys(n);
+}
@@ -0,0 +1,380 @@
+#!/bin/bash
+# The benchmarks behind the numbers quoted in commit messages. Build with
+# optimization first:
+#
+#     make clean && make CXXFLAGS="-std=c++17 -O2 -pthread" all tests/checker-parity
+#
+# Each timing is the best of $RUNS wall-clock runs (default 5), shown in ms
+# unless the row gives another unit.
+#
+# Usage: bench/run.sh <miniscript> [section...]
+miniscript=$(realpath "$1")
+shift
+here=$(cd "$(dirname "$0")" && pwd)
+RUNS=${RUNS:-5}
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+time_ms() {
+    local best= start ms
+    for ((run = 0; run < RUNS; run++)); do
+        start=$(date +%s%N)
+        "$@" >/dev/null 2>&1 </dev/null
+        ms=$((($(date +%s%N) - start) / 1000000))
+        if [ -z "$best" ] || [ $ms -lt $best ]; then best=$ms; fi
+    done
+    echo $best
+}
+
+# Like time_ms, but only until the command prints its first line
+first_ms() {
+    local best= start ms
+    for ((run = 0; run < RUNS; run++)); do
+        start=$(date +%s%N)
+        {
+            read -r _
+            ms=$((($(date +%s%N) - start) / 1000000))
+            cat >/dev/null
+        } < <("$@" 2>/dev/null </dev/null)
+        if [ -z "$best" ] || [ $ms -lt $best ]; then best=$ms; fi
+    done
+    echo $best
+}
+
+row() {
+    local label=$1
+    shift
+    printf "  %-48s %8s ms\n" "$label" "$(time_ms "$@")"
+}
+
+# --- Shared strings ---
+# A loop of literal assigns, copies, ==/!= and concat, and 5000 variables
+# aliasing one 4 KB literal. There is no portable peak-RSS probe here, so the
+# memory figure is the bytes allocated (--alloc-profile).
+strings() {
+    cat >"$work/loop.ms" <<'SCRIPT'
+for (i = 0; i < 300000; i = i + 1;) {
+  a = "the quick brown fox jumps over the lazy dog";
+  b = "the quick brown fox jumps over the lazy dog";
+  c = a;
+  d = c;
+  if (a == b) e = d;
+  if (c != "something else entirely, not equal") f = a;
+  g = "x" + "y";
+}
+print "done";
+SCRIPT
+    awk 'BEGIN {
+        printf "s = \""
+        for (k = 0; k < 4096; k++) printf "x"
+        print "\";"
+        for (k = 0; k < 5000; k++) printf "v%d = s;\n", k
+        print "print \"ok\";"
+    }' >"$work/alias.ms"
+    row "300K loops of string assigns and compares" "$miniscript" "$work/loop.ms"
+    row "5000 variables aliasing a 4 KB literal" "$miniscript" "$work/alias.ms"
+    local bytes=$("$miniscript" --alloc-profile="$work/folded" "$work/alias.ms" 2>&1 >/dev/null |
+                  awk 'NR == 1 { print $4 }')
+    printf "  %-48s %8s bytes\n" "5000 variables: allocated" "$bytes"
+}
+
+# --- SSA IR and compiled executables ---
+ir() {
+    for script in ir_arith ir_branches; do
+        "$miniscript" --compile -o "$work/$script" "$here/$script.ms" || return 1
+        echo "$script.ms"
+        row "tree walker" "$miniscript" "$here/$script.ms"
+        row "-O0" "$miniscript" -O0 "$here/$script.ms"
+        row "-O" "$miniscript" -O "$here/$script.ms"
+        row "--compile" "$work/$script"
+    done
+}
+
+# --- Deep and long programs ---
+# Throughput of the tree walker, whose parser and evaluator keep explicit
+# stacks, on the ir section's loops and a 400k-statement flat script; then
+# nesting that used to overflow the C++ stack
+deep() {
+    row "ir_arith.ms" "$miniscript" "$here/ir_arith.ms"
+    row "ir_branches.ms" "$miniscript" "$here/ir_branches.ms"
+    awk 'BEGIN {
+        print "v0 = 0;"
+        for (i = 1; i < 400000; i++) {
+            if (i % 100 == 0) print "if (v0 > 5) { print \"x\"; } else { w = 1; }"
+            else printf "v%d = %d * 2 + (3 - %d) / 1;\n", i % 100, i, i % 7
+        }
+    }' >"$work/flat.ms"
+    awk 'BEGIN { printf "x = 1"; for (i = 0; i < 200000; i++) printf " + 1"; print ";" }' >"$work/sum.ms"
+    awk 'BEGIN {
+        printf "x = "; for (i = 0; i < 100000; i++) printf "("; printf "1"; for (i = 0; i < 100000; i++) printf ")"
+        print ";"
+    }' >"$work/parens.ms"
+    awk 'BEGIN {
+        print "x = 1;"
+        for (i = 0; i < 100000; i++) printf "{ "
+        printf "x = 2; "
+        for (i = 0; i < 100000; i++) printf "} "
+        print ""
+    }' >"$work/blocks.ms"
+    row "400k-statement flat script" "$miniscript" "$work/flat.ms"
+    row "200k-term sum" "$miniscript" --max-depth 1000000 "$work/sum.ms"
+    row "100k nested parentheses" "$miniscript" --max-depth 1000000 "$work/parens.ms"
+    row "100k nested blocks" "$miniscript" --max-depth 1000000 "$work/blocks.ms"
+}
+
+# --- Parallel parsing ---
+# A 12.7 MB, 400k-statement file at 1 to 8 --parse-threads. Its last line is
+# a syntax error, so nothing runs and the time is tokenizing and parsing.
+parse() {
+    awk 'BEGIN {
+        for (i = 0; i < 400000; i++) {
+            if (i % 100 == 0) printf "if (v%d > 5) { print \"x\"; } else { w = 1; }\n", i
+            else printf "v%d = %d * 2 + (3 - %d) / 1;\n", i % 100, i, i % 7
+        }
+        print "print ;"
+    }' >"$work/big.ms"
+    local threads
+    for threads in 1 2 4 8; do row "--parse-threads $threads" "$miniscript" --parse-threads $threads "$work/big.ms"; done
+}
+
+# --- Parallel loops ---
+# A 300k-iteration arithmetic reduction, serially and at 1 to 8
+# --parallel-loops threads
+loops() {
+    cat >"$work/reduce.ms" <<'SCRIPT'
+s = 0;
+for (i = 0; i < 300000; i = i + 1;) s = s + ((i * 7 + 3) / 5 - i / 3 * 2 + abs(i - 150000) / 1000);
+print "done";
+SCRIPT
+    row "serial" "$miniscript" "$work/reduce.ms"
+    local threads
+    for threads in 1 2 4 8; do row "--parallel-loops=$threads" "$miniscript" --parallel-loops=$threads "$work/reduce.ms"; done
+}
+
+# --- Incremental runs ---
+# A config-style script with two heavy loops, rerun with --incremental
+# after no change, after changing an input only the second loop reads, and
+# after changing an input only cheap statements read
+incremental() {
+    cat >"$work/config.ms" <<'SCRIPT'
+size = 300000;
+step = 3;
+bias = 5;
+label = "result";
+for (i = 0; i < size; i = i + 1;) t = i * step;
+for (i = 0; i < size; i = i + 1;) u = i + bias;
+message = label + " " + str(size);
+print message;
+SCRIPT
+    sed 's/bias = 5;/bias = 1;/' "$work/config.ms" >"$work/bias.ms"
+    sed 's/label = "result";/label = "total";/' "$work/config.ms" >"$work/label.ms"
+    "$miniscript" --incremental "$work/primed" "$work/config.ms" >/dev/null 2>&1
+    local script
+    row "full run" sh -c "rm -f '$work/cache'; '$miniscript' --incremental '$work/cache' '$work/config.ms'"
+    for script in config bias label; do
+        row "rerun, $script.ms" sh -c "cp '$work/primed' '$work/cache'; '$miniscript' --incremental '$work/cache' '$work/$script.ms'"
+    done
+}
+
+# --- Snapshots ---
+# A prelude with a 2M-iteration loop and 4000 globals: running it before a
+# small main script against restoring its image instead, beside the cost of
+# starting the process at all
+snapshot() {
+    awk 'BEGIN {
+        print "for (i = 0; i < 2000000; i = i + 1;) t = i * 2;"
+        for (k = 0; k < 4000; k++) printf (k % 2 ? "g%d = %d;\n" : "g%d = \"value %d\";\n"), k, k * 7
+    }' >"$work/prelude.ms"
+    echo 'print g3999 + g7;' >"$work/main.ms"
+    cat "$work/prelude.ms" "$work/main.ms" >"$work/whole.ms"
+    echo 'x = 0;' >"$work/empty.ms"
+    "$miniscript" --snapshot "$work/prelude.img" "$work/prelude.ms" || return 1
+    row "prelude and main script" "$miniscript" "$work/whole.ms"
+    row "--restore, main script" "$miniscript" --restore "$work/prelude.img" "$work/main.ms"
+    row "empty script" "$miniscript" "$work/empty.ms"
+    printf "  %-48s %8s KB\n" "image size" $(($(stat -c %s "$work/prelude.img") / 1024))
+}
+
+# --- Daemon ---
+# test_input.ms run 1000 times: a fresh miniscript per run, then through
+# `--serve` over 4 connections by path and with inline source
+serve() {
+    local load=$here/../miniscript-load script=$here/../test_input.ms
+    "$miniscript" --serve "$work/sock" --workers 4 2>/dev/null &
+    local server=$! tries
+    for ((tries = 0; tries < 50; ++tries)); do [ -S "$work/sock" ] && break; sleep 0.1; done
+    local start=$(date +%s%N) run
+    for ((run = 0; run < 1000; run++)); do "$miniscript" "$script" >/dev/null 2>&1; done
+    printf "  %-48s %8s req/s\n" "a process per request" $((1000 * 1000000000 / ($(date +%s%N) - start)))
+    "$load" -n 1000 "$work/sock" "$script" >/dev/null  # fills the cache
+    printf "  %-48s %8s req/s\n" "--serve, by path" \
+           $("$load" -n 20000 "$work/sock" "$script" | awk '$1 == "throughput" { print $2 }')
+    printf "  %-48s %8s req/s\n" "--serve, inline source" \
+           $("$load" -n 20000 --inline "$work/sock" "$script" | awk '$1 == "throughput" { print $2 }')
+    kill $server
+    wait $server
+}
+
+# --- Maps ---
+# An n-way if-else chain against one lookup in an n-entry map, both picking
+# a value by i mod n, beside the same loop with no dispatch at all
+maps() {
+    for n in 8 64; do
+        awk -v n=$n 'BEGIN {
+            print "v = 0;"
+            printf "for (i = 0; i < 300000; i = i + 1;) { j = i - i / %d * %d; v = j; }\n", n, n
+            print "print v;"
+        }' >"$work/none$n.ms"
+        awk -v n=$n 'BEGIN {
+            print "v = 0;"
+            printf "for (i = 0; i < 300000; i = i + 1;) { j = i - i / %d * %d; ", n, n
+            for (k = 0; k < n; k++) printf "%sif (j == %d) v = %d; ", (k ? "else " : ""), k, 3 * k
+            print "}"
+            print "print v;"
+        }' >"$work/chain$n.ms"
+        awk -v n=$n 'BEGIN {
+            printf "t = {"
+            for (k = 0; k < n; k++) printf "%s%d: %d", (k ? ", " : ""), k, 3 * k
+            print "};"
+            print "v = 0;"
+            printf "for (i = 0; i < 300000; i = i + 1;) { j = i - i / %d * %d; v = t[j]; }\n", n, n
+            print "print v;"
+        }' >"$work/map$n.ms"
+        echo "$n cases"
+        row "no dispatch" "$miniscript" "$work/none$n.ms"
+        row "if-else chain" "$miniscript" "$work/chain$n.ms"
+        row "map lookup" "$miniscript" "$work/map$n.ms"
+    done
+    ${CXX:-g++} -std=c++17 -O2 -pthread -I"$here/.." -o "$work/map_table" \
+        "$here/map_table.cpp" "$here/../Map.cpp" "$here/../SharedString.cpp" || return 1
+    "$work/map_table"
+}
+
+# --- Native functions ---
+# max(), pow() and sqrt() in a loop against the same result computed in
+# script (a branch, repeated multiplication, Newton's method)
+natives() {
+    row "loop only" "$miniscript" "$here/native_empty.ms"
+    for fn in max pow sqrt; do
+        row "$fn() native" "$miniscript" "$here/native_$fn.ms"
+        row "$fn() in script" "$miniscript" "$here/native_${fn}_script.ms"
+    done
+}
+
+# --- Script function calls ---
+# Recursive calls, and a million calls of a one-line function against the
+# same loop with the body written out
+calls() {
+    row "fib(25)" "$miniscript" "$here/calls_fib.ms"
+    row "ack(2, 300), ack(3, 6)" "$miniscript" "$here/calls_ack.ms"
+    row "1M calls of id(x)" "$miniscript" "$here/calls_id.ms"
+    row "1M loops, id(x) by hand" "$miniscript" "$here/calls_id_by_hand.ms"
+    row "1M calls of sq(x)" "$miniscript" "$here/calls_square.ms"
+    row "1M loops, sq(x) by hand" "$miniscript" "$here/calls_square_by_hand.ms"
+}
+
+# --- Lazy parsing ---
+# A 7 MB script whose 4000 branch bodies never run: time until its first
+# print, total time, and bytes allocated while parsing (--alloc-profile)
+lazy() {
+    awk 'BEGIN {
+        print "x = 0;"
+        print "print \"ready\";"
+        for (b = 0; b < 4000; b++) {
+            printf "if (x > 0) { "
+            for (k = 0; k < 25; k++) printf "y%d = x + %d * %d; print y%d - %d; ", k, k, b, k, k
+            print "}"
+        }
+        print "print \"done\";"
+    }' >"$work/cold.ms"
+    local mode parsed
+    for mode in eager --lazy; do
+        printf "  %-48s %8s ms\n" "$mode: first statement" "$(first_ms "$miniscript" ${mode#eager} "$work/cold.ms")"
+        row "$mode: whole run" "$miniscript" ${mode#eager} "$work/cold.ms"
+        parsed=$("$miniscript" ${mode#eager} --alloc-profile="$work/folded" "$work/cold.ms" 2>&1 >/dev/null |
+                 awk '$NF == "(parse)" { print $3 }')
+        printf "  %-48s %8s bytes\n" "$mode: allocated while parsing" "$parsed"
+    done
+}
+
+# --- Streaming input ---
+# A 3M-line, 180 MB access log summed and filtered by a script and by awk,
+# in MB/s. The sum reads fields only through fieldint(); the filter copies
+# each matching line with line().
+input() {
+    awk 'BEGIN {
+        for (i = 0; i < 3000000; i++)
+            printf "2026-10-18T%02d:%02d:%02d host%d GET /api/v%d/item %d %d %.4f\n",
+                   i % 24, i % 60, i % 60, i % 8, i % 4, 100 + i * 7919 % 500, i * 104729 % 100000, (i % 40000) / 10000
+    }' >"$work/access.log"
+    cat >"$work/sum.ms" <<'SCRIPT'
+fun main(path) {
+    opened = input(path);
+    statuses = 0;
+    large = 0;
+    while (readline()) {
+        statuses = statuses + fieldint(4);
+        if (fieldint(5) >= 50000) large = large + 1;
+    }
+    print statuses;
+    return large;
+}
+r = main(path);
+print r;
+SCRIPT
+    cat >"$work/filter.ms" <<'SCRIPT'
+fun main(path) {
+    opened = input(path);
+    while (readline()) if (fieldint(4) >= 500) print line();
+    return 0;
+}
+r = main(path);
+SCRIPT
+    local mb=$(($(stat -c %s "$work/access.log") / 1000000))
+    mb_row() {
+        local label=$1
+        shift
+        printf "  %-48s %8s MB/s\n" "$label" $((mb * 1000 / $(time_ms "$@")))
+    }
+    sed -i "1i path = \"$work/access.log\";" "$work/sum.ms" "$work/filter.ms"
+    local sum='{ statuses += $5; if ($6 >= 50000) large++ } END { print statuses; print large }' filter='$5 >= 500'
+    cmp -s <("$miniscript" "$work/sum.ms") <(awk "$sum" "$work/access.log") || { echo "  sum differs from awk"; return 1; }
+    cmp -s <("$miniscript" "$work/filter.ms") <(awk "$filter" "$work/access.log") || { echo "  filter differs from awk"; return 1; }
+    mb_row "sum fields: miniscript" "$miniscript" "$work/sum.ms"
+    mb_row "sum fields: awk" awk "$sum" "$work/access.log"
+    mb_row "filter lines: miniscript" "$miniscript" "$work/filter.ms"
+    mb_row "filter lines: awk" awk "$filter" "$work/access.log"
+}
+
+# --- Fused statement idioms ---
+# Loops dominated by the fused node kinds (see Fuser.h): `v = v + 1`,
+# `if (w > 1000)` and `s = s + "x"`
+fused() {
+    row "5M increments" "$miniscript" "$here/fused_increment.ms"
+    row "3M compares with a constant" "$miniscript" "$here/fused_compare.ms"
+    row "200K string appends" "$miniscript" "$here/fused_append.ms"
+}
+
+# --- Syntax checking ---
+# The Parser and the --check checker in process on 6000 broken scripts
+# (tests/checker-parity), then `miniscript --check` on 3000 files
+check() {
+    local root=$here/..
+    "$root/tests/checker-parity" --bench 6000 "$root"/tests/ir/*.ms "$here"/*.ms || return 1
+    mkdir -p "$work/check"
+    local copy file
+    for ((copy = 0; copy < 100; copy++)); do
+        for file in "$root"/tests/ir/*.ms "$here"/*.ms; do cp "$file" "$work/check/$copy-$(basename "$file")"; done
+    done
+    local files=$(ls "$work/check" | wc -l)
+    printf "  %-48s %8s files/s\n" "--check, $files files" \
+           $((files * 1000 / $(time_ms "$miniscript" --check "$work"/check/*.ms)))
+}
+
+sections=("$@")
+[ ${#sections[@]} = 0 ] && sections=(strings ir deep parse loops incremental snapshot serve maps natives calls lazy input fused check)
+for section in "${sections[@]}"; do
+    echo "== $section"
+    $section || exit 1
+done
@@ -3,50 +3,356 @@
 #include <sstream>
 #include <vector>
 #include <memory>
+#include <algorithm>
+#include <charconv>
+#include <thread>
 
 #include "Tokenizer.h"
 #include "Parser.h"
+#include "Checker.h"
+#include "ParallelParser.h"
+#include "AllocProfiler.h"
 #include "Interpreter.h"
+#include "InputReader.h"
+#include "Inliner.h"
+#include "Fuser.h"
+#include "IRBuilder.h"
+#include "IROptimizer.h"
+#include "IRInterpreter.h"
+#include "CppEmitter.h"
+#include "Server.h"
+#include "Snapshot.h"
+
+static void usage() {
+    std::cerr << "Usage: miniscript [options] <source-file>\n"
+              << "       miniscript --check [--workers <n>] <source-file>...\n"
+              << "       miniscript --serve <socket> [--workers <n>] [--cache-size <n>]\n"
+              << "  -O          run through the optimized SSA IR\n"
+              << "  -O0         run through the SSA IR without optimization\n"
+              << "  --dump-ir   print the SSA IR (optimized unless -O0) and exit\n"
+              << "  --emit-cpp <file>   write the program as standalone C++ and exit\n"
+              << "  --compile [-o <file>]   compile the program to a native executable\n"
+              << "  --parse-threads <n>     tokenize and parse on n threads (0 = all cores)\n"
+              << "  --parallel-loops[=<n>]  run independent for-loop iterations on n threads\n"
+              << "  --incremental <cache>   reuse results of statements whose inputs did not change\n"
+              << "  --snapshot <image>      after running, save globals and program to an image\n"
+              << "  --restore <image>       start from the globals saved in an image\n"
+              << "  --max-depth <n>         reject programs nested more than n levels deep\n"
+              << "  --lazy                  parse if/else/loop bodies when they first run\n"
+              << "  --no-inline             keep calls to small functions (to compare with inlining)\n"
+              << "  --no-fuse               keep the plain nodes of common idioms (to compare with fusion)\n"
+              << "  --alloc-profile[=<file>]  report heap allocations by script line and node kind,\n"
+              << "                          and write folded stacks to <file> (default alloc.folded)\n"
+              << "  --check                 report every syntax error in the files as file:line: message\n"
+              << "  --serve <socket>        run as a daemon taking scripts over a Unix socket\n"
+              << "  --workers <n>           threads checking files or, for --serve, running scripts\n"
+              << "                          (0 = all cores)\n"
+              << "  --cache-size <n>        compiled programs kept by --serve (default 128)" << std::endl;
+}
+
+// Thread counts above this are refused rather than attempted
+static constexpr size_t maxThreads = 1024;
+
+// A whole non-negative decimal number, as the numeric options take
+static bool parseCount(const std::string& text, size_t& value) {
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    return error == std::errc() && end == text.data() + text.size();
+}
 
 int main(int argc, char* argv[]) {
-    if (argc < 2) {
-        std::cerr << "Usage: miniscript <source-file>" << std::endl;
+    bool useIR = false;
+    bool optimize = true;
+    bool dumpIR = false;
+    bool compile = false;
+    std::string emitPath;
+    std::string outputPath = "a.out";
+    unsigned parseThreads = 1;
+    bool lazy = false;
+    bool inlineCalls = true;
+    bool fuseIdioms = true;
+    bool check = false;
+    std::string allocProfilePath;
+    unsigned loopThreads = 0;
+    std::string cachePath;
+    std::string snapshotPath;
+    std::string restorePath;
+    size_t maxDepth = Parser::defaultMaxDepth;
+    Server::Options serve;
+    serve.workers = 0;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-O") {
+            useIR = true;
+        } else if (arg == "-O0") {
+            useIR = true;
+            optimize = false;
+        } else if (arg == "--dump-ir") {
+            dumpIR = true;
+        } else if (arg == "--emit-cpp" && i + 1 < argc) {
+            emitPath = argv[++i];
+        } else if (arg == "--compile") {
+            compile = true;
+        } else if (arg == "-o" && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else if (arg == "--parallel-loops" || arg.rfind("--parallel-loops=", 0) == 0) {
+            loopThreads = std::max(1u, std::thread::hardware_concurrency());
+            size_t count;
+            if (arg.size() > 16 && (!parseCount(arg.substr(17), count) || count == 0 || count > maxThreads)) {
+                std::cerr << "--parallel-loops takes 1 to " << maxThreads << " threads, got '" << arg.substr(17)
+                          << "'" << std::endl;
+                usage();
+                return 1;
+            }
+            if (arg.size() > 16) loopThreads = static_cast<unsigned>(count);
+        } else if (arg == "--incremental" && i + 1 < argc) {
+            cachePath = argv[++i];
+        } else if (arg == "--snapshot" && i + 1 < argc) {
+            snapshotPath = argv[++i];
+        } else if (arg == "--restore" && i + 1 < argc) {
+            restorePath = argv[++i];
+        } else if (arg == "--alloc-profile" || arg.rfind("--alloc-profile=", 0) == 0) {
+            allocProfilePath = arg.size() > 16 ? arg.substr(16) : "alloc.folded";
+        } else if (arg == "--check") {
+            check = true;
+        } else if (arg == "--lazy") {
+            lazy = true;
+        } else if (arg == "--no-inline") {
+            inlineCalls = false;
+        } else if (arg == "--no-fuse") {
+            fuseIdioms = false;
+        } else if (arg == "--max-depth" && i + 1 < argc) {
+            if (!parseCount(argv[++i], maxDepth) || maxDepth == 0) {
+                std::cerr << "--max-depth takes a positive number of levels, got '" << argv[i] << "'" << std::endl;
+                usage();
+                return 1;
+            }
+        } else if (arg == "--serve" && i + 1 < argc) {
+            serve.socketPath = argv[++i];
+        } else if (arg == "--workers" && i + 1 < argc) {
+            size_t count;
+            if (!parseCount(argv[++i], count) || count > maxThreads) {
+                std::cerr << "--workers takes 0 to " << maxThreads << " threads, got '" << argv[i] << "'" << std::endl;
+                usage();
+                return 1;
+            }
+            serve.workers = static_cast<unsigned>(count);
+        } else if (arg == "--cache-size" && i + 1 < argc) {
+            if (!parseCount(argv[++i], serve.cacheCapacity) || serve.cacheCapacity == 0) {
+                std::cerr << "--cache-size takes a positive number of programs, got '" << argv[i] << "'" << std::endl;
+                usage();
+                return 1;
+            }
+        } else if (arg == "--parse-threads" && i + 1 < argc) {
+            size_t count;
+            if (!parseCount(argv[++i], count) || count > maxThreads) {
+                std::cerr << "--parse-threads takes 0 to " << maxThreads << " threads, got '" << argv[i] << "'"
+                          << std::endl;
+                usage();
+                return 1;
+            }
+            parseThreads = static_cast<unsigned>(count);
+            if (parseThreads == 0) parseThreads = std::max(1u, std::thread::hardware_concurrency());
+        } else if (arg.size() > 1 && arg[0] == '-') {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            usage();
+            return 1;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (serve.workers == 0) serve.workers = std::max(1u, std::thread::hardware_concurrency());
+
+    if (check) {
+        if (paths.empty() || !serve.socketPath.empty()) {
+            usage();
+            return 1;
+        }
+        size_t failed = 0, errors = 0;
+        for (const auto& report : Checker::checkFiles(paths, serve.workers, maxDepth)) {
+            for (const Diagnostic& diagnostic : report.diagnostics) {
+                if (diagnostic.line > 0) {
+                    std::cout << report.path << ':' << diagnostic.line << ": Error at '" << diagnostic.token
+                              << "': " << diagnostic.message << '\n';
+                } else {
+                    std::cout << report.path << ": " << diagnostic.message << '\n';
+                }
+            }
+            if (!report.diagnostics.empty()) ++failed;
+            errors += report.diagnostics.size();
+        }
+        std::cout << std::flush;
+        std::cerr << "[check] " << paths.size() << " files, " << failed << " with errors, " << errors << " errors"
+                  << std::endl;
+        return failed ? 1 : 0;
+    }
+    if (paths.size() > 1) {
+        std::cerr << "Only --check takes more than one source file" << std::endl;
         return 1;
     }
+    const char* path = paths.empty() ? nullptr : paths[0].c_str();
+
+    if (!serve.socketPath.empty()) {
+        if (path) {
+            std::cerr << "--serve takes scripts over the socket, not on the command line" << std::endl;
+            return 1;
+        }
+        serve.maxDepth = maxDepth;
+        try {
+            Server(serve).run();
+        } catch (const std::runtime_error& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (!path) {
+        usage();
+        return 1;
+    }
+    if (lazy && parseThreads > 1) {
+        std::cerr << "--lazy and --parse-threads cannot be combined" << std::endl;
+        return 1;
+    }
+    if ((!snapshotPath.empty() || !restorePath.empty()) && (useIR || dumpIR || compile || !emitPath.empty())) {
+        std::cerr << "--snapshot and --restore need the tree-walking interpreter" << std::endl;
+        return 1;
+    }
+    if (!allocProfilePath.empty() && (useIR || dumpIR || compile || !emitPath.empty())) {
+        std::cerr << "--alloc-profile needs the tree-walking interpreter" << std::endl;
+        return 1;
+    }
+    AllocProfiler::Session allocProfile(allocProfilePath, std::cerr);
+    AllocProfiler::atPhase("(parse)");
 
     // Read entire source file into a string
-    std::ifstream file(argv[1]);
+    std::ifstream file(path);
     if (!file) {
-        std::cerr << "Could not open file: " << argv[1] << std::endl;
+        std::cerr << "Could not open file: " << path << std::endl;
         return 1;
     }
     std::stringstream buffer;
     buffer << file.rdbuf();
     std::string source = buffer.str();
 
-    // Tokenize
-    Tokenizer tokenizer(source);
-    std::vector<Token> tokens;
-    while (true) {
-        Token token = tokenizer.getNextToken();
-        tokens.push_back(token);
-        if (token.type == TokenType::EndOfFile) break;
-    }
-
-    // Parse
-    Parser parser(tokens);
+    // Tokenize and parse
     std::vector<std::unique_ptr<Stmt>> statements;
     try {
-        statements = parser.parse();
+        if (parseThreads > 1) {
+            statements = ParallelParser(source, parseThreads, maxDepth).parse();
+        } else {
+            auto tokens = std::make_shared<std::vector<Token>>(Tokenizer::tokenize(source));
+
+            // Deferred bodies keep the tokens alive
+            if (lazy) statements = Parser::parseLazily(std::move(tokens), true, maxDepth, fuseIdioms);
+            else statements = Parser(*tokens, true, maxDepth).parse();
+        }
     } catch (const std::runtime_error& e) {
         std::cerr << "Parse error: " << e.what() << std::endl;
         return 1;
     }
+    if (inlineCalls) Inliner().run(statements);
+    if (fuseIdioms) Fuser().run(statements);
+
+    // Lower to SSA and optimize
+    if (useIR || dumpIR || compile || !emitPath.empty()) {
+        IRProgram program;
+        try {
+            program = IRBuilder().build(statements);
+            if (optimize) IROptimizer().run(program);
+        } catch (const ParseError& e) {
+            std::cerr << "Parse error: " << e.what() << std::endl;
+            return 1;
+        } catch (const std::runtime_error& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+
+        if (dumpIR) {
+            program.dump(std::cout);
+            return 0;
+        }
+
+        if (compile || !emitPath.empty()) {
+            std::ostringstream generated;
+            CppEmitter().emit(program, generated);
+
+            if (!emitPath.empty()) {
+                std::ofstream out(emitPath);
+                if (!out) {
+                    std::cerr << "Could not write file: " << emitPath << std::endl;
+                    return 1;
+                }
+                out << generated.str();
+            }
+
+            std::string error;
+            if (compile && !CppEmitter::compile(generated.str(), outputPath, error)) {
+                std::cerr << error << std::endl;
+                return 1;
+            }
+            return 0;
+        }
+
+        IRInterpreter().run(program);
+        return 0;
+    }
 
     // Interpret
+    AllocProfiler::atPhase("(run)");
     try {
         Interpreter interpreter;
-        interpreter.interpret(statements);
+        InputReader::install(interpreter.natives(), std::make_shared<InputReader>());
+        if (loopThreads > 0) interpreter.enableParallelLoops(loopThreads);
+
+        // The restored program's functions stay callable, and a new image carries it along
+        std::vector<std::unique_ptr<Stmt>> prelude;
+        if (!restorePath.empty()) {
+            try {
+                Snapshot image(restorePath);
+                image.restore(interpreter.environment());
+                prelude = image.program();
+                if (fuseIdioms) Fuser().run(prelude);
+                interpreter.defineFunctions(prelude);
+            } catch (const std::runtime_error& e) {
+                std::cerr << "Could not restore " << restorePath << ": " << e.what() << std::endl;
+                return 1;
+            }
+        }
+
+        bool ok;
+        if (!cachePath.empty()) {
+            ExecutionCache cache;
+            cache.load(cachePath);
+            ok = interpreter.interpret(statements, cache);
+            if (!cache.save(cachePath)) std::cerr << "Could not write file: " << cachePath << std::endl;
+            std::cerr << "[incremental] " << cache.reused() << " statements reused, " << cache.executed() << " run"
+                      << std::endl;
+        } else {
+            ok = interpreter.interpret(statements);
+        }
+
+        if (!snapshotPath.empty()) {
+            if (!ok) {
+                std::cerr << "Snapshot not written: the script did not finish" << std::endl;
+                return 1;
+            }
+            std::vector<const Stmt*> program;
+            for (const auto& stmt : prelude) program.push_back(stmt.get());
+            for (const auto& stmt : statements) program.push_back(stmt.get());
+            try {
+                Snapshot::write(snapshotPath, interpreter.environment(), program);
+            } catch (const std::runtime_error& e) {
+                std::cerr << "Could not write snapshot " << snapshotPath << ": " << e.what() << std::endl;
+                return 1;
+            }
+        }
+    } catch (const ParseError& e) {
+        // In a body deferred by --lazy
+        std::cerr << "Parse error: " << e.what() << std::endl;
+        return 1;
     } catch (const std::runtime_error& e) {
         std::cerr << "Runtime error: " << e.what() << std::endl;
         return 1;
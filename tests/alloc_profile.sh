@@ -0,0 +1,103 @@
+#!/bin/bash
+# --alloc-profile: the script's own output is unchanged, the report has a
+# summary line, a header and at most 20 site rows covering the (parse) and
+# (run) phases, script lines and the node kinds below them, and the folded
+# stacks account for every byte of the summary.
+#
+# Usage: tests/alloc_profile.sh <miniscript>
+miniscript=$(realpath "$1")
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+failed=0
+
+fail() {
+    echo "FAIL $*"
+    failed=$((failed + 1))
+}
+
+cat >"$work/script.ms" <<'SCRIPT'
+fun build(n) {
+    s = "";
+    for (i = 0; i < n; i = i + 1;) s = s + "x";
+    return s;
+}
+m = {"a": 1, "b": 2};
+r = build(40);
+print len(r);
+t = str(12345) + "!";
+print t;
+SCRIPT
+
+# profile <script> <folded file>: the report goes to $work/report
+profile() {
+    "$miniscript" --alloc-profile="$2" "$1" 2>"$work/report"
+}
+
+got=$(profile "$work/script.ms" "$work/folded")
+status=$?
+[ $status = 0 ] || fail "exit status $status"
+[ "$got" = "$("$miniscript" "$work/script.ms" 2>&1)" ] || fail "output differs from a run without the profiler: '$got'"
+
+# Summary, then the header, then rows of allocs, bytes, short-lived share and site
+summary='^\[alloc-profile\] ([0-9]+) allocations, ([0-9]+) bytes, [0-9]+% short-lived$'
+[[ "$(sed -n 1p "$work/report")" =~ $summary ]] || fail "summary line: '$(sed -n 1p "$work/report")'"
+allocations=${BASH_REMATCH[1]}
+bytes=${BASH_REMATCH[2]}
+[ "$(sed -n 2p "$work/report")" = "[alloc-profile]     allocs       bytes  short  site" ] \
+    || fail "header: '$(sed -n 2p "$work/report")'"
+rows=$(tail -n +3 "$work/report")
+bad=$(grep -Ev '^\[alloc-profile\] +[0-9]+ +[0-9]+ +[0-9]+%  [^ ].*$' <<<"$rows")
+[ -z "$bad" ] || fail "malformed rows: '$bad'"
+
+# site <pattern>: some row's site matches the extended regex
+site() {
+    sed -E 's/^\[alloc-profile\] +[0-9]+ +[0-9]+ +[0-9]+%  //' <<<"$rows" | grep -Eq "^($1)$" || fail "no row for '$1'"
+}
+site '\(parse\)'
+site '\(run\)'
+site 'line 1 Function'
+site 'line 6 Assign'
+site 'line 6 Assign, Map'
+site 'line 9 Assign, Call'
+site 'line 3 Append \(in build\)'
+
+# Rows are sorted by bytes, and none claims more than the total
+cmp -s <(sort -k3,3nr -s <<<"$rows") <(echo "$rows") || fail "rows are not sorted by bytes"
+[ "$(awk '{ n += $3 } END { print n }' <<<"$rows")" -le $bytes ] || fail "rows add up to more than the total"
+
+# Folded stacks: "main;frame;... bytes", with every byte of the summary
+if [ ! -s "$work/folded" ]; then
+    fail "no folded stacks written"
+else
+    bad=$(grep -Ev '^main(;[^;]+)+ [1-9][0-9]*$' "$work/folded")
+    [ -z "$bad" ] || fail "malformed folded stacks: '$bad'"
+    [ "$(awk '{ n += $NF } END { print n }' "$work/folded")" = "$bytes" ] \
+        || fail "folded stacks do not add up to $bytes bytes"
+    grep -q '^main;(parse) ' "$work/folded" || fail "no (parse) stack"
+    grep -q '^main;(run) ' "$work/folded" || fail "no (run) stack"
+    grep -q '^main;line 6 Assign;Map ' "$work/folded" || fail "no stack for the map literal"
+    grep -q '^main;build;line 3 Append ' "$work/folded" || fail "no stack inside build()"
+    [ "$(sed 's/ [0-9]*$//' "$work/folded" | sort | uniq -d)" = "" ] || fail "a stack appears twice"
+fi
+[ $allocations -gt 0 ] || fail "no allocations counted"
+
+# More sites than the report shows: 20 rows, while the stacks keep them all
+for ((k = 0; k < 40; k++)); do echo "v$k = \"value\" + str($k);"; done >"$work/wide.ms"
+profile "$work/wide.ms" "$work/wide.folded"
+[ "$(wc -l <"$work/report")" = 22 ] || fail "wide script: $(wc -l <"$work/report") report lines, expected 22"
+[ "$(wc -l <"$work/wide.folded")" -gt 40 ] || fail "wide script: only $(wc -l <"$work/wide.folded") stacks"
+
+# Without a file name the stacks go to alloc.folded in the working directory
+(cd "$work" && "$miniscript" --alloc-profile script.ms >/dev/null 2>&1)
+[ -s "$work/alloc.folded" ] || fail "no default alloc.folded"
+
+got=$(profile "$work/script.ms" "$work/missing/folded")
+grep -q "^Could not write file: $work/missing/folded$" "$work/report" || fail "unwritable file not reported"
+
+"$miniscript" -O --alloc-profile "$work/script.ms" >/dev/null 2>&1
+[ $? = 1 ] || fail "-O with --alloc-profile should be refused"
+
+[ $failed = 0 ] && echo "alloc-profile OK"
+[ $failed = 0 ]
@@ -0,0 +1,224 @@
+// The --check syntax checker must report the same first error as the Parser
+// on every program. This breaks the given scripts at random, dropping,
+// inserting or replacing tokens, and compares the two on each mutant. With
+// --bench it times both over the same mutants instead. With --parallel it
+// compares the 3-thread ParallelParser with the Parser, on the scripts
+// themselves and on the mutants.
+//
+// Usage: tests/checker-parity [--bench | --parallel] <mutants> <source-file>...
+#include "Checker.h"
+#include "ParallelParser.h"
+#include "Parser.h"
+#include "Tokenizer.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char* const vocabulary[] = {"{", "}", "(", ")", "[", "]", ";", ",", ":", "=", "==", "+", "-", "*",
+                                  "if", "else", "while", "for", "fun", "return", "print", "break", "remove",
+                                  "in", "x", "m", "3", "\"s\"", "99999999999", "1.5", "f(", "@"};
+
+// Source text split into the pieces a mutation moves: numbers, two-character
+// operators, string and char literals, words, line breaks and single
+// characters
+std::vector<std::string> pieces(const std::string& source) {
+    std::vector<std::string> result;
+    size_t i = 0;
+    while (i < source.size()) {
+        char c = source[i];
+        size_t start = i;
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            if (c == '\n') result.push_back("\n");  // kept, so errors keep their lines
+            ++i;
+            continue;
+        }
+        if (std::isalnum(static_cast<unsigned char>(c)) || c == '_') {
+            while (i < source.size() && (std::isalnum(static_cast<unsigned char>(source[i])) || source[i] == '_' ||
+                                         (source[i] == '.' && std::isdigit(static_cast<unsigned char>(c)))))
+                ++i;
+        } else if (c == '"' || c == '\'') {
+            i = source.find(c, i + 1);
+            i = i == std::string::npos ? source.size() : i + 1;
+        } else if (i + 1 < source.size() && source[i + 1] == '=' && (c == '=' || c == '!' || c == '<' || c == '>')) {
+            i += 2;
+        } else {
+            ++i;
+        }
+        result.push_back(source.substr(start, i - start));
+    }
+    return result;
+}
+
+std::vector<std::string> mutants(const std::vector<std::string>& sources, size_t count) {
+    std::mt19937 rng(1);
+    auto below = [&](size_t n) { return static_cast<size_t>(rng() % n); };
+    const size_t words = sizeof(vocabulary) / sizeof(vocabulary[0]);
+
+    std::vector<std::vector<std::string>> split;
+    for (const std::string& source : sources) split.push_back(pieces(source));
+
+    std::vector<std::string> result;
+    for (size_t n = 0; n < count; ++n) {
+        std::vector<std::string> parts = split[below(split.size())];
+        for (size_t edits = 1 + below(4); edits > 0; --edits) {
+            size_t at = below(parts.size() + 1);
+            size_t kind = below(3);
+            if (kind == 0 && !parts.empty()) {
+                parts.erase(parts.begin() + std::min(at, parts.size() - 1));
+            } else if (kind == 1 || parts.empty()) {
+                parts.insert(parts.begin() + at, vocabulary[below(words)]);
+            } else {
+                parts[std::min(at, parts.size() - 1)] = vocabulary[below(words)];
+            }
+        }
+        std::string text;
+        for (const std::string& part : parts) text += part + ' ';
+        result.push_back(text);
+    }
+    return result;
+}
+
+// The first error as "[Line N] Error at 'tok': message", or "" if none. The
+// Parser reports an integer literal out of range as std::out_of_range.
+std::string parserError(const std::vector<Token>& tokens) {
+    try {
+        Parser(tokens, false).parse();
+        return "";
+    } catch (const ParseError& e) {
+        return e.diagnostic;
+    } catch (const std::out_of_range&) {
+        return "literal out of range";
+    }
+}
+
+std::string checkerError(const std::vector<Token>& tokens) {
+    std::vector<Diagnostic> diagnostics = Checker(tokens, Parser::defaultMaxDepth).check();
+    if (diagnostics.empty()) return "";
+    const Diagnostic& first = diagnostics.front();
+    if (first.message.find("literal out of range") != std::string::npos) return "literal out of range";
+    return "[Line " + std::to_string(first.line) + "] Error at '" + first.token + "': " + first.message;
+}
+
+// Like parserError, with the statement count on success. ParallelParser
+// prints the diagnostic itself, so stderr is muted while it runs.
+std::string parallelError(const std::string& source) {
+    std::streambuf* saved = std::cerr.rdbuf(nullptr);
+    std::string result;
+    try {
+        result = std::to_string(ParallelParser(source, 3, Parser::defaultMaxDepth).parse().size()) + " statements";
+    } catch (const ParseError& e) {
+        result = e.diagnostic;
+    } catch (const std::out_of_range&) {
+        result = "literal out of range";
+    }
+    std::cerr.rdbuf(saved);
+    return result;
+}
+
+std::string sequentialError(const std::string& source) {
+    std::vector<Token> tokens = Tokenizer::tokenize(source);
+    try {
+        return std::to_string(Parser(tokens, false).parse().size()) + " statements";
+    } catch (const ParseError& e) {
+        return e.diagnostic;
+    } catch (const std::out_of_range&) {
+        return "literal out of range";
+    }
+}
+
+int compareParallel(const std::vector<std::string>& programs) {
+    size_t errors = 0, mismatches = 0;
+    for (const std::string& program : programs) {
+        std::string expected = sequentialError(program);
+        std::string got = parallelError(program);
+        if (expected.find(" statements") == std::string::npos) ++errors;
+        if (got == expected) continue;
+        if (++mismatches <= 5) {
+            std::cout << "MISMATCH\n  " << program << "\n  parser:   " << expected << "\n  parallel: " << got
+                      << '\n';
+        }
+    }
+    std::cout << programs.size() << " programs, " << errors << " with errors, " << mismatches
+              << " parallel mismatches\n";
+    return mismatches == 0 ? 0 : 1;
+}
+
+int compare(const std::vector<std::string>& programs) {
+    size_t errors = 0, mismatches = 0;
+    for (const std::string& program : programs) {
+        std::vector<Token> tokens = Tokenizer::tokenize(program);
+        std::string expected = parserError(tokens);
+        std::string got = checkerError(tokens);
+        if (!expected.empty()) ++errors;
+        if (got == expected) continue;
+        if (++mismatches <= 5) {
+            std::cout << "MISMATCH\n  " << program << "\n  parser:  " << expected << "\n  checker: " << got
+                      << '\n';
+        }
+    }
+    std::cout << programs.size() << " mutants, " << errors << " with errors, " << mismatches << " mismatches\n";
+    return mismatches == 0 ? 0 : 1;
+}
+
+int bench(const std::vector<std::string>& programs) {
+    std::vector<std::vector<Token>> tokenized;
+    for (const std::string& program : programs) tokenized.push_back(Tokenizer::tokenize(program));
+
+    const int passes = 10;
+    for (const char* which : {"Parser", "Checker"}) {
+        bool parser = which[0] == 'P';
+        size_t failed = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int pass = 0; pass < passes; ++pass) {
+            for (const auto& tokens : tokenized)
+                failed += parser ? !parserError(tokens).empty() : !checkerError(tokens).empty();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "  " << which << ": " << static_cast<long>(programs.size() * passes / seconds)
+                  << " files/s (" << failed / passes << " with errors)\n";
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int first = 1;
+    std::string mode = argc > 1 ? argv[1] : "";
+    bool timing = mode == "--bench", parallel = mode == "--parallel";
+    if (timing || parallel) ++first;
+    if (argc - first < 2 || std::atoi(argv[first]) <= 0) {
+        std::cerr << "Usage: tests/checker-parity [--bench | --parallel] <mutants> <source-file>..." << std::endl;
+        return 1;
+    }
+    size_t count = static_cast<size_t>(std::atoi(argv[first]));
+
+    std::vector<std::string> sources;
+    for (int i = first + 1; i < argc; ++i) {
+        std::ifstream file(argv[i]);
+        if (!file) {
+            std::cerr << "Could not open file: " << argv[i] << std::endl;
+            return 1;
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        sources.push_back(buffer.str());
+    }
+
+    std::vector<std::string> programs = mutants(sources, count);
+    if (parallel) {
+        programs.insert(programs.begin(), sources.begin(), sources.end());
+        return compareParallel(programs);
+    }
+    return timing ? bench(programs) : compare(programs);
+}
@@ -0,0 +1,57 @@
+#!/bin/bash
+# Runs every script in a corpus directory in each of the given modes and
+# compares its output, errors included, and exit status with the .out file
+# next to it. A mode is miniscript options such as -O or "--parse-threads 3",
+# "tree" for the tree walker, or "compiled" to build the script with
+# --compile and run the binary. The [parallel-loops] report lines of a .out
+# file are only expected in modes that include --parallel-loops.
+#
+# Usage: tests/compare.sh <miniscript> <dir> <mode>...
+miniscript=$1
+dir=$2
+shift 2
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+run() {
+    local mode=$1 script=$2
+    case $mode in
+        tree) "$miniscript" "$script" 2>&1 ;;
+        compiled)
+            # A script that does not build shows miniscript's report instead
+            "$miniscript" --compile -o "$work/prog" "$script" >"$work/build" 2>&1
+            local status=$?
+            if [ $status != 0 ]; then
+                cat "$work/build"
+                echo "exit $status"
+                return
+            fi
+            "$work/prog" 2>&1 ;;
+        *) "$miniscript" $mode "$script" 2>&1 ;;
+    esac
+    echo "exit $?"
+}
+
+expected() {
+    local mode=$1 file=$2
+    case $mode in
+        *--parallel-loops*) cat "$file" ;;
+        *) grep -v '^\[parallel-loops\]' "$file" ;;
+    esac
+}
+
+failed=0
+total=0
+for script in "$dir"/*.ms; do
+    for mode in "$@"; do
+        total=$((total + 1))
+        if ! run "$mode" "$script" | diff -u <(expected "$mode" "${script%.ms}.out") - >"$work/diff"; then
+            echo "FAIL $script ($mode)"
+            head -20 "$work/diff"
+            failed=$((failed + 1))
+        fi
+    done
+done
+echo "$((total - failed)) of $total runs match"
+[ $failed = 0 ]
@@ -0,0 +1,75 @@
+#!/bin/bash
+# --incremental must print what a run without the cache prints, whether a
+# statement's result is reused from the cache or run again because it, or
+# one of its inputs, changed.
+#
+# Usage: tests/incremental.sh <miniscript>
+miniscript=$1
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+failed=0
+
+fail() {
+    echo "FAIL $*"
+    failed=$((failed + 1))
+}
+
+# run <name> <script> <expected "[incremental]" line>: stdout against a run
+# without the cache, then the reuse report
+run() {
+    local name=$1 script=$2 expected=$3
+    "$miniscript" "$script" >"$work/cold" 2>&1
+    "$miniscript" --incremental "$work/cache" "$script" >"$work/warm" 2>"$work/report"
+    grep -v '^\[incremental\]' "$work/report" >>"$work/warm"
+    cmp -s "$work/cold" "$work/warm" || fail "$name: output differs from a run without the cache"
+    local report=$(grep '^\[incremental\]' "$work/report")
+    [ "$report" = "$expected" ] || fail "$name: got '$report', expected '$expected'"
+}
+
+cat >"$work/v1.ms" <<'SCRIPT'
+fun square(x) {
+    return x * x;
+}
+fun twice(x) {
+    t = x + x;
+    return t;
+}
+base = 3;
+scale = 7;
+x = base * 100;
+y = square(scale);
+print x;
+print y;
+z = x + y;
+print z;
+message = "total " + str(z);
+print message;
+w = twice(base);
+print w;
+SCRIPT
+sed 's/scale = 7;/scale = 8;/' "$work/v1.ms" >"$work/v2.ms"
+sed 's/return x \* x;/return x * x * x;/' "$work/v2.ms" >"$work/v3.ms"
+
+# Calls of twice() are not recorded, so w always runs; `print w` is reused
+# while w keeps its value
+run cold "$work/v1.ms" "[incremental] 0 statements reused, 12 run"
+run warm "$work/v1.ms" "[incremental] 11 statements reused, 1 run"
+# base, x, `print x` and `print w` do not depend on scale
+run edited "$work/v2.ms" "[incremental] 4 statements reused, 8 run"
+run "edited, warm" "$work/v2.ms" "[incremental] 11 statements reused, 1 run"
+
+# The Inliner copies square()'s body into y's statement, so editing the
+# body changes that statement and everything downstream of y runs again
+run "edited function" "$work/v3.ms" "[incremental] 5 statements reused, 7 run"
+
+# A damaged cache is an empty one
+head -c 40 "$work/cache" >"$work/torn" && mv "$work/torn" "$work/cache"
+run "torn cache" "$work/v3.ms" "[incremental] 0 statements reused, 12 run"
+printf 'not a cache' >"$work/cache"
+run "foreign cache" "$work/v3.ms" "[incremental] 0 statements reused, 12 run"
+[ -e "$work/cache.tmp" ] && fail "the cache's temporary file was left behind"
+
+[ $failed = 0 ] && echo "incremental OK"
+[ $failed = 0 ]
@@ -0,0 +1,151 @@
+#!/bin/bash
+# The input builtins must read the same lines and fields whether the input
+# is a mapped file (input(), or stdin redirected from a file) or a pipe read
+# in blocks, with a last line that has no '\n', an empty input and custom
+# separators; fieldint() and fieldfloat() must refuse bad fields.
+#
+# Usage: tests/input.sh <miniscript>
+miniscript=$1
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+failed=0
+
+fail() {
+    echo "FAIL $*"
+    failed=$((failed + 1))
+}
+
+# check <name> <expected output> <command>...: output and errors
+check() {
+    local name=$1 expected=$2
+    shift 2
+    local got
+    got=$("$@" 2>&1)
+    [ "$got" = "$expected" ] || fail "$name: got '$got', expected '$expected'"
+}
+
+# Prints every line with its field count, then its fields
+cat >"$work/dump.ms" <<'SCRIPT'
+fun dump(n) {
+    count = 0;
+    while (readline()) count = count + show(fields());
+    return count;
+}
+fun show(n) {
+    print str(n) + " [" + line() + "]";
+    for (i = 0; i < n; i = i + 1;) print "  <" + field(i) + ">";
+    return 1;
+}
+lines = dump(0);
+print str(lines) + " lines";
+SCRIPT
+sed '1i r = input(path);' "$work/dump.ms" >"$work/dump_file.ms"
+
+printf 'alpha beta\n\n  one\t two   three \nlast line' >"$work/data"
+expected='2 [alpha beta]
+  <alpha>
+  <beta>
+0 []
+3 [  one	 two   three ]
+  <one>
+  <two>
+  <three>
+2 [last line]
+  <last>
+  <line>
+4 lines'
+check "stdin from a file" "$expected" "$miniscript" "$work/dump.ms" <"$work/data"
+check "pipe" "$expected" sh -c 'cat "$1" | "$2" "$3"' - "$work/data" "$miniscript" "$work/dump.ms"
+sed "1i path = \"$work/data\";" "$work/dump_file.ms" >"$work/dump_data.ms"
+check "input()" "$expected" "$miniscript" "$work/dump_data.ms" </dev/null
+
+printf '' >"$work/empty"
+check "empty file" "0 lines" "$miniscript" "$work/dump.ms" <"$work/empty"
+check "empty pipe" "0 lines" sh -c 'printf "" | "$1" "$2"' - "$miniscript" "$work/dump.ms"
+check "/dev/null" "0 lines" "$miniscript" "$work/dump.ms" </dev/null
+check "one line, no newline" $'1 [x]\n  <x>\n1 lines' sh -c 'printf x | "$1" "$2"' - "$miniscript" "$work/dump.ms"
+check "only a newline" $'0 []\n1 lines' sh -c 'printf "\\n" | "$1" "$2"' - "$miniscript" "$work/dump.ms"
+
+# A pipe delivers several blocks, and some lines straddle two of them
+awk 'BEGIN { for (i = 0; i < 300000; i++) printf "%d %s\n", i, (i % 7 ? "short" : "a somewhat longer field") }' \
+    >"$work/big"
+printf 'tail without newline' >>"$work/big"
+cat >"$work/count.ms" <<'SCRIPT'
+fun count(n) {
+    total = 0;
+    while (readline()) total = total + fields();
+    return total;
+}
+c = count(0);
+print c;
+SCRIPT
+expected=$(awk '{ n += NF } END { print n }' "$work/big")
+check "large file" "$expected" "$miniscript" "$work/count.ms" <"$work/big"
+check "large pipe" "$expected" sh -c 'cat "$1" | "$2" "$3"' - "$work/big" "$miniscript" "$work/count.ms"
+
+# Custom separators keep empty fields, though an empty line has none; ""
+# goes back to runs of blanks
+cat >"$work/separators.ms" <<'SCRIPT'
+fun show(n) {
+    print str(n) + " [" + line() + "]";
+    for (i = 0; i < n; i = i + 1;) print "  <" + field(i) + ">";
+    return 1;
+}
+r = readline();
+r = separator(",");
+r = show(fields());
+r = readline();
+r = separator("::");
+r = show(fields());
+r = separator("");
+r = show(fields());
+r = readline();
+r = separator(",");
+r = show(fields());
+SCRIPT
+check "separators" '4 [a,,b c,]
+  <a>
+  <>
+  <b c>
+  <>
+3 [x::y:z::]
+  <x>
+  <y:z>
+  <>
+1 [x::y:z::]
+  <x::y:z::>
+0 []' sh -c 'printf "a,,b c,\nx::y:z::\n\n" | "$1" "$2"' - "$miniscript" "$work/separators.ms"
+
+# Numbers parse with surrounding blanks ignored; anything else is an error
+numbers() {
+    printf 'r = readline();\nr = separator(",");\n%s\n' "$1" >"$work/numbers.ms"
+    printf ' 42 ,2.5,-7\t,abc,12x,\n' | "$miniscript" "$work/numbers.ms" 2>&1
+}
+check "fieldint" "42" numbers 'print fieldint(0);'
+check "fieldint, negative" "-7" numbers 'print fieldint(2);'
+check "fieldfloat" "2.5" numbers 'print fieldfloat(1);'
+check "fieldfloat of an int" "42" numbers 'print fieldfloat(0);'
+check "fieldint of a float" 'Runtime error: fieldint() cannot convert "2.5"' numbers 'print fieldint(1);'
+check "fieldint, not a number" 'Runtime error: fieldint() cannot convert "abc"' numbers 'print fieldint(3);'
+check "fieldint, trailing text" 'Runtime error: fieldint() cannot convert "12x"' numbers 'print fieldint(4);'
+check "fieldint, empty field" 'Runtime error: fieldint() cannot convert ""' numbers 'print fieldint(5);'
+check "fieldfloat, not a number" 'Runtime error: fieldfloat() cannot convert "abc"' numbers 'print fieldfloat(3);'
+check "fieldint, past the last field" "Runtime error: fieldint() index 6 is out of range" numbers 'print fieldint(6);'
+check "fieldint, negative index" "Runtime error: fieldint() index -1 is out of range" numbers 'print fieldint(0 - 1);'
+check "field, past the last field" "Runtime error: field() index 6 is out of range" numbers 'print field(6);'
+check "fieldfloat, past the last field" "Runtime error: fieldfloat() index 9 is out of range" numbers 'print fieldfloat(9);'
+
+# After the end of the input there is no line and no field
+printf 'r = readline();\nr = readline();\nprint "[" + line() + "]";\nprint fields();\nprint fieldint(0);\n' \
+    >"$work/after.ms"
+check "after the end" $'[]\n0\nRuntime error: fieldint() index 0 is out of range' \
+    sh -c 'printf "7\n" | "$1" "$2"' - "$miniscript" "$work/after.ms"
+
+sed "1i path = \"$work/missing\";" "$work/dump_file.ms" >"$work/dump_missing.ms"
+check "missing file" "Runtime error: input() cannot open '$work/missing': No such file or directory" \
+    "$miniscript" "$work/dump_missing.ms"
+
+[ $failed = 0 ] && echo "input OK"
+[ $failed = 0 ]
@@ -0,0 +1,92 @@
+#!/bin/bash
+# --serve: a script sent to the daemon prints what running it directly
+# prints, a repeated script is answered from the program cache, a syntax
+# error comes back as an error reply, and the socket is removed on shutdown.
+#
+# Usage: tests/serve.sh <miniscript> <miniscript-load>
+miniscript=$1
+load=$2
+
+work=$(mktemp -d)
+server=
+trap '[ -n "$server" ] && kill $server 2>/dev/null; rm -rf "$work"' EXIT
+
+failed=0
+
+fail() {
+    echo "FAIL $*"
+    failed=$((failed + 1))
+}
+
+# counter <name>: one value from the server's counters
+counter() {
+    "$load" --stats "$work/sock" | awk -v name="$1" '$1 == name { print $2 }'
+}
+
+cat >"$work/good.ms" <<'SCRIPT'
+fun sumSquares(n) {
+    total = 0;
+    for (i = 1; i <= n; i = i + 1;) total = total + i * i;
+    return total;
+}
+r = sumSquares(10);
+print r;
+print "done";
+SCRIPT
+# The SSA IR has no functions
+cat >"$work/flat.ms" <<'SCRIPT'
+i = 1;
+while (i <= 10) i = i + 1;
+print i * i;
+SCRIPT
+printf 'x = 1;\nprint ;\n' >"$work/bad.ms"
+printf 'x = 1;\nprint x / 0;\n' >"$work/fails.ms"
+
+"$miniscript" --serve "$work/sock" --workers 2 --cache-size 4 2>"$work/log" &
+server=$!
+for ((tries = 0; tries < 50; ++tries)); do [ -S "$work/sock" ] && break; sleep 0.1; done
+[ -S "$work/sock" ] || { echo "FAIL the server did not start: $(cat "$work/log")"; exit 1; }
+
+# once <name> <script> <flags>...: one request must succeed and print what a
+# direct run of the script prints
+once() {
+    local name=$1 script=$2
+    shift 2
+    "$miniscript" "$script" >"$work/direct" 2>&1
+    "$load" --once "$@" "$work/sock" "$script" >"$work/served" 2>&1
+    local status=$?
+    [ $status = 0 ] || fail "$name: exit $status"
+    cmp -s "$work/direct" "$work/served" || fail "$name: got '$(cat "$work/served")', expected '$(cat "$work/direct")'"
+}
+
+once "by path" "$work/good.ms"
+[ "$(counter cache_misses)" = 1 ] || fail "first request: expected one cache miss"
+once "by path, again" "$work/good.ms"
+once "inline, same source" "$work/good.ms" --inline
+[ "$(counter cache_hits)" = 2 ] || fail "repeated script: expected two cache hits, got $(counter cache_hits)"
+once optimized "$work/flat.ms" -O
+
+# The error reply carries the diagnostic and a failing status
+got=$("$load" --once "$work/sock" "$work/bad.ms" 2>&1)
+status=$?
+[ $status = 1 ] || fail "syntax error: exit $status"
+[[ "$got" == *"Error at ';'"*"Parse error:"* ]] || fail "syntax error: got '$got'"
+[ "$(counter compile_errors)" = 1 ] || fail "syntax error: not counted as a compile error"
+"$load" --once "$work/sock" "$work/fails.ms" >/dev/null 2>&1
+[ "$(counter runtime_errors)" = 1 ] || fail "runtime error: not counted as one"
+got=$("$load" --once "$work/sock" "$work/missing.ms" 2>&1)
+[ $? = 1 ] || fail "missing file: expected a failing exit"
+
+# More clients than workers, each with many requests; none is dropped
+got=$("$load" -n 400 -c 8 "$work/sock" "$work/good.ms")
+[[ "$got" == *"lost         0 "* ]] || fail "load: got '$got'"
+
+kill -TERM $server
+wait $server
+status=$?
+server=
+[ $status = 0 ] || fail "shutdown: exit $status"
+[ -e "$work/sock" ] && fail "shutdown: the socket was left behind"
+
+[ $failed = 0 ] && echo "serve OK"
+[ $failed = 0 ]
@@ -0,0 +1,111 @@
+#!/bin/bash
+# --snapshot and --restore: a restored image must continue where the script
+# that wrote it left off, and a damaged or crafted image must be refused with
+# "Could not restore", never crash.
+#
+# Usage: tests/snapshot.sh <miniscript>
+miniscript=$1
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+failed=0
+
+fail() {
+    echo "FAIL $*"
+    failed=$((failed + 1))
+}
+
+# Image layout (Snapshot.cpp): a 96-byte header, then the payload its
+# checksum covers. String records start with a refcount, then the length.
+header=96
+
+# u64 <file> <offset> and u32 <file> <offset>: little-endian fields
+u64() { od -An -v -td8 -j "$2" -N 8 "$1" | tr -d ' '; }
+u32() { od -An -v -tu4 -j "$2" -N 4 "$1" | tr -d ' '; }
+
+# put64 <file> <offset> <value>
+put64() {
+    local bytes= k
+    for ((k = 0; k < 64; k += 8)); do bytes+=$(printf '\\x%02x' $((($3 >> k) & 255))); done
+    printf "$bytes" | dd of="$1" bs=1 seek="$2" conv=notrunc status=none
+}
+
+# reseal <file>: recomputes the checksum, so that only the later checks can
+# catch the damage. Bash arithmetic wraps at 64 bits like the C++ does.
+reseal() {
+    local h=-3750763034362895579 word  # 14695981039346656037 as a signed word
+    for word in $(od -An -v -td8 -j $header "$1"); do
+        h=$(((h ^ word) * 1099511628211))
+        h=$((h ^ ((h >> 32) & 0xffffffff)))
+    done
+    put64 "$1" 16 $h
+}
+
+# refused <name> <image>: restoring prints "Could not restore" and exits 1
+refused() {
+    local got
+    got=$("$miniscript" --restore "$2" "$work/next.ms" 2>&1)
+    local status=$?
+    if [ $status != 1 ] || [[ "$got" != "Could not restore"* ]]; then
+        fail "$1: exit $status, got '$got'"
+    fi
+}
+
+cat >"$work/first.ms" <<'SCRIPT'
+fun scaled(x) {
+    y = x * factor;
+    return y;
+}
+factor = 3;
+greeting = "hello, image";
+ratio = 2.5;
+print greeting;
+SCRIPT
+cat >"$work/next.ms" <<'SCRIPT'
+r = scaled(14);
+print r;
+print greeting + "!";
+print ratio * 2;
+SCRIPT
+
+"$miniscript" --snapshot "$work/image" "$work/first.ms" >/dev/null 2>&1 || fail "writing the image"
+got=$("$miniscript" --restore "$work/image" "$work/next.ms" 2>&1)
+[ "$got" = $'42\nhello, image!\n5' ] || fail "round trip: got '$got'"
+[ -e "$work/image.tmp" ] && fail "the image's temporary file was left behind"
+size=$(stat -c %s "$work/image")
+
+for length in 0 40 $header $((size / 2)) $((size - 8)); do
+    head -c $length "$work/image" >"$work/bad"
+    refused "truncated to $length bytes" "$work/bad"
+done
+
+cp "$work/image" "$work/bad"
+printf '\x5a' | dd of="$work/bad" bs=1 seek=$((size - 20)) conv=notrunc status=none
+refused "flipped byte" "$work/bad"
+
+# Past the checksum, every word of the payload in turn set to all ones
+for ((offset = header; offset < size; offset += 8)); do
+    cp "$work/image" "$work/bad"
+    put64 "$work/bad" $offset -1
+    reseal "$work/bad"
+    "$miniscript" --restore "$work/bad" "$work/next.ms" >/dev/null 2>&1
+    status=$?
+    [ $status -ge 128 ] && fail "word at $offset set to ones: exit $status"
+done
+
+# The first global's name record claims more bytes than the image has
+strings=$(u64 "$work/image" 32)
+globals=$(u64 "$work/image" 48)
+name=$(u32 "$work/image" $globals)
+cp "$work/image" "$work/bad"
+put64 "$work/bad" $((strings + name + 8)) $((1 << 40))
+reseal "$work/bad"
+refused "string longer than the image" "$work/bad"
+
+# ...and the string section ends right after that record's header
+put64 "$work/bad" 40 $((name + 32))
+refused "string past the end of its section" "$work/bad"
+
+[ $failed = 0 ] && echo "snapshot OK"
+[ $failed = 0 ]
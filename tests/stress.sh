@@ -0,0 +1,89 @@
+#!/bin/bash
+# Programs much longer than the corpus scripts. Every mode must print what
+# the tree walker prints; none may crash. Last, bad option values must end
+# in the usage message.
+#
+# Usage: tests/stress.sh <miniscript>
+miniscript=$1
+
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+failed=0
+
+# expect <name> <expected output> <miniscript arguments>...
+expect() {
+    local name=$1 expected=$2
+    shift 2
+    local got
+    got=$("$miniscript" "$@" 2>&1 | tail -1)
+    local status=${PIPESTATUS[0]}
+    if [ "$got" != "$expected" ] || [ $status -ge 128 ]; then
+        echo "FAIL $name ($*): exit $status, got '$got', expected '$expected'"
+        failed=$((failed + 1))
+    fi
+}
+
+# survives <name> <miniscript arguments>...: any output, but no crash
+survives() {
+    local name=$1
+    shift
+    "$miniscript" "$@" >/dev/null 2>&1
+    local status=$?
+    if [ $status -ge 128 ]; then
+        echo "FAIL $name ($*): exit $status"
+        failed=$((failed + 1))
+    fi
+}
+
+# A long run of branches makes the dominator tree as deep as the program
+awk 'BEGIN {
+    print "x = 1;"
+    for (i = 0; i < 20000; i++) print "if (x > 0) x = x + 1;"
+    print "print x;"
+}' >"$work/long_branches.ms"
+for mode in "" -O0 -O; do expect long_branches 20001 $mode "$work/long_branches.ms"; done
+"$miniscript" --dump-ir "$work/long_branches.ms" >/dev/null 2>&1 || { echo "FAIL long_branches (--dump-ir)"; failed=$((failed + 1)); }
+
+# More distinct function names than the native slot table takes
+awk 'BEGIN {
+    for (i = 0; i < 70000; i++) printf "fun f%d(x) { return x + %d; }\n", i, i
+    print "a = f69999(1);"
+    print "b = abs(0 - a);"
+    print "print b;"
+}' >"$work/many_functions.ms"
+expect many_functions 70000 "$work/many_functions.ms"
+
+# Nesting deeper than the stack holds must end in an error, not a crash
+awk 'BEGIN {
+    print "x = 1;"
+    for (i = 0; i < 50000; i++) printf "if (x > 0) "
+    print "x = 2;"
+    print "print x;"
+}' >"$work/deep_ifs.ms"
+awk 'BEGIN {
+    printf "print 1"
+    for (i = 0; i < 50000; i++) printf " + 1"
+    print ";"
+}' >"$work/long_sum.ms"
+for script in deep_ifs long_sum; do
+    for mode in "" -O0 -O --dump-ir --parallel-loops --lazy; do
+        survives $script --max-depth 100000 $mode "$work/$script.ms"
+    done
+    survives $script --max-depth 100000 --snapshot "$work/image" "$work/$script.ms"
+    survives $script --max-depth 100000 --incremental "$work/cache" "$work/$script.ms"
+done
+
+for args in "--max-depth abc" "--max-depth -1" "--max-depth 0" "--max-depth 5x" "--parse-threads x" \
+            "--parse-threads -2" "--parallel-loops=x" "--parallel-loops=0" "--workers x" "--workers 5000" \
+            "--cache-size 0" "--cache-size -3"; do
+    "$miniscript" $args "$work/long_sum.ms" >/dev/null 2>"$work/usage"
+    status=$?
+    if [ $status != 1 ] || ! grep -q '^Usage:' "$work/usage"; then
+        echo "FAIL bad option ($args): exit $status"
+        failed=$((failed + 1))
+    fi
+done
+
+[ $failed = 0 ] && echo "stress OK"
+[ $failed = 0 ]